@@ -0,0 +1,123 @@
+// The main caffe micro-benchmark code. Your benchmark cpp code should include
+// this hpp and register its benchmarks with REGISTER_BENCHMARK_CLASS.
+#ifndef CAFFE_BENCHMARK_BENCH_CAFFE_MAIN_HPP_
+#define CAFFE_BENCHMARK_BENCH_CAFFE_MAIN_HPP_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A kernel timed over a sweep of arguments, typically shapes.
+ *
+ * For each tuple of args(), the harness calls SetUp once and Run once to warm
+ * up, then times batches of calls to Run long enough to last --min_time
+ * seconds, --repetitions times, and reports statistics of the time per call
+ * over the batches.
+ */
+class Benchmark {
+ public:
+  virtual ~Benchmark() {}
+
+  // The argument tuples to run with.
+  virtual vector<vector<int> > args() const = 0;
+  virtual void SetUp(const vector<int>& args) = 0;
+  // Runs the kernel once.
+  virtual void Run() = 0;
+  // Floating point operations and bytes of memory traffic of one Run, for
+  // the reported throughputs; 0 if not meaningful.
+  virtual double flops() const { return 0; }
+  virtual double bytes() const { return 0; }
+};
+
+// Times the forward pass of a layer, or its backward pass if backward is
+// set, on a random bottom.
+template <typename Dtype>
+class LayerBenchmark : public Benchmark {
+ public:
+  explicit LayerBenchmark(bool backward)
+      : backward_(backward), propagate_down_(1, true),
+        bottom_vec_(1, &bottom_), top_vec_(1, &top_) {}
+
+  virtual void Run() {
+    if (backward_) {
+      layer_->Backward(top_vec_, propagate_down_, bottom_vec_);
+    } else {
+      layer_->Forward(bottom_vec_, top_vec_);
+    }
+  }
+  virtual double bytes() const {
+    return (bottom_.count() + top_.count()) * sizeof(Dtype) *
+        (backward_ ? 2 : 1);
+  }
+
+ protected:
+  // Sets up layer with a bottom of the given shape, and runs it forward once
+  // so that it can run backward.
+  void SetUpLayer(Layer<Dtype>* layer, const vector<int>& bottom_shape) {
+    layer_.reset(layer);
+    bottom_.Reshape(bottom_shape);
+    caffe_rng_uniform<Dtype>(bottom_.count(), -1, 1,
+        bottom_.mutable_cpu_data());
+    layer_->SetUp(bottom_vec_, top_vec_);
+    layer_->Forward(bottom_vec_, top_vec_);
+    caffe_rng_uniform<Dtype>(top_.count(), -1, 1, top_.mutable_cpu_diff());
+  }
+
+  const bool backward_;
+  const vector<bool> propagate_down_;
+  shared_ptr<Layer<Dtype> > layer_;
+  Blob<Dtype> bottom_;
+  Blob<Dtype> top_;
+  vector<Blob<Dtype>*> bottom_vec_;
+  vector<Blob<Dtype>*> top_vec_;
+};
+
+// Parses argument tuples from their values separated by ',', each tuple
+// separated by ';', e.g. "64,64,64;128,128,128".
+vector<vector<int> > ParseArgs(const string& spec);
+
+class BenchmarkRegistry {
+ public:
+  typedef Benchmark* (*Creator)();
+  typedef vector<pair<string, Creator> > CreatorList;
+
+  static CreatorList& Registry() {
+    static CreatorList* g_registry_ = new CreatorList();
+    return *g_registry_;
+  }
+
+  static void AddCreator(const string& name, Creator creator) {
+    Registry().push_back(std::make_pair(name, creator));
+  }
+
+ private:
+  // Benchmark registry should never be instantiated - everything is done with
+  // its static variables.
+  BenchmarkRegistry() {}
+};
+
+template <typename T>
+class BenchmarkRegisterer {
+ public:
+  explicit BenchmarkRegisterer(const string& name) {
+    BenchmarkRegistry::AddCreator(name, &Create);
+  }
+
+  static Benchmark* Create() { return new T(); }
+};
+
+#define REGISTER_BENCHMARK_CLASS(type)                                         \
+  static BenchmarkRegisterer<type<float> > g_bench_f_##type(#type "<float>");  \
+  static BenchmarkRegisterer<type<double> > g_bench_d_##type(#type "<double>")
+
+}  // namespace caffe
+
+#endif  // CAFFE_BENCHMARK_BENCH_CAFFE_MAIN_HPP_
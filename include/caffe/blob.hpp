@@ -1,6 +1,8 @@
 #ifndef CAFFE_BLOB_HPP_
 #define CAFFE_BLOB_HPP_
 
+#include <stdint.h>
+
 #include <algorithm>
 #include <string>
 #include <vector>
@@ -13,6 +15,26 @@ const int kMaxBlobAxes = 32;
 
 namespace caffe {
 
+/**
+ * @brief How Blob::Reshape sizes the memory it reallocates when a blob grows
+ *        beyond its capacity, shared by all blobs.
+ *
+ * The new capacity is growth_factor times the former one when that exceeds
+ * the new count, but at most max_headroom_bytes beyond it, so that a blob
+ * growing by small steps, e.g. with the batch or image size of requests, is
+ * reallocated a logarithmic rather than linear number of times. The first
+ * allocation is exact, and a factor of 1 makes every allocation exact.
+ */
+struct BlobGrowthPolicy {
+  BlobGrowthPolicy() : growth_factor(1.5), max_headroom_bytes(64 << 20) {}
+
+  double growth_factor;
+  size_t max_headroom_bytes;
+};
+
+const BlobGrowthPolicy& GetBlobGrowthPolicy();
+void SetBlobGrowthPolicy(const BlobGrowthPolicy& policy);
+
 /**
  * @brief A wrapper around SyncedMemory holders serving as the basic
  *        computational unit through which Layer%s, Net%s, and Solver%s
@@ -24,7 +46,8 @@ template <typename Dtype>
 class Blob {
  public:
   Blob()
-       : data_(), diff_(), count_(0), capacity_(0) {}
+       : data_(), diff_(), count_(0), capacity_(0), has_diff_(true),
+         half_storage_(false) {}
 
   /// @brief Deprecated; use <code>Blob(const vector<int>& shape)</code>.
   explicit Blob(const int num, const int channels, const int height,
@@ -41,8 +64,9 @@ class Blob {
    * This function can be called both to create an initial allocation
    * of memory, and to adjust the dimensions of a top blob during Layer::Reshape
    * or Layer::Forward. When changing the size of blob, memory will only be
-   * reallocated if sufficient memory does not already exist, and excess memory
-   * will never be freed.
+   * reallocated if sufficient memory does not already exist, with headroom as
+   * set by the BlobGrowthPolicy, and excess memory is only freed by
+   * ShrinkToFit.
    *
    * Note that reshaping an input blob and immediately calling Net::Backward is
    * an error; either Net::Forward or Net::Reshape need to be called to
@@ -51,6 +75,16 @@ class Blob {
   void Reshape(const vector<int>& shape);
   void Reshape(const BlobShape& shape);
   void ReshapeLike(const Blob& other);
+  /**
+   * @brief Reallocates the memory of the blob to its count, keeping its
+   *        contents, if it has excess capacity; returns the bytes released.
+   *
+   * Memory shared with other blobs is left as it is, as reallocating it would
+   * stop the sharing.
+   */
+  size_t ShrinkToFit();
+  /// @brief The number of elements the memory of the blob can hold.
+  inline int64_t capacity() const { return capacity_; }
   inline string shape_string() const {
     ostringstream stream;
     for (int i = 0; i < shape_.size(); ++i) {
@@ -72,7 +106,7 @@ class Blob {
     return shape_[CanonicalAxisIndex(index)];
   }
   inline int num_axes() const { return shape_.size(); }
-  inline int count() const { return count_; }
+  inline int64_t count() const { return count_; }
 
   /**
    * @brief Compute the volume of a slice; i.e., the product of dimensions
@@ -82,13 +116,13 @@ class Blob {
    *
    * @param end_axis The first axis to exclude from the slice.
    */
-  inline int count(int start_axis, int end_axis) const {
+  inline int64_t count(int start_axis, int end_axis) const {
     CHECK_LE(start_axis, end_axis);
     CHECK_GE(start_axis, 0);
     CHECK_GE(end_axis, 0);
     CHECK_LE(start_axis, num_axes());
     CHECK_LE(end_axis, num_axes());
-    int count = 1;
+    int64_t count = 1;
     for (int i = start_axis; i < end_axis; ++i) {
       count *= shape(i);
     }
@@ -100,7 +134,7 @@ class Blob {
    *
    * @param start_axis The first axis to include in the slice.
    */
-  inline int count(int start_axis) const {
+  inline int64_t count(int start_axis) const {
     return count(start_axis, num_axes());
   }
 
@@ -150,7 +184,7 @@ class Blob {
     return shape(index);
   }
 
-  inline int offset(const int n, const int c = 0, const int h = 0,
+  inline int64_t offset(const int n, const int c = 0, const int h = 0,
       const int w = 0) const {
     CHECK_GE(n, 0);
     CHECK_LE(n, num());
@@ -160,12 +194,13 @@ class Blob {
     CHECK_LE(h, height());
     CHECK_GE(width(), 0);
     CHECK_LE(w, width());
-    return ((n * channels() + c) * height() + h) * width() + w;
+    return ((static_cast<int64_t>(n) * channels() + c) * height() + h) *
+        width() + w;
   }
 
-  inline int offset(const vector<int>& indices) const {
+  inline int64_t offset(const vector<int>& indices) const {
     CHECK_LE(indices.size(), num_axes());
-    int offset = 0;
+    int64_t offset = 0;
     for (int i = 0; i < num_axes(); ++i) {
       offset *= shape(i);
       if (indices.size() > i) {
@@ -216,6 +251,67 @@ class Blob {
     return diff_;
   }
 
+  /**
+   * @brief Sets whether the blob has a diff. Without one, as for the blobs of
+   *        inference-only Net%s, the diff is released and never created again
+   *        by Reshape, and the diff accessors fail.
+   */
+  void set_has_diff(bool has_diff);
+  inline bool has_diff() const { return has_diff_; }
+
+  /**
+   * @brief Stores the data in half precision, releasing the full precision
+   *        data and diff, and returns the bytes released; e.g. for the
+   *        weights of inference-only Net%s, which Layer%s allowing it read
+   *        through cpu_half_data.
+   *
+   * The other accessors of the data then fail, except ToProto, which
+   * converts it back, until Reshape allocates new full precision data. Memory
+   * shared with other blobs is left as it is.
+   */
+  size_t StoreAsHalf();
+  /**
+   * @brief Stores the data in half precision from now on, as Reshape
+   *        allocates it, and returns the bytes released; for the activations
+   *        of inference-only Net%s between Layer%s reading and writing them
+   *        through the block accessors.
+   *
+   * The blob must have no diff. Its data is lost, and the other accessors of
+   * the data fail; see Net::StoreActivationsAsHalf.
+   */
+  size_t AllocateAsHalf();
+  inline bool half() const { return half_data_.get() != NULL; }
+  const uint16_t* cpu_half_data() const;
+  /// @brief The memory holding the data, in half precision if half().
+  inline const SyncedMemory* data_memory() const {
+    return half_data_ ? half_data_.get() : data().get();
+  }
+  /// @brief The memory holding the diff, or NULL if the blob has none.
+  inline const SyncedMemory* diff_memory() const {
+    return has_diff_ ? diff().get() : NULL;
+  }
+
+  /**
+   * @brief Returns count elements of the data from offset, converted into
+   *        buffer if stored in half precision, e.g. an image for Layer%s
+   *        reading their bottoms by blocks.
+   */
+  const Dtype* cpu_data_block(int64_t offset, int64_t count,
+      vector<Dtype>* buffer) const;
+  /**
+   * @brief Returns where to write count elements of the data from offset,
+   *        buffer if stored in half precision, to be stored by
+   *        set_cpu_data_block.
+   */
+  Dtype* mutable_cpu_data_block(int64_t offset, int64_t count,
+      vector<Dtype>* buffer);
+  /**
+   * @brief Stores count elements of block into the data from offset,
+   *        converting them if stored in half precision; nothing to do if
+   *        block is the data returned by mutable_cpu_data_block.
+   */
+  void set_cpu_data_block(int64_t offset, int64_t count, const Dtype* block);
+
   const Dtype* cpu_data() const;
   void set_cpu_data(Dtype* data);
   const int* gpu_shape() const;
@@ -251,6 +347,7 @@ class Blob {
    *
    * This deallocates the SyncedMemory holding this Blob's data_, as
    * shared_ptr calls its destructor when reset with the "=" operator.
+   * Data in half precision is shared as such.
    */
   void ShareData(const Blob& other);
   /**
@@ -260,6 +357,7 @@ class Blob {
    *
    * This deallocates the SyncedMemory holding this Blob's diff_, as
    * shared_ptr calls its destructor when reset with the "=" operator.
+   * If other has no diff, neither has this Blob thereafter.
    */
   void ShareDiff(const Blob& other);
 
@@ -269,9 +367,12 @@ class Blob {
   shared_ptr<SyncedMemory> data_;
   shared_ptr<SyncedMemory> diff_;
   shared_ptr<SyncedMemory> shape_data_;
+  shared_ptr<SyncedMemory> half_data_;
   vector<int> shape_;
-  int count_;
-  int capacity_;
+  int64_t count_;
+  int64_t capacity_;
+  bool has_diff_;
+  bool half_storage_;
 
   DISABLE_COPY_AND_ASSIGN(Blob);
 };  // class Blob
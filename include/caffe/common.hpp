@@ -97,6 +97,8 @@ using std::vector;
 // Currently it initializes google flags and google logging.
 void GlobalInit(int* pargc, char*** pargv);
 
+class HostAllocator;
+
 // A singleton class to hold common caffe stuff, such as the handler that
 // caffe is going to use for cublas, curand, etc.
 class Caffe {
@@ -163,6 +165,22 @@ class Caffe {
   inline static void set_solver_count(int val) { Get().solver_count_ = val; }
   inline static bool root_solver() { return Get().root_solver_; }
   inline static void set_root_solver(bool val) { Get().root_solver_ = val; }
+  // The NUMA node the host memory of the blobs the thread allocates in CPU
+  // mode is bound to, -1 for none, and whether the thread and the threads it
+  // starts run on the CPUs of that node only.
+  inline static int numa_node() { return Get().numa_node_; }
+  inline static bool numa_pinned() { return Get().numa_pinned_; }
+  // Binds the calling thread to a NUMA node, or unbinds it for -1: the memory
+  // it allocates comes from the node and, if pin, it runs on the node's CPUs.
+  // The threads it then starts, such as prefetching threads and the threads
+  // of Net::Forward, inherit the binding.
+  static void SetNumaNode(const int node, const bool pin = true);
+  // The allocator of host memory in CPU mode, shared by all threads, and
+  // its statistics; a CachingHostAllocator by default.
+  static HostAllocator* host_allocator();
+  // Replaces the host allocator. Call it before allocating any blob, as
+  // memory is freed by the allocator current at the time.
+  static void set_host_allocator(const shared_ptr<HostAllocator>& allocator);
 
  protected:
 #ifndef CPU_ONLY
@@ -174,6 +192,8 @@ class Caffe {
   Brew mode_;
   int solver_count_;
   bool root_solver_;
+  int numa_node_;
+  bool numa_pinned_;
 
  private:
   // The private constructor to avoid duplicate instantiation.
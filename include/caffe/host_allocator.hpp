@@ -0,0 +1,114 @@
+#ifndef CAFFE_HOST_ALLOCATOR_HPP_
+#define CAFFE_HOST_ALLOCATOR_HPP_
+
+#include <stdint.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "caffe/common.hpp"
+
+namespace boost { class mutex; }
+
+namespace caffe {
+
+/**
+ * @brief Allocates the host memory of SyncedMemory in CPU mode.
+ *
+ * Caffe::host_allocator() is shared by all threads, so implementations must
+ * be thread safe. Memory is returned to the allocator current when it is
+ * freed, so Caffe::set_host_allocator must be called before any is allocated.
+ * The built-in allocators bind the blocks they get from the system to the
+ * NUMA node of the calling thread, if any, and serve a cached block only to
+ * threads of the node it was bound to.
+ */
+class HostAllocator {
+ public:
+  // Alignment of all allocations, that of the widest vector loads.
+  static const size_t kAlignment = 64;
+
+  struct Stats {
+    Stats()
+        : bytes_in_use(0), peak_bytes_in_use(0), bytes_cached(0),
+          allocations(0), cache_hits(0) {}
+    double hit_rate() const {
+      return allocations ? static_cast<double>(cache_hits) / allocations : 0;
+    }
+
+    // Bytes allocated and not yet freed, and their maximum so far.
+    size_t bytes_in_use;
+    size_t peak_bytes_in_use;
+    // Bytes freed but kept for reuse.
+    size_t bytes_cached;
+    // Calls to Allocate, and those of them served from the cached bytes.
+    uint64_t allocations;
+    uint64_t cache_hits;
+  };
+
+  virtual ~HostAllocator() {}
+
+  // Returns size bytes aligned to kAlignment.
+  virtual void* Allocate(size_t size) = 0;
+  // Frees ptr, returned by Allocate(size).
+  virtual void Free(void* ptr, size_t size) = 0;
+  // Returns the cached bytes, if any, to the system.
+  virtual void EmptyCache() {}
+  virtual Stats stats() const = 0;
+};
+
+// Allocates every block from the system.
+class AlignedHostAllocator : public HostAllocator {
+ public:
+  AlignedHostAllocator();
+  virtual ~AlignedHostAllocator() {}
+
+  virtual void* Allocate(size_t size);
+  virtual void Free(void* ptr, size_t size);
+  virtual Stats stats() const;
+
+ private:
+  shared_ptr<boost::mutex> mutex_;
+  Stats stats_;
+
+  DISABLE_COPY_AND_ASSIGN(AlignedHostAllocator);
+};
+
+/**
+ * @brief The default HostAllocator: rounds sizes up to buckets of at most a
+ *        quarter more, and keeps freed blocks in a free list per NUMA node
+ *        and bucket to serve later allocations of the same bucket on the
+ *        same node, up to max_cached_bytes.
+ */
+class CachingHostAllocator : public HostAllocator {
+ public:
+  static const size_t kDefaultMaxCachedBytes = size_t(1) << 30;
+
+  explicit CachingHostAllocator(
+      size_t max_cached_bytes = kDefaultMaxCachedBytes);
+  virtual ~CachingHostAllocator();
+
+  virtual void* Allocate(size_t size);
+  virtual void Free(void* ptr, size_t size);
+  virtual void EmptyCache();
+  virtual Stats stats() const;
+
+  // The size of the blocks allocated for size bytes: a multiple of
+  // kAlignment with at most 4 buckets between consecutive powers of 2.
+  static size_t BucketSize(size_t size);
+
+ private:
+  shared_ptr<boost::mutex> mutex_;
+  const size_t max_cached_bytes_;
+  // Free blocks by NUMA node, -1 for none, and bucket size.
+  std::map<std::pair<int, size_t>, vector<void*> > free_blocks_;
+  // The nodes of the blocks in use allocated on a node.
+  std::map<void*, int> block_nodes_;
+  Stats stats_;
+
+  DISABLE_COPY_AND_ASSIGN(CachingHostAllocator);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_HOST_ALLOCATOR_HPP_
@@ -38,7 +38,7 @@ class Layer {
    * layer.
    */
   explicit Layer(const LayerParameter& param)
-    : layer_param_(param), is_shared_(false) {
+    : layer_param_(param), is_shared_(false), reshape_on_change_(false) {
       // Set phase and copy blobs (if there are any).
       phase_ = param.phase();
       if (layer_param_.blobs_size() > 0) {
@@ -131,6 +131,24 @@ class Layer {
   virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) = 0;
 
+  /**
+   * @brief Reshapes the layer unless its bottoms have the shapes and the
+   *        data and diff memory they had when it last reshaped through this
+   *        call, and returns whether it reshaped.
+   *
+   * Layers whose Reshape depends on more than the shapes of their bottoms,
+   * see ReshapesFromBottomShapes, always reshape.
+   */
+  bool ReshapeIfChanged(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+
+  /**
+   * @brief Sets whether Forward reshapes the layer only when its bottoms
+   *        changed, through ReshapeIfChanged, rather than every time.
+   */
+  void set_reshape_on_change(bool reshape_on_change);
+  inline bool reshape_on_change() const { return reshape_on_change_; }
+
   /**
    * @brief Given the bottom blobs, compute the top blobs and the loss.
    *
@@ -294,6 +312,57 @@ class Layer {
     return true;
   }
 
+  /**
+   * @brief Return whether the layer can run forward on the CPU with its
+   *        param_id-th parameter blob stored in half precision, as by
+   *        Net::StoreWeightsAsHalf.
+   */
+  virtual inline bool AllowHalfParam(const int param_id) const {
+    return false;
+  }
+
+  /**
+   * @brief Return whether the layer can run forward on the CPU with its
+   *        bottoms and tops stored in half precision, reading and writing
+   *        them through the block accessors of Blob, as by
+   *        Net::StoreActivationsAsHalf.
+   */
+  virtual inline bool AllowHalfActivations() const { return false; }
+
+  /**
+   * @brief Return whether the layer runs on the CPU with blobs of more than
+   *        INT_MAX elements, indexing them in 64 bits.
+   *
+   * Forward and Backward fail on such blobs for other layers, and for all
+   * layers on the GPU, whose kernels take int counts.
+   */
+  virtual inline bool AllowLargeBlobs() const { return false; }
+
+  /**
+   * @brief Return whether Reshape shapes the tops and buffers of the layer
+   *        from the shapes of its bottoms only, so that it need not run again
+   *        while they keep their shapes, as by ReshapeIfChanged.
+   *
+   * Layers whose shapes depend on the data of their bottoms, for instance,
+   * should return false.
+   */
+  virtual inline bool ReshapesFromBottomShapes() const { return true; }
+
+  /**
+   * @brief Returns the bytes allocated for the buffers the layer holds
+   *        besides its parameters and tops, such as the columns of a
+   *        convolution or the mask of a max pooling, at their capacity, as
+   *        reported by Net::MemoryFootprint; see BufferBytes.
+   */
+  virtual inline size_t WorkspaceBytes() const { return 0; }
+  /**
+   * @brief Reallocates the buffers the layer holds besides its parameters
+   *        and tops, such as the columns of a convolution, to their current
+   *        sizes, e.g. after a spike of the input size, and returns the
+   *        bytes released; see Net::ShrinkToFit.
+   */
+  virtual size_t ShrinkToFit() { return 0; }
+
   /**
    * @brief Specifies whether the layer should compute gradients w.r.t. a
    *        parameter at a particular index given by param_id.
@@ -331,6 +400,17 @@ class Layer {
    *  the objective function. */
   vector<Dtype> loss_;
 
+  /**
+   * @brief Returns the bytes the data of a buffer of the layer takes at its
+   *        capacity, rounded up as the host allocator rounds them, for
+   *        WorkspaceBytes.
+   */
+  template <typename T>
+  static size_t BufferBytes(const Blob<T>& buffer) {
+    return buffer.capacity() ? CaffeHostBytes(buffer.capacity() * sizeof(T)) :
+        0;
+  }
+
   /** @brief Using the CPU device, compute the layer output. */
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) = 0;
@@ -419,6 +499,8 @@ class Layer {
       for (int top_id = 0; top_id < top.size(); ++top_id) {
         const Dtype loss_weight = layer_param_.loss_weight(top_id);
         if (loss_weight == Dtype(0)) { continue; }
+        // The loss weight is held in the diff, even in inference-only nets.
+        top[top_id]->set_has_diff(true);
         this->set_loss(top_id, loss_weight);
         const int count = top[top_id]->count();
         Dtype* loss_multiplier = top[top_id]->mutable_cpu_diff();
@@ -431,9 +513,21 @@ class Layer {
   /** Whether this layer is actually shared by other nets*/
   bool is_shared_;
 
+  /** Whether Forward reshapes through ReshapeIfChanged */
+  bool reshape_on_change_;
+  /** The shapes and the memory of the data and diffs of the bottoms at the
+   *  last ReshapeIfChanged, empty until it reshapes the layer */
+  vector<vector<int> > reshaped_shapes_;
+  vector<const SyncedMemory*> reshaped_data_;
+  vector<const SyncedMemory*> reshaped_diff_;
+
   /** The mutex for sequential forward if this layer is shared */
   shared_ptr<boost::mutex> forward_mutex_;
 
+  /** Fail on blobs larger than the layer can index; see AllowLargeBlobs */
+  void CheckBlobSizes(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top) const;
+
   /** Initialize forward_mutex_ */
   void InitMutex();
   /** Lock forward_mutex_ if this layer is shared */
@@ -453,13 +547,18 @@ inline Dtype Layer<Dtype>::Forward(const vector<Blob<Dtype>*>& bottom,
   // Lock during forward to ensure sequential forward
   Lock();
   Dtype loss = 0;
-  Reshape(bottom, top);
+  if (reshape_on_change_) {
+    ReshapeIfChanged(bottom, top);
+  } else {
+    Reshape(bottom, top);
+  }
+  CheckBlobSizes(bottom, top);
   switch (Caffe::mode()) {
   case Caffe::CPU:
     Forward_cpu(bottom, top);
     for (int top_id = 0; top_id < top.size(); ++top_id) {
       if (!this->loss(top_id)) { continue; }
-      const int count = top[top_id]->count();
+      const int64_t count = top[top_id]->count();
       const Dtype* data = top[top_id]->cpu_data();
       const Dtype* loss_weights = top[top_id]->cpu_diff();
       loss += caffe_cpu_dot(count, data, loss_weights);
@@ -490,6 +589,7 @@ template <typename Dtype>
 inline void Layer<Dtype>::Backward(const vector<Blob<Dtype>*>& top,
     const vector<bool>& propagate_down,
     const vector<Blob<Dtype>*>& bottom) {
+  CheckBlobSizes(bottom, top);
   switch (Caffe::mode()) {
   case Caffe::CPU:
     Backward_cpu(top, propagate_down, bottom);
@@ -27,6 +27,15 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   virtual inline int MinBottomBlobs() const { return 1; }
   virtual inline int MinTopBlobs() const { return 1; }
   virtual inline bool EqualNumBottomTopBlobs() const { return true; }
+  /// The columns of one image, unless the convolution is 1x1, and the bias
+  /// multiplier.
+  virtual inline size_t WorkspaceBytes() const {
+    return (is_1x1_ ? 0 : this->BufferBytes(col_buffer_)) +
+        this->BufferBytes(bias_multiplier_);
+  }
+  virtual inline size_t ShrinkToFit() {
+    return col_buffer_.ShrinkToFit() + bias_multiplier_.ShrinkToFit();
+  }
 
  protected:
   // Helper functions that abstract away the column buffer and gemm arguments.
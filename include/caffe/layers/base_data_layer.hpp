@@ -69,6 +69,14 @@ class BasePrefetchingDataLayer :
 
   // Prefetches batches (asynchronously if to GPU memory)
   static const int PREFETCH_COUNT = 3;
+  /// The prefetched batches.
+  virtual inline size_t WorkspaceBytes() const {
+    int64_t count = 0;
+    for (int i = 0; i < PREFETCH_COUNT; ++i) {
+      count += prefetch_[i].data_.capacity() + prefetch_[i].label_.capacity();
+    }
+    return count * sizeof(Dtype);
+  }
 
  protected:
   virtual void InternalThreadEntry();
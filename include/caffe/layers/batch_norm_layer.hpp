@@ -49,6 +49,10 @@ class BatchNormLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "BatchNorm"; }
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  virtual inline size_t ShrinkToFit() {
+    return batch_sum_multiplier_.ShrinkToFit() + num_by_chans_.ShrinkToFit() +
+        spatial_sum_multiplier_.ShrinkToFit();
+  }
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
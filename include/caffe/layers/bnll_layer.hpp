@@ -35,6 +35,7 @@ class BNLLLayer : public NeuronLayer<Dtype> {
       : NeuronLayer<Dtype>(param) {}
 
   virtual inline const char* type() const { return "BNLL"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
 
  protected:
   /// @copydoc BNLLLayer
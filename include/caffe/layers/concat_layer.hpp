@@ -24,6 +24,10 @@ class ConcatLayer : public Layer<Dtype> {
       const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "Concat"; }
+  // A single bottom is shared with the top rather than copied.
+  virtual inline bool AllowHalfActivations() const {
+    return this->layer_param_.bottom_size() > 1;
+  }
   virtual inline int MinBottomBlobs() const { return 1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
 
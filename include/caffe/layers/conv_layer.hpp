@@ -65,6 +65,16 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
       : BaseConvolutionLayer<Dtype>(param) {}
 
   virtual inline const char* type() const { return "Convolution"; }
+  virtual inline bool AllowHalfParam(const int param_id) const {
+    return param_id == 0;
+  }
+  virtual inline bool AllowHalfActivations() const { return true; }
+  /// Also the weights converted back in Forward, if stored in half precision.
+  virtual inline size_t WorkspaceBytes() const {
+    return BaseConvolutionLayer<Dtype>::WorkspaceBytes() +
+        (this->blobs_[0]->half() ? this->blobs_[0]->count() * sizeof(Dtype) :
+        0);
+  }
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -39,6 +39,13 @@ class DropoutLayer : public NeuronLayer<Dtype> {
       const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "Dropout"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
+  /// The mask, drawn in training only.
+  virtual inline size_t WorkspaceBytes() const {
+    if (this->phase_ != TRAIN) { return 0; }
+    return this->BufferBytes(rand_vec_);
+  }
+  virtual inline size_t ShrinkToFit() { return rand_vec_.ShrinkToFit(); }
 
  protected:
   /**
@@ -26,8 +26,10 @@ class EltwiseLayer : public Layer<Dtype> {
       const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "Eltwise"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
   virtual inline int MinBottomBlobs() const { return 2; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  virtual inline size_t ShrinkToFit() { return max_idx_.ShrinkToFit(); }
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -33,6 +33,7 @@ class ELULayer : public NeuronLayer<Dtype> {
       : NeuronLayer<Dtype>(param) {}
 
   virtual inline const char* type() const { return "ELU"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
 
  protected:
   /**
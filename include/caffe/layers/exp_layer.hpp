@@ -33,6 +33,7 @@ class ExpLayer : public NeuronLayer<Dtype> {
       const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "Exp"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
 
  protected:
   /**
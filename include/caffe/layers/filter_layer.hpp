@@ -28,6 +28,8 @@ class FilterLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "Filter"; }
   virtual inline int MinBottomBlobs() const { return 2; }
   virtual inline int MinTopBlobs() const { return 1; }
+  // The tops hold as many items as the selector selects.
+  virtual inline bool ReshapesFromBottomShapes() const { return false; }
 
  protected:
   /**
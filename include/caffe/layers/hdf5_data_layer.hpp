@@ -7,23 +7,46 @@
 #include <vector>
 
 #include "caffe/blob.hpp"
+#include "caffe/internal_thread.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/blocking_queue.hpp"
 
 #include "caffe/layers/base_data_layer.hpp"
 
 namespace caffe {
 
+/**
+ * @brief A range of rows of an HDF5 file, with one blob per top.
+ */
+template <typename Dtype>
+class HDF5Chunk {
+ public:
+  string filename_;
+  // First row and number of rows to load, 0 rows loads up to the end.
+  hsize_t row_start_;
+  hsize_t num_rows_;
+  // Number of rows in the whole file, set when the chunk is loaded.
+  hsize_t file_rows_;
+  vector<shared_ptr<Blob<Dtype> > > blobs_;
+};
+
 /**
  * @brief Provides data to the Net from HDF5 files.
  *
+ * Files are read by a background thread: the next file, or the next
+ * hdf5_data_param.chunk_rows rows of the current one, is loaded while the
+ * current one is consumed, so files need not fit in memory and training does
+ * not stall at file boundaries.
+ *
  * TODO(dox): thorough documentation for Forward and proto params.
  */
 template <typename Dtype>
-class HDF5DataLayer : public Layer<Dtype> {
+class HDF5DataLayer : public Layer<Dtype>, public InternalThread {
  public:
   explicit HDF5DataLayer(const LayerParameter& param)
-      : Layer<Dtype>(param) {}
+      : Layer<Dtype>(param), current_(NULL), next_(NULL),
+        next_is_current_(false) {}
   virtual ~HDF5DataLayer();
   virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
@@ -46,15 +69,34 @@ class HDF5DataLayer : public Layer<Dtype> {
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom) {}
   virtual void Backward_gpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom) {}
-  virtual void LoadHDF5FileData(const char* filename);
+  // Loads the rows described by chunk into its blobs, on the internal thread.
+  virtual void LoadHDF5FileData(HDF5Chunk<Dtype>* chunk);
+  virtual void InternalThreadEntry();
+  // Describes the rows following the current chunk in next_ and queues it for
+  // loading, unless it is the current chunk itself.
+  void PrefetchNextChunk();
+  // Moves to the first row of the next chunk, waiting for it if needed.
+  void NextChunk();
+  // Returns the row of the current chunk to output next, advancing to the
+  // next chunk when the current one is exhausted.
+  unsigned int NextRow();
 
   std::vector<std::string> hdf_filenames_;
   unsigned int num_files_;
   unsigned int current_file_;
   hsize_t current_row_;
-  std::vector<shared_ptr<Blob<Dtype> > > hdf_blobs_;
   std::vector<unsigned int> data_permutation_;
   std::vector<unsigned int> file_permutation_;
+
+  // The chunk being output and the one being prefetched, swapped by
+  // NextChunk() and exchanged with the internal thread through the queues.
+  HDF5Chunk<Dtype> chunks_[2];
+  HDF5Chunk<Dtype>* current_;
+  HDF5Chunk<Dtype>* next_;
+  // Set when a single chunk covers all the data, which is then kept in memory.
+  bool next_is_current_;
+  BlockingQueue<HDF5Chunk<Dtype>*> load_queue_;
+  BlockingQueue<HDF5Chunk<Dtype>*> loaded_queue_;
 };
 
 }  // namespace caffe
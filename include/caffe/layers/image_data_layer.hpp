@@ -14,9 +14,14 @@
 
 namespace caffe {
 
+class ImageCache;
+
 /**
  * @brief Provides data to the Net from image files.
  *
+ * Decoded images can be kept in memory between epochs by setting
+ * image_data_param.cache_size, see ImageCache.
+ *
  * TODO(dox): thorough documentation for Forward and proto params.
  */
 template <typename Dtype>
@@ -36,9 +41,12 @@ class ImageDataLayer : public BasePrefetchingDataLayer<Dtype> {
   shared_ptr<Caffe::RNG> prefetch_rng_;
   virtual void ShuffleImages();
   virtual void load_batch(Batch<Dtype>* batch);
+  // Reads and decodes lines_[line_id], or fetches it from the cache.
+  cv::Mat ReadImage(int line_id);
 
   vector<std::pair<std::string, int> > lines_;
   int lines_id_;
+  shared_ptr<ImageCache> cache_;
 };
 
 
@@ -28,6 +28,13 @@ class InnerProductLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "InnerProduct"; }
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  virtual inline bool AllowHalfParam(const int param_id) const {
+    return param_id == 0;
+  }
+  virtual inline bool AllowHalfActivations() const { return true; }
+  virtual inline size_t ShrinkToFit() {
+    return bias_multiplier_.ShrinkToFit();
+  }
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
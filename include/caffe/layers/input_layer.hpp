@@ -29,6 +29,7 @@ class InputLayer : public Layer<Dtype> {
       const vector<Blob<Dtype>*>& top) {}
 
   virtual inline const char* type() const { return "Input"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
   virtual inline int ExactNumBottomBlobs() const { return 0; }
   virtual inline int MinTopBlobs() const { return 1; }
 
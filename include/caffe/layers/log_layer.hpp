@@ -33,6 +33,7 @@ class LogLayer : public NeuronLayer<Dtype> {
       const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "Log"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
 
  protected:
   /**
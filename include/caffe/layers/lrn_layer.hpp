@@ -32,6 +32,17 @@ class LRNLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "LRN"; }
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  /// The scale of normalization across channels, or the outputs of the
+  /// layers normalizing within channels, whose inputs share the bottom.
+  virtual inline size_t WorkspaceBytes() const {
+    return this->BufferBytes(scale_) + this->BufferBytes(square_output_) +
+        this->BufferBytes(pool_output_) + this->BufferBytes(power_output_);
+  }
+  virtual inline size_t ShrinkToFit() {
+    return scale_.ShrinkToFit() + square_input_.ShrinkToFit() +
+        square_output_.ShrinkToFit() + pool_output_.ShrinkToFit() +
+        power_output_.ShrinkToFit() + product_input_.ShrinkToFit();
+  }
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
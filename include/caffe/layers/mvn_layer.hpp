@@ -25,6 +25,10 @@ class MVNLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "MVN"; }
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  virtual inline size_t ShrinkToFit() {
+    return mean_.ShrinkToFit() + variance_.ShrinkToFit() +
+        temp_.ShrinkToFit() + sum_multiplier_.ShrinkToFit();
+  }
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -25,8 +25,19 @@ class PoolingLayer : public Layer<Dtype> {
       const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "Pooling"; }
+  // Not with the mask top, whose indices half precision would not hold.
+  virtual inline bool AllowHalfActivations() const {
+    return this->layer_param_.top_size() == 1;
+  }
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int MinTopBlobs() const { return 1; }
+  /// The mask of max pooling, or the indices of stochastic pooling.
+  virtual inline size_t WorkspaceBytes() const {
+    return this->BufferBytes(max_idx_) + this->BufferBytes(rand_idx_);
+  }
+  virtual inline size_t ShrinkToFit() {
+    return max_idx_.ShrinkToFit() + rand_idx_.ShrinkToFit();
+  }
   // MAX POOL layers can output an extra top blob for the mask;
   // others can only output the pooled inputs.
   virtual inline int MaxTopBlobs() const {
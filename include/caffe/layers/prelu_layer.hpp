@@ -40,6 +40,11 @@ class PReLULayer : public NeuronLayer<Dtype> {
       const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "PReLU"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
+  virtual inline size_t ShrinkToFit() {
+    return multiplier_.ShrinkToFit() + backward_buff_.ShrinkToFit() +
+        bottom_memory_.ShrinkToFit();
+  }
 
  protected:
   /**
@@ -38,6 +38,9 @@ class PythonLayer : public Layer<Dtype> {
     return this->layer_param_.python_param().share_in_parallel();
   }
 
+  // The shapes may depend on anything the Python layer holds.
+  virtual inline bool ReshapesFromBottomShapes() const { return false; }
+
   virtual inline const char* type() const { return "Python"; }
 
  protected:
@@ -28,6 +28,8 @@ class ReLULayer : public NeuronLayer<Dtype> {
       : NeuronLayer<Dtype>(param) {}
 
   virtual inline const char* type() const { return "ReLU"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
+  virtual inline bool AllowHalfActivations() const { return true; }
 
  protected:
   /**
@@ -37,6 +37,11 @@ class ScaleLayer: public Layer<Dtype> {
   virtual inline int MinBottomBlobs() const { return 1; }
   virtual inline int MaxBottomBlobs() const { return 2; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  virtual inline size_t ShrinkToFit() {
+    return (bias_layer_ ? bias_layer_->ShrinkToFit() : 0) +
+        sum_multiplier_.ShrinkToFit() + sum_result_.ShrinkToFit() +
+        temp_.ShrinkToFit();
+  }
 
  protected:
   /**
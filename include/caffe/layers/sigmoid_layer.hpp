@@ -26,6 +26,7 @@ class SigmoidLayer : public NeuronLayer<Dtype> {
       : NeuronLayer<Dtype>(param) {}
 
   virtual inline const char* type() const { return "Sigmoid"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
 
  protected:
   /**
@@ -60,6 +60,9 @@ class SoftmaxWithLossLayer : public LossLayer<Dtype> {
 
   virtual inline const char* type() const { return "SoftmaxWithLoss"; }
   virtual inline int ExactNumTopBlobs() const { return -1; }
+  virtual inline size_t ShrinkToFit() {
+    return softmax_layer_->ShrinkToFit() + prob_.ShrinkToFit();
+  }
   virtual inline int MinTopBlobs() const { return 1; }
   virtual inline int MaxTopBlobs() const { return 2; }
 
@@ -24,6 +24,8 @@ class SplitLayer : public Layer<Dtype> {
       const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "Split"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
+  virtual inline bool AllowHalfActivations() const { return true; }
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int MinTopBlobs() const { return 1; }
 
@@ -37,7 +39,7 @@ class SplitLayer : public Layer<Dtype> {
   virtual void Backward_gpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
 
-  int count_;
+  int64_t count_;
 };
 
 }  // namespace caffe
@@ -30,6 +30,7 @@ class ThresholdLayer : public NeuronLayer<Dtype> {
       const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "Threshold"; }
+  virtual inline bool AllowLargeBlobs() const { return true; }
 
  protected:
   /**
@@ -18,6 +18,10 @@ namespace caffe {
  * @brief Provides data to the Net from windows of images files, specified
  *        by a window data file.
  *
+ * The windows of a batch are grouped by image, so that each image is decoded
+ * once per batch, and window_data_param.threads threads decode the images
+ * and warp their windows in parallel.
+ *
  * TODO(dox): thorough documentation for Forward and proto params.
  */
 template <typename Dtype>
@@ -37,6 +41,13 @@ class WindowDataLayer : public BasePrefetchingDataLayer<Dtype> {
   virtual unsigned int PrefetchRand();
   virtual void load_batch(Batch<Dtype>* batch);
 
+  class WindowBatch;
+  // Loads images of work and warps their windows, until all are claimed.
+  void LoadWindows(WindowBatch* work);
+  // Crops window out of cv_img, warps it and writes it to item item_id.
+  void WarpWindow(const cv::Mat& cv_img, const vector<float>& window,
+      bool do_mirror, int item_id, Dtype* top_data);
+
   shared_ptr<Caffe::RNG> prefetch_rng_;
   vector<std::pair<std::string, vector<int> > > image_database_;
   enum WindowField { IMAGE_INDEX, LABEL, OVERLAP, X1, Y1, X2, Y2, NUM };
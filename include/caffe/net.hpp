@@ -1,6 +1,7 @@
 #ifndef CAFFE_NET_HPP_
 #define CAFFE_NET_HPP_
 
+#include <list>
 #include <map>
 #include <set>
 #include <string>
@@ -11,6 +12,9 @@
 #include "caffe/common.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/profiler.hpp"
+#include "caffe/util/raw_model.hpp"
+#include "caffe/util/task_scheduler.hpp"
 
 namespace caffe {
 
@@ -30,7 +34,34 @@ class Net {
   virtual ~Net() {}
 
   /// @brief Initialize a network with a NetParameter.
-  void Init(const NetParameter& param);
+  void Init(const NetParameter& param) { Init(param, NULL); }
+
+  /**
+   * @brief Creates an inference-only net running the same layers, sharing
+   *        the parameters of this net and allocating its own blobs, e.g. to
+   *        serve requests on several threads at once.
+   *
+   * The clone reuses the filtered layers of this net with their splits, and
+   * its layers skip filling their parameters, so that creating it costs
+   * little more than setting up its blobs. Parameters updated in either net
+   * are seen by both, and must not be updated while the clone runs. The
+   * clone runs its layers in the TEST phase, even those of a TRAIN net.
+   */
+  shared_ptr<Net<Dtype> > CloneForInference() const;
+  /**
+   * @brief Returns an inference clone of this net, see CloneForInference,
+   *        whose input blobs have the given shapes, in the order of
+   *        input_blobs, and whose layers are already reshaped for them.
+   *
+   * The clones of the last NetParameter.inference_shapes input shapes are
+   * kept, so that switching between a few input sizes reshapes nothing and
+   * allocates nothing: fill the input blobs of the clone and run its
+   * Forward. The clones reshape their layers only when their bottoms change,
+   * see set_reshape_on_change, and so must keep the shapes they are given.
+   * Not thread safe.
+   */
+  shared_ptr<Net<Dtype> > InferenceNetForShapes(
+      const vector<vector<int> >& input_shapes);
 
   /**
    * @brief Run Forward and return the result.
@@ -79,9 +110,72 @@ class Net {
    * @brief Reshape all layers from bottom to top.
    *
    * This is useful to propagate changes to layer sizes without running
-   * a forward pass, e.g. to compute output feature size.
+   * a forward pass, e.g. to compute output feature size. With
+   * set_reshape_on_change, only the layers whose bottoms changed reshape.
+   * To switch between a few input shapes without reshaping, see
+   * InferenceNetForShapes.
    */
   void Reshape();
+  /**
+   * @brief Reallocates the blobs, the parameters and the buffers of the
+   *        layers of the net, such as the columns of convolutions, to their
+   *        current sizes, e.g. after a Reshape back from a spike of the input
+   *        size, and returns the bytes released; see Layer::ShrinkToFit.
+   *        They go back to the host allocator, whose cache
+   *        Caffe::host_allocator()->EmptyCache() empties.
+   */
+  size_t ShrinkToFit();
+  /**
+   * @brief Stores the parameters that layers can run forward with in half
+   *        precision, such as the weights of InnerProduct and Convolution
+   *        layers, and returns the bytes released; see Blob::StoreAsHalf.
+   *
+   * For inference-only nets running on the CPU, once their weights are
+   * loaded. InnerProduct layers convert the weights back by blocks as they
+   * read them, accumulating in full precision, so that they read half the
+   * bytes. Convolution layers convert all their weights into a full
+   * precision buffer on each Forward, reported by Layer::WorkspaceBytes, so
+   * that they only hold half the bytes between passes. A clone, see
+   * CloneForInference, leaves the weights it shares with its source as they
+   * are: converting those of the source converts them for both.
+   */
+  size_t StoreWeightsAsHalf();
+  /**
+   * @brief Stores the activations between layers that can run forward on
+   *        them in half precision, such as Convolution, InnerProduct,
+   *        Pooling, ReLU, Concat and Split layers, and returns the bytes
+   *        released; see Blob::AllocateAsHalf.
+   *
+   * For inference-only nets running on the CPU. The inputs and outputs of
+   * the net, and the blobs any other layer reads or writes, stay in full
+   * precision. The layers convert their bottoms and tops by blocks, such as
+   * an image, computing in full precision.
+   */
+  size_t StoreActivationsAsHalf();
+
+  /// @brief The bytes of memory of a layer; see MemoryFootprint.
+  struct LayerMemory {
+    /// The data of the tops the layer creates.
+    size_t activation_bytes;
+    /// The data of the parameters the layer owns.
+    size_t param_bytes;
+    /// The diffs of those tops and parameters.
+    size_t diff_bytes;
+    /// The buffers of the layer; see Layer::WorkspaceBytes.
+    size_t workspace_bytes;
+  };
+  /**
+   * @brief Returns the bytes of memory each layer holds at the current
+   *        capacity of its blobs, counting the blobs sharing memory, such as
+   *        in-place tops, the tops of Split layers and shared parameters,
+   *        once, for the first layer holding them.
+   *
+   * Blobs count at their capacity, rounded up as the host allocator does in
+   * CPU mode, whether or not they have been allocated yet, so that the
+   * footprint of a model at a batch size can be told without running it;
+   * see NetParameter.memory_budget.
+   */
+  vector<LayerMemory> MemoryFootprint() const;
 
   Dtype ForwardBackward() {
     Dtype loss;
@@ -115,6 +209,21 @@ class Net {
   void CopyTrainedLayersFrom(const string trained_filename);
   void CopyTrainedLayersFromBinaryProto(const string trained_filename);
   void CopyTrainedLayersFromHDF5(const string trained_filename);
+  /**
+   * @brief Copies the pre-trained layers from a RawModel file, as written by
+   *        WriteRawModel, or if map is set and it holds elements of type Dtype,
+   *        points the parameter blobs at its mapping without copying them.
+   *        CopyTrainedLayersFrom maps files with the ".raw" extension.
+   */
+  void CopyTrainedLayersFromRaw(const string trained_filename,
+      bool map = true);
+  /**
+   * @brief For a net in the TEST phase, points the parameter blobs at a
+   *        read-only shared mapping of a RawModel file of elements of type
+   *        Dtype, so that processes loading the same file share one copy of
+   *        the weights. The weights must not be written thereafter.
+   */
+  void ShareTrainedLayersFromRaw(const string trained_filename);
   /// @brief Writes the net to a proto.
   void ToProto(NetParameter* param, bool write_diff = false) const;
   /// @brief Writes the net to an HDF5 file.
@@ -195,6 +304,14 @@ class Net {
   inline const vector<string>& param_display_names() const {
     return param_display_names_;
   }
+  /// @brief returns the (layer, param) indices of each of params()
+  inline const vector<pair<int, int> >& param_layer_indices() const {
+    return param_layer_indices_;
+  }
+  /// @brief returns the index in learnable_params() of each of params()
+  inline const vector<int>& learnable_param_ids() const {
+    return learnable_param_ids_;
+  }
   /// @brief Input and output blob numbers
   inline int num_inputs() const { return net_input_blobs_.size(); }
   inline int num_outputs() const { return net_output_blobs_.size(); }
@@ -217,6 +334,90 @@ class Net {
 
   void set_debug_info(const bool value) { debug_info_ = value; }
 
+  /**
+   * @brief Hook run with the index of each layer before or after the layer
+   *        runs forward or backward, whether or not the layer computes
+   *        anything.
+   *
+   * Backward runs from the top layer down and a shared parameter is owned by
+   * the lowest of its layers, so after backward of layer i the gradients of
+   * the parameters owned by layers i and above are complete. A synchronizer
+   * can therefore start reducing them while the layers below compute.
+   */
+  class Callback {
+   protected:
+    virtual void run(int layer) = 0;
+
+    template <typename T>
+    friend class Net;
+  };
+  const vector<Callback*>& before_forward() const { return before_forward_; }
+  void add_before_forward(Callback* value) {
+    before_forward_.push_back(value);
+  }
+  const vector<Callback*>& after_forward() const { return after_forward_; }
+  void add_after_forward(Callback* value) {
+    after_forward_.push_back(value);
+  }
+  const vector<Callback*>& before_backward() const { return before_backward_; }
+  void add_before_backward(Callback* value) {
+    before_backward_.push_back(value);
+  }
+  const vector<Callback*>& after_backward() const { return after_backward_; }
+  void add_after_backward(Callback* value) {
+    after_backward_.push_back(value);
+  }
+
+  /**
+   * @brief Starts counting the calls and time of the forward and backward
+   *        passes of each layer, and recording each call in a trace if trace
+   *        is set. Counts are kept while profiling is disabled, and resume
+   *        when it is enabled again, until the profiler is reset.
+   */
+  void EnableProfiling(bool trace = false);
+  void DisableProfiling() { profiling_ = false; }
+  inline bool profiling() const { return profiling_; }
+  /// @brief Whether the net only runs forward and its blobs have no diffs.
+  inline bool inference_only() const { return inference_only_; }
+  /**
+   * @brief Sets the number of threads running the layers of Forward; see
+   *        NetParameter.forward_threads.
+   *
+   * A layer runs once the last layers before it writing its bottoms or tops,
+   * and those reading its tops since, have run, counting the blobs sharing
+   * memory, such as the tops of a Split layer, as one blob: in-place layers
+   * thus keep the semantics of the sequential order. Layers run in order in
+   * the first whole pass, which shows the blobs sharing memory, in GPU mode,
+   * with debug info, or when forward callbacks are set, and layers
+   * drawing random numbers draw them from the generator of their thread.
+   */
+  void set_forward_threads(int threads);
+  inline int forward_threads() const { return forward_threads_; }
+  /// @brief The earlier layers each layer runs after when Forward runs them
+  ///        concurrently, empty until a first pass in order.
+  inline const vector<vector<int> >& layer_dependencies() const {
+    return layer_dependencies_;
+  }
+  /// @brief The NUMA node the net binds the calling thread to while it
+  ///        runs, or -1; see NetParameter.numa_node.
+  inline int numa_node() const { return numa_node_; }
+  /**
+   * @brief Sets whether Reshape and Forward reshape only the layers whose
+   *        bottoms changed shape or memory since they last reshaped; see
+   *        NetParameter.reshape_on_change.
+   */
+  void set_reshape_on_change(bool reshape_on_change);
+  inline bool reshape_on_change() const { return reshape_on_change_; }
+  /**
+   * @brief Sets the number of input shapes InferenceNetForShapes keeps a
+   *        clone for, dropping those it keeps; see
+   *        NetParameter.inference_shapes.
+   */
+  void set_inference_shapes(int shapes);
+  inline int inference_shapes() const { return inference_shapes_; }
+  /// @brief returns the profiler, NULL until profiling is first enabled
+  inline const shared_ptr<Profiler>& profiler() const { return profiler_; }
+
   // Helpers for Init.
   /**
    * @brief Remove layers that the user specified should be excluded given the current
@@ -229,6 +430,12 @@ class Net {
       const string& layer_name);
 
  protected:
+  /// @brief Creates a net for CloneForInference, sharing the parameters of
+  ///        source.
+  Net(const NetParameter& param, const Net& source);
+  /// @brief Initializes the net, from the filtered layers with splits of
+  ///        source if set, sharing its parameters.
+  void Init(const NetParameter& in_param, const Net* source);
   // Helpers for Init.
   /// @brief Append a new top blob to the net.
   void AppendTop(const NetParameter& param, const int layer_id,
@@ -248,9 +455,23 @@ class Net {
   void BackwardDebugInfo(const int layer_id);
   /// @brief Helper for displaying debug info in Update.
   void UpdateDebugInfo(const int param_id);
+  /// @brief Copies the pre-trained layers from model, or maps them if map.
+  void LoadRawModel(shared_ptr<RawModel> model, bool map);
+  /// @brief Computes layer_dependencies_ from the blobs of the layers, as
+  ///        shared after a forward pass.
+  void InitLayerDependencies();
+  /// @brief Fails unless the memory footprint of the net is within budget
+  ///        bytes.
+  void CheckMemoryBudget(uint64_t budget) const;
+  /// @brief Runs the layers from start to end on forward_scheduler_.
+  Dtype ForwardConcurrently(int start, int end);
+  /// @brief Runs layer start + i forward, storing its loss in losses[i].
+  void ForwardLayer(int start, Dtype* losses, int i);
 
   /// @brief The network name
   string name_;
+  /// @brief The filtered layers with splits, without their blobs.
+  NetParameter split_param_;
   /// @brief The phase: TRAIN or TEST
   Phase phase_;
   /// @brief Individual layers in the net
@@ -306,8 +527,36 @@ class Net {
   size_t memory_used_;
   /// Whether to compute and display debug info for the net.
   bool debug_info_;
+  /// Whether the net only runs forward; see NetParameter.inference_only.
+  bool inference_only_;
+  /// Whether the parameters are those of the net this one is a clone of.
+  bool params_shared_;
+  /// The threads running Forward, and the scheduler of the threads, started
+  /// by the first Forward needing them.
+  int forward_threads_;
+  shared_ptr<TaskScheduler> forward_scheduler_;
+  /// The NUMA node the net runs on; see NetParameter.numa_node.
+  int numa_node_;
+  /// Whether the layers reshape only when their bottoms change.
+  bool reshape_on_change_;
+  /// The clones of InferenceNetForShapes by input shapes, the most recently
+  /// used first, and how many it keeps.
+  std::list<std::pair<vector<vector<int> >, shared_ptr<Net> > >
+      inference_clones_;
+  int inference_shapes_;
+  /// The earlier layers each layer must run after in Forward, empty until
+  /// a first pass in order.
+  vector<vector<int> > layer_dependencies_;
   /// The root net that actually holds the shared layers in data parallelism
   const Net* const root_net_;
+  vector<Callback*> before_forward_;
+  vector<Callback*> after_forward_;
+  vector<Callback*> before_backward_;
+  vector<Callback*> after_backward_;
+  bool profiling_;
+  shared_ptr<Profiler> profiler_;
+  /// The raw models parameter blobs point into, kept mapped for them.
+  vector<shared_ptr<RawModel> > raw_models_;
   DISABLE_COPY_AND_ASSIGN(Net);
 };
 
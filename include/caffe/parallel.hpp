@@ -13,6 +13,9 @@
 #include "caffe/solver.hpp"
 #include "caffe/syncedmem.hpp"
 #include "caffe/util/blocking_queue.hpp"
+#include "caffe/util/socket.hpp"
+
+namespace boost { class barrier; }
 
 namespace caffe {
 
@@ -59,6 +62,26 @@ class GPUParams : public Params<Dtype> {
   using Params<Dtype>::diff_;
 };
 
+// Params stored in host memory. Params created from a parent share its data
+// buffer, so that all solvers read the same parameters, and only own their
+// gradient.
+template<typename Dtype>
+class CPUParams : public Params<Dtype> {
+ public:
+  CPUParams(shared_ptr<Solver<Dtype> > root_solver,
+            const CPUParams<Dtype>* parent);
+  virtual ~CPUParams();
+
+  void configure(Solver<Dtype>* solver) const;
+
+ protected:
+  const bool owns_data_;
+
+  using Params<Dtype>::size_;
+  using Params<Dtype>::data_;
+  using Params<Dtype>::diff_;
+};
+
 class DevicePair {
  public:
   DevicePair(int parent, int device)
@@ -116,6 +139,100 @@ class P2PSync : public GPUParams<Dtype>, public Solver<Dtype>::Callback,
   using Params<Dtype>::diff_;
 };
 
+// Synchronous data parallelism between CPU threads. The solvers share the
+// parameters of the root solver and compute gradients on their share of the
+// batch. Their gradients are then summed in shared memory, each thread
+// reducing one slice of the buffers into the root solver's, before the root
+// solver applies a single update.
+template<typename Dtype>
+class CPUSync : public CPUParams<Dtype>, public Solver<Dtype>::Callback,
+    public InternalThread {
+ public:
+  explicit CPUSync(shared_ptr<Solver<Dtype> > root_solver,
+                   CPUSync<Dtype>* root, int rank,
+                   const SolverParameter& param);
+  virtual ~CPUSync();
+
+  inline const shared_ptr<Solver<Dtype> >& solver() const {
+    return solver_;
+  }
+
+  // Trains with the given number of solvers, the root one running on the
+  // calling thread. Data layers shared in parallel split their data among
+  // Caffe::solver_count() solvers, set when the root solver was created.
+  void Run(int threads);
+  inline const int initial_iter() const { return initial_iter_; }
+
+ protected:
+  void on_start();
+  void on_gradients_ready();
+
+  void InternalThreadEntry();
+
+  CPUSync<Dtype>* root_;
+  const int rank_;
+  // Set on the root only, the syncs of all solvers indexed by rank and the
+  // barrier they meet at.
+  vector<CPUSync<Dtype>*> syncs_;
+  shared_ptr<boost::barrier> barrier_;
+  const int initial_iter_;
+  shared_ptr<Solver<Dtype> > solver_;
+
+  using Params<Dtype>::size_;
+  using Params<Dtype>::data_;
+  using Params<Dtype>::diff_;
+};
+
+// Synchronous data parallelism between processes, possibly on different
+// hosts, connected in a SocketRing. The parameters of rank 0 are broadcast at
+// construction; then the gradients are summed with a ring all-reduce and
+// averaged, so that every process applies the same update to its own copy of
+// the parameters. With iter_size 1, the gradients of the top layers are
+// reduced on a background thread while the layers below run backward.
+template<typename Dtype>
+class RingSync : public CPUParams<Dtype>, public Solver<Dtype>::Callback,
+    public Net<Dtype>::Callback, public InternalThread {
+ public:
+  // addresses lists the processes of the ring, as host:port or unix:path,
+  // rank is the index of this one.
+  RingSync(shared_ptr<Solver<Dtype> > solver, const vector<string>& addresses,
+           int rank);
+  virtual ~RingSync();
+
+  inline const shared_ptr<Solver<Dtype> >& solver() const {
+    return solver_;
+  }
+  inline const SocketRing<Dtype>& ring() const {
+    return ring_;
+  }
+
+  void Run();
+
+ protected:
+  void on_start() {}
+  // Net::Callback after backward of a layer
+  void run(int layer);
+  void on_gradients_ready();
+
+  void InternalThreadEntry();
+
+  shared_ptr<Solver<Dtype> > solver_;
+  SocketRing<Dtype> ring_;
+  // Offset in the buffers from which the gradients are complete after
+  // backward of each layer.
+  vector<size_t> ready_offsets_;
+  // Lowest offset queued for reduction in the current iteration.
+  size_t queued_;
+  // Offsets from which gradients are ready, for the reducing thread, and
+  // signal that all are reduced.
+  BlockingQueue<size_t> ready_;
+  BlockingQueue<size_t> reduced_;
+
+  using Params<Dtype>::size_;
+  using Params<Dtype>::data_;
+  using Params<Dtype>::diff_;
+};
+
 }  // namespace caffe
 
 #endif
@@ -5,9 +5,34 @@
 #include <vector>
 
 #include "caffe/solver.hpp"
+#include "caffe/util/math_functions.hpp"
 
 namespace caffe {
 
+// Minimum number of parameter elements updated by a thread in the fused CPU
+// updates.
+const int kFusedUpdateGrain = 1 << 16;
+
+/**
+ * @brief The gradient of one parameter element as left by
+ *        SGDSolver::Normalize and SGDSolver::Regularize, for the fused CPU
+ *        updates.
+ */
+template <typename Dtype>
+struct RegularizedGradient {
+  Dtype normalization;
+  Dtype decay;
+  bool l1;
+
+  inline Dtype operator()(Dtype diff, Dtype data) const {
+    Dtype g = diff * normalization;
+    if (decay) {
+      g += decay * (l1 ? Dtype(caffe_sign(data)) : data);
+    }
+    return g;
+  }
+};
+
 /**
  * @brief Optimizes the parameters of a Net using
  *        stochastic gradient descent (SGD) with momentum.
@@ -31,7 +56,17 @@ class SGDSolver : public Solver<Dtype> {
   virtual void Regularize(int param_id);
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
   virtual void ClipGradients();
+  // Whether FusedUpdate implements the update of this solver. Solvers
+  // deriving from SGDSolver take the separate steps unless they override it.
+  virtual bool has_fused_update() const;
+  // Normalizes, regularizes and computes the update value of param_id and
+  // subtracts it from the data, in one multi-threaded pass over the CPU
+  // buffers. The diff is left holding the update value, as with the
+  // separate steps.
+  virtual void FusedUpdate(int param_id, Dtype rate);
+  RegularizedGradient<Dtype> GetRegularizedGradient(int param_id);
   virtual void SnapshotSolverState(const string& model_filename);
+  virtual bool SolverStateToProto(SolverState* state);
   virtual void SnapshotSolverStateToBinaryProto(const string& model_filename);
   virtual void SnapshotSolverStateToHDF5(const string& model_filename);
   virtual void RestoreSolverStateFromHDF5(const string& state_file);
@@ -91,6 +126,8 @@ class RMSPropSolver : public SGDSolver<Dtype> {
 
  protected:
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
+  virtual bool has_fused_update() const;
+  virtual void FusedUpdate(int param_id, Dtype rate);
   void constructor_sanity_check() {
     CHECK_EQ(0, this->param_.momentum())
         << "Momentum cannot be used with RMSProp.";
@@ -139,6 +176,8 @@ class AdamSolver : public SGDSolver<Dtype> {
  protected:
   void AdamPreSolve();
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
+  virtual bool has_fused_update() const;
+  virtual void FusedUpdate(int param_id, Dtype rate);
 
   DISABLE_COPY_AND_ASSIGN(AdamSolver);
 };
@@ -7,6 +7,8 @@
 #include "caffe/net.hpp"
 #include "caffe/solver_factory.hpp"
 
+namespace boost { class thread; }
+
 namespace caffe {
 
 /**
@@ -64,9 +66,13 @@ class Solver {
   // The Solver::Snapshot function implements the basic snapshotting utility
   // that stores the learned net. You should implement the SnapshotSolverState()
   // function that produces a SolverState protocol buffer that needs to be
-  // written to disk together with the learned net.
+  // written to disk together with the learned net. With snapshot_async, and
+  // a solver implementing SolverStateToProto, it only copies them and
+  // returns while a background thread writes them.
   void Snapshot();
-  virtual ~Solver() {}
+  // Waits until the asynchronous snapshot in progress, if any, is written.
+  void WaitForSnapshot();
+  virtual ~Solver();
   inline const SolverParameter& param() const { return param_; }
   inline shared_ptr<Net<Dtype> > net() { return net_; }
   inline const vector<shared_ptr<Net<Dtype> > >& test_nets() {
@@ -104,6 +110,10 @@ class Solver {
   void TestAll();
   void Test(const int test_net_id = 0);
   virtual void SnapshotSolverState(const string& model_filename) = 0;
+  // Fills state with what SnapshotSolverState writes in binary proto format,
+  // except learned_net, for an asynchronous snapshot. Returns false if the
+  // solver does not support it, in which case snapshots are synchronous.
+  virtual bool SolverStateToProto(SolverState* state) { return false; }
   virtual void RestoreSolverStateFromHDF5(const string& state_file) = 0;
   virtual void RestoreSolverStateFromBinaryProto(const string& state_file) = 0;
   void DisplayOutputBlobs(const int net_id);
@@ -131,6 +141,9 @@ class Solver {
   // True iff a request to stop early was received.
   bool requested_early_exit_;
 
+  // Writes the asynchronous snapshot in progress.
+  shared_ptr<boost::thread> snapshot_thread_;
+
   DISABLE_COPY_AND_ASSIGN(Solver);
 };
 
@@ -4,6 +4,7 @@
 #include <cstdlib>
 
 #include "caffe/common.hpp"
+#include "caffe/host_allocator.hpp"
 
 namespace caffe {
 
@@ -12,6 +13,7 @@ namespace caffe {
 // The improvement in performance seems negligible in the single GPU case,
 // but might be more significant for parallel training. Most importantly,
 // it improved stability for large models on many GPUs.
+// In CPU mode, memory comes from Caffe::host_allocator().
 inline void CaffeMallocHost(void** ptr, size_t size, bool* use_cuda) {
 #ifndef CPU_ONLY
   if (Caffe::mode() == Caffe::GPU) {
@@ -20,19 +22,28 @@ inline void CaffeMallocHost(void** ptr, size_t size, bool* use_cuda) {
     return;
   }
 #endif
-  *ptr = malloc(size);
+  *ptr = Caffe::host_allocator()->Allocate(size);
   *use_cuda = false;
-  CHECK(*ptr) << "host allocation of size " << size << " failed";
 }
 
-inline void CaffeFreeHost(void* ptr, bool use_cuda) {
+inline void CaffeFreeHost(void* ptr, size_t size, bool use_cuda) {
 #ifndef CPU_ONLY
   if (use_cuda) {
     CUDA_CHECK(cudaFreeHost(ptr));
     return;
   }
 #endif
-  free(ptr);
+  Caffe::host_allocator()->Free(ptr, size);
+}
+
+// The bytes CaffeMallocHost takes for size bytes, which a caching
+// Caffe::host_allocator() rounds up to its bucket.
+inline size_t CaffeHostBytes(size_t size) {
+  if (Caffe::mode() == Caffe::CPU &&
+      dynamic_cast<CachingHostAllocator*>(Caffe::host_allocator())) {
+    return CachingHostAllocator::BucketSize(size);
+  }
+  return size;
 }
 
 
@@ -61,7 +72,7 @@ class SyncedMemory {
   void* mutable_gpu_data();
   enum SyncedHead { UNINITIALIZED, HEAD_AT_CPU, HEAD_AT_GPU, SYNCED };
   SyncedHead head() { return head_; }
-  size_t size() { return size_; }
+  size_t size() const { return size_; }
 
 #ifndef CPU_ONLY
   void async_gpu_push(const cudaStream_t& stream);
@@ -13,6 +13,24 @@ inline std::string format_int(int n, int numberOfLeadingZeros = 0 ) {
   return s.str();
 }
 
+// Quotes s as a JSON string.
+inline std::string format_json_string(const std::string& s) {
+  std::ostringstream out;
+  out << '"';
+  for (int i = 0; i < s.size(); ++i) {
+    if (s[i] == '"' || s[i] == '\\') {
+      out << '\\' << s[i];
+    } else if (static_cast<unsigned char>(s[i]) < 0x20) {
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+          << static_cast<int>(s[i]) << std::dec;
+    } else {
+      out << s[i];
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
 }
 
 #endif   // CAFFE_UTIL_FORMAT_H_
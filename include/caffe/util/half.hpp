@@ -0,0 +1,34 @@
+#ifndef CAFFE_UTIL_HALF_H_
+#define CAFFE_UTIL_HALF_H_
+
+#include <stdint.h>
+
+#include "caffe/util/mkl_alternate.hpp"
+
+namespace caffe {
+
+// Conversions between Dtype and IEEE half precision, stored as uint16_t,
+// rounding to the nearest even. They use the F16C instructions when built for
+// a CPU having them, e.g. with -mf16c or -march=native.
+template <typename Dtype>
+void caffe_cpu_to_half(const int64_t n, const Dtype* x, uint16_t* y);
+
+template <typename Dtype>
+void caffe_cpu_from_half(const int64_t n, const uint16_t* x, Dtype* y);
+
+// Elements converted at once by the functions working by blocks, a block
+// fitting in the L2 cache.
+const int kHalfBlockSize = 16384;
+
+// C = alpha * A * op(B) + beta * C, as caffe_cpu_gemm with CblasNoTrans for A,
+// where B is stored in half precision. B is converted by blocks of its rows,
+// so that it is read once from memory and only a block, held in cache, is in
+// full precision at once.
+template <typename Dtype>
+void caffe_cpu_gemm_half_b(const CBLAS_TRANSPOSE TransB, const int M,
+    const int N, const int K, const Dtype alpha, const Dtype* A,
+    const uint16_t* B, const Dtype beta, Dtype* C);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_HALF_H_
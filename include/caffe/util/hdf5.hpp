@@ -2,6 +2,7 @@
 #define CAFFE_UTIL_HDF5_H_
 
 #include <string>
+#include <vector>
 
 #include "hdf5.h"
 #include "hdf5_hl.h"
@@ -10,6 +11,28 @@
 
 namespace caffe {
 
+/**
+ * @brief Holds, while in scope, the lock serializing the use of the HDF5
+ *        library, which its default build does not make thread-safe.
+ *
+ * Data layers, output layers, nets and solver snapshots may use the library
+ * from different threads, so every use takes it, from the opening of a file
+ * to its closing; the functions below take it too. It can be taken again by
+ * the thread holding it.
+ */
+class HDF5Lock {
+ public:
+  HDF5Lock();
+  ~HDF5Lock();
+
+ private:
+  DISABLE_COPY_AND_ASSIGN(HDF5Lock);
+};
+
+// Verifies the format of a dataset and returns its dimensions.
+std::vector<hsize_t> hdf5_get_nd_dataset_dims(
+    hid_t file_id, const char* dataset_name_, int min_dim, int max_dim);
+
 template <typename Dtype>
 void hdf5_load_nd_dataset_helper(
     hid_t file_id, const char* dataset_name_, int min_dim, int max_dim,
@@ -20,6 +43,14 @@ void hdf5_load_nd_dataset(
     hid_t file_id, const char* dataset_name_, int min_dim, int max_dim,
     Blob<Dtype>* blob);
 
+// Loads num_rows rows of a dataset starting at row_start, i.e. a hyperslab
+// along its first axis, or all the rows from row_start if num_rows is 0.
+// Returns the number of rows of the whole dataset.
+template <typename Dtype>
+hsize_t hdf5_load_nd_dataset_rows(
+    hid_t file_id, const char* dataset_name_, int min_dim, int max_dim,
+    hsize_t row_start, hsize_t num_rows, Blob<Dtype>* blob);
+
 template <typename Dtype>
 void hdf5_save_nd_dataset(
     const hid_t file_id, const string& dataset_name, const Blob<Dtype>& blob,
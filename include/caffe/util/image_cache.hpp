@@ -0,0 +1,69 @@
+#ifndef CAFFE_UTIL_IMAGE_CACHE_HPP_
+#define CAFFE_UTIL_IMAGE_CACHE_HPP_
+
+#ifdef USE_OPENCV
+#include <opencv2/core/core.hpp>
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A thread-safe cache of decoded images, keyed by file name, holding
+ * at most capacity bytes of pixel data and evicting the least recently used
+ * images first.
+ *
+ * Caches are shared by key through GetShared(), so that the prefetch threads
+ * of all the layers reading the same images at the same size (e.g. one per
+ * solver in multi-GPU training) decode each image only once.
+ */
+class ImageCache {
+ public:
+  explicit ImageCache(size_t capacity);
+  ~ImageCache();
+
+  // Returns the cache registered under key, creating it if needed.
+  static shared_ptr<ImageCache> GetShared(const string& key, size_t capacity);
+
+  // Sets *image to the cached image and returns true on a hit. The returned
+  // cv::Mat shares its pixels with the cache and must not be modified.
+  bool Lookup(const string& filename, cv::Mat* image);
+  // Caches image unless it is larger than the whole capacity.
+  void Insert(const string& filename, const cv::Mat& image);
+
+  size_t capacity() const { return capacity_; }
+  size_t size() const;
+  size_t hits() const;
+  size_t misses() const;
+
+ protected:
+  typedef std::list<std::pair<string, cv::Mat> > LRUList;
+
+  static size_t ImageBytes(const cv::Mat& image) {
+    return image.total() * image.elemSize();
+  }
+
+  // Most recently used images are at the front.
+  LRUList lru_;
+  map<string, LRUList::iterator> index_;
+  const size_t capacity_;
+  size_t size_;
+  size_t hits_;
+  size_t misses_;
+
+  // Keeps boost/thread.hpp out of the header, see BlockingQueue.
+  class sync;
+  shared_ptr<sync> sync_;
+
+DISABLE_COPY_AND_ASSIGN(ImageCache);
+};
+
+}  // namespace caffe
+
+#endif  // USE_OPENCV
+#endif  // CAFFE_UTIL_IMAGE_CACHE_HPP_
@@ -16,6 +16,7 @@ extern "C" {
 #endif  // USE_ACCELERATE
 
 #include <math.h>
+#include <stdint.h>
 
 // Functions that caffe uses but are not present if MKL is not linked.
 
@@ -23,16 +24,16 @@ extern "C" {
 // be in the form e.g. y[i] = sqrt(a[i])
 #define DEFINE_VSL_UNARY_FUNC(name, operation) \
   template<typename Dtype> \
-  void v##name(const int n, const Dtype* a, Dtype* y) { \
+  void v##name(const int64_t n, const Dtype* a, Dtype* y) { \
     CHECK_GT(n, 0); CHECK(a); CHECK(y); \
-    for (int i = 0; i < n; ++i) { operation; } \
+    for (int64_t i = 0; i < n; ++i) { operation; } \
   } \
   inline void vs##name( \
-    const int n, const float* a, float* y) { \
+    const int64_t n, const float* a, float* y) { \
     v##name<float>(n, a, y); \
   } \
   inline void vd##name( \
-      const int n, const double* a, double* y) { \
+      const int64_t n, const double* a, double* y) { \
     v##name<double>(n, a, y); \
   }
 
@@ -45,16 +46,16 @@ DEFINE_VSL_UNARY_FUNC(Abs, y[i] = fabs(a[i]));
 // The operation should be in the form e.g. y[i] = pow(a[i], b)
 #define DEFINE_VSL_UNARY_FUNC_WITH_PARAM(name, operation) \
   template<typename Dtype> \
-  void v##name(const int n, const Dtype* a, const Dtype b, Dtype* y) { \
+  void v##name(const int64_t n, const Dtype* a, const Dtype b, Dtype* y) { \
     CHECK_GT(n, 0); CHECK(a); CHECK(y); \
-    for (int i = 0; i < n; ++i) { operation; } \
+    for (int64_t i = 0; i < n; ++i) { operation; } \
   } \
   inline void vs##name( \
-    const int n, const float* a, const float b, float* y) { \
+    const int64_t n, const float* a, const float b, float* y) { \
     v##name<float>(n, a, b, y); \
   } \
   inline void vd##name( \
-      const int n, const double* a, const float b, double* y) { \
+      const int64_t n, const double* a, const float b, double* y) { \
     v##name<double>(n, a, b, y); \
   }
 
@@ -64,16 +65,16 @@ DEFINE_VSL_UNARY_FUNC_WITH_PARAM(Powx, y[i] = pow(a[i], b));
 // be in the form e.g. y[i] = a[i] + b[i]
 #define DEFINE_VSL_BINARY_FUNC(name, operation) \
   template<typename Dtype> \
-  void v##name(const int n, const Dtype* a, const Dtype* b, Dtype* y) { \
+  void v##name(const int64_t n, const Dtype* a, const Dtype* b, Dtype* y) { \
     CHECK_GT(n, 0); CHECK(a); CHECK(b); CHECK(y); \
-    for (int i = 0; i < n; ++i) { operation; } \
+    for (int64_t i = 0; i < n; ++i) { operation; } \
   } \
   inline void vs##name( \
-    const int n, const float* a, const float* b, float* y) { \
+    const int64_t n, const float* a, const float* b, float* y) { \
     v##name<float>(n, a, b, y); \
   } \
   inline void vd##name( \
-      const int n, const double* a, const double* b, double* y) { \
+      const int64_t n, const double* a, const double* b, double* y) { \
     v##name<double>(n, a, b, y); \
   }
 
@@ -0,0 +1,37 @@
+#ifndef CAFFE_UTIL_NUMA_H_
+#define CAFFE_UTIL_NUMA_H_
+
+#include <cstddef>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+// NUMA topology and memory policy, through the Linux system calls so that no
+// library is needed. Elsewhere, or where the calls are not permitted, there
+// is a single node and binding fails.
+
+// The number of NUMA nodes, numbered from 0.
+int caffe_numa_nodes();
+
+// The CPUs of node, in increasing order.
+vector<int> caffe_numa_node_cpus(int node);
+
+// Makes node the preferred node of the memory the calling thread allocates
+// and, if pin, runs the thread on the CPUs of node only. Node -1 restores
+// the default policy and the CPUs the process ran on before the first
+// binding. Returns whether the system applied it.
+bool caffe_numa_bind_thread(int node, bool pin);
+
+// Makes node the preferred node of the pages within [ptr, ptr + size),
+// moving those already allocated elsewhere. The partial pages at the ends
+// are left as they are. Returns whether the system applied it.
+bool caffe_numa_bind_memory(void* ptr, size_t size, int node);
+
+// The node holding the page of ptr, allocating it if needed, or -1 if
+// unknown.
+int caffe_numa_memory_node(const void* ptr);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_NUMA_H_
@@ -0,0 +1,24 @@
+#ifndef CAFFE_UTIL_PARALLEL_FOR_H_
+#define CAFFE_UTIL_PARALLEL_FOR_H_
+
+#include <boost/function.hpp>
+
+namespace caffe {
+
+/**
+ * @brief Calls f(begin, end) on disjoint ranges covering [0, n), on up to
+ *        one thread per core, and returns when all calls have returned.
+ *
+ * The threads are kept between calls, one pool per NUMA node binding, and
+ * have the binding of the calling thread. While another thread runs on the
+ * pool, f is called on the calling thread only.
+ *
+ * Ranges hold at least grain elements, so small n runs on the calling thread
+ * only. f must be safe to call concurrently on disjoint ranges.
+ */
+void caffe_cpu_parallel_for(int n, int grain,
+    const boost::function<void(int, int)>& f);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_PARALLEL_FOR_H_
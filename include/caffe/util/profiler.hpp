@@ -0,0 +1,83 @@
+#ifndef CAFFE_UTIL_PROFILER_H_
+#define CAFFE_UTIL_PROFILER_H_
+
+#include <stdint.h>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+
+namespace boost { class mutex; }
+
+namespace caffe {
+
+/**
+ * @brief Counts the calls and time of the forward and backward passes of
+ *        each layer of a Net, and optionally records each call as an event
+ *        of a Chrome trace, viewable in chrome://tracing or Perfetto.
+ *
+ * Each thread running the net accumulates into counters of its own, so that
+ * timing a call costs two clock reads and no contended lock; stats() sums
+ * them over threads. Times are wall clock: in GPU mode they measure kernel
+ * launches rather than execution unless the layers synchronize.
+ */
+class Profiler {
+ public:
+  enum Pass { FORWARD, BACKWARD };
+
+  struct LayerStats {
+    LayerStats()
+        : forward_calls(0), backward_calls(0), forward_us(0), backward_us(0) {}
+    uint64_t forward_calls;
+    uint64_t backward_calls;
+    double forward_us;
+    double backward_us;
+  };
+
+  // Counters and trace events of one thread.
+  class ThreadStats;
+
+  // Stops recording trace events once a thread has recorded this many.
+  static const size_t kMaxTraceEvents = 1 << 20;
+
+  explicit Profiler(const vector<string>& layer_names);
+
+  inline bool trace() const { return trace_; }
+  inline void set_trace(bool value) { trace_ = value; }
+  inline const vector<string>& layer_names() const { return layer_names_; }
+
+  // Microseconds since the profiler was created.
+  int64_t Now() const;
+  // Records a call to layer that started at Now() time start.
+  void Record(int layer, Pass pass, int64_t start);
+
+  // Per layer counters, summed over the threads that ran the net.
+  vector<LayerStats> stats() const;
+  // Writes the recorded events as a Chrome trace in JSON, one track per
+  // thread.
+  void WriteTrace(std::ostream& out) const;
+  void WriteTrace(const string& filename) const;
+  // Clears the counters and the trace.
+  void Reset();
+
+ protected:
+  ThreadStats* thread_stats();
+
+  // Identifies the profiler in the threads' tables, unlike its address
+  // which may be reused.
+  const uint64_t id_;
+  const vector<string> layer_names_;
+  const int64_t start_;
+  bool trace_;
+  // Counters of every thread, guarded by mutex_.
+  vector<shared_ptr<ThreadStats> > threads_;
+  shared_ptr<boost::mutex> mutex_;
+
+  DISABLE_COPY_AND_ASSIGN(Profiler);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_PROFILER_H_
@@ -0,0 +1,71 @@
+#ifndef CAFFE_UTIL_RAW_MODEL_H_
+#define CAFFE_UTIL_RAW_MODEL_H_
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+namespace caffe {
+
+/**
+ * @brief A model file laid out to be memory mapped rather than parsed.
+ *
+ * The file holds a header, then an index, which is a binary NetParameter
+ * naming each layer and giving the shapes of its blobs but not their values,
+ * then the values of all the blobs in index order as raw arrays of a single
+ * element type, each aligned to kAlignment bytes. Opening it maps the whole
+ * file privately: pages are read from the file when first touched, are
+ * shared with other processes mapping it until written, and writes never
+ * reach the file. Blobs may point directly into the mapping, which must then
+ * outlive them. The layout is that of the host, as for a native executable.
+ *
+ * Opened read-only, the file is mapped shared and cannot be written: all the
+ * processes mapping it use the single copy in the page cache, and writes to
+ * blobs pointing into it fault.
+ */
+class RawModel {
+ public:
+  static const size_t kAlignment = 64;
+  // Element size of models in half precision, which nets copy, converting
+  // them, rather than map.
+  static const size_t kHalfSize = 2;
+
+  explicit RawModel(const string& filename, bool read_only = false);
+  ~RawModel();
+
+  const NetParameter& index() const { return index_; }
+  // Size in bytes of the elements: sizeof(float), sizeof(double) or
+  // kHalfSize.
+  size_t element_size() const { return element_size_; }
+  bool read_only() const { return read_only_; }
+  // The values of blob j of layer i of the index.
+  void* blob_data(int i, int j) const {
+    return static_cast<char*>(data_) + offsets_[i][j];
+  }
+
+ private:
+  string filename_;
+  void* data_;
+  size_t size_;
+  size_t element_size_;
+  bool read_only_;
+  NetParameter index_;
+  vector<vector<size_t> > offsets_;
+
+  DISABLE_COPY_AND_ASSIGN(RawModel);
+};
+
+// Returns whether filename names a raw model, by its ".raw" extension.
+bool IsRawModelFile(const string& filename);
+
+// Writes the layers of param that have blobs, e.g. those of a caffemodel, to
+// a raw model with elements of type Dtype, or in half precision if half.
+template <typename Dtype>
+void WriteRawModel(const NetParameter& param, const string& filename,
+    bool half = false);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_RAW_MODEL_H_
@@ -0,0 +1,98 @@
+#ifndef CAFFE_UTIL_SOCKET_H_
+#define CAFFE_UTIL_SOCKET_H_
+
+#include <boost/function.hpp>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A connected or listening stream socket, closed on destruction.
+ *
+ * Addresses are either host:port, for TCP, or unix:path, for a Unix domain
+ * socket. Errors are fatal.
+ */
+class Socket {
+ public:
+  explicit Socket(int fd) : fd_(fd) {}
+  ~Socket();
+
+  inline int fd() const { return fd_; }
+
+  // Listens for connections on address.
+  static shared_ptr<Socket> Listen(const string& address);
+  // Connects to address, retrying until a peer listens on it or timeout_ms
+  // milliseconds have passed.
+  static shared_ptr<Socket> Connect(const string& address, int timeout_ms);
+  // Waits for a connection on this listening socket.
+  shared_ptr<Socket> Accept();
+
+  void Send(const void* buffer, size_t size);
+  void Recv(void* buffer, size_t size);
+
+ protected:
+  const int fd_;
+
+  DISABLE_COPY_AND_ASSIGN(Socket);
+};
+
+/**
+ * @brief Sends send_size bytes on send_socket while receiving recv_size bytes
+ *        on recv_socket, so that peers sending to each other do not deadlock.
+ *
+ * If on_received is set, it is called with the byte range [begin, end) of
+ * each piece of the receive buffer as soon as it has arrived, while the
+ * transfer goes on. Pieces are piece_size bytes, except the last one.
+ */
+void SendRecv(Socket* send_socket, const void* send_buffer, size_t send_size,
+    Socket* recv_socket, void* recv_buffer, size_t recv_size,
+    size_t piece_size = 0,
+    const boost::function<void(size_t, size_t)>& on_received =
+        boost::function<void(size_t, size_t)>());
+
+/**
+ * @brief Processes, or threads, connected in a ring of sockets, each sending
+ *        to the next one and receiving from the previous one.
+ *
+ * Constructing a ring blocks until its neighbours have joined it.
+ */
+template <typename Dtype>
+class SocketRing {
+ public:
+  // addresses lists the members of the ring in order, rank is the index of
+  // this one.
+  SocketRing(const vector<string>& addresses, int rank, int timeout_ms = 60000);
+
+  inline int rank() const { return rank_; }
+  inline int size() const { return size_; }
+
+  // Replaces buffer by its sum over all members, with a ring reduce-scatter
+  // followed by a ring all-gather. Each member sends and receives about
+  // 2 * count elements whatever the size of the ring, in pipelined pieces.
+  void AllReduce(Dtype* buffer, size_t count);
+  // Replaces buffer by the one of the member of rank 0.
+  void Broadcast(Dtype* buffer, size_t count);
+
+ protected:
+  // Bounds of the i-th of size_ segments of a buffer of count elements.
+  inline size_t segment(int i, size_t count) const {
+    return count * i / size_;
+  }
+  void Accumulate(const Dtype* src, Dtype* dst, size_t begin, size_t end);
+
+  const int rank_;
+  const int size_;
+  shared_ptr<Socket> next_;
+  shared_ptr<Socket> prev_;
+  vector<Dtype> received_;
+
+  DISABLE_COPY_AND_ASSIGN(SocketRing);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_SOCKET_H_
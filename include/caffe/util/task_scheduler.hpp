@@ -0,0 +1,68 @@
+#ifndef CAFFE_UTIL_TASK_SCHEDULER_H_
+#define CAFFE_UTIL_TASK_SCHEDULER_H_
+
+#include <boost/function.hpp>
+
+#include <deque>
+#include <vector>
+
+#include "caffe/common.hpp"
+
+namespace boost {
+class condition_variable;
+class mutex;
+class thread_group;
+}
+
+namespace caffe {
+
+/**
+ * @brief Runs graphs of dependent tasks on a persistent pool of threads.
+ *
+ * The thread calling Run takes part in it, so a scheduler of n threads starts
+ * n - 1 helpers, which wait for work between runs with the device, Caffe
+ * mode, solver count, root solver flag and NUMA node of the thread that
+ * created the scheduler. A thread finishing a task goes on with one of the
+ * tasks it made ready, to keep their inputs in its cache, and queues the
+ * others for idle threads. Run must not be called concurrently.
+ */
+class TaskScheduler {
+ public:
+  explicit TaskScheduler(int threads);
+  ~TaskScheduler();
+
+  inline int threads() const { return threads_; }
+
+  /**
+   * @brief Calls run(i) for every task i in [0, dependents.size()), each
+   *        once the dependencies[i] tasks listing i in their dependents have
+   *        returned, and returns when all the calls have returned.
+   */
+  void Run(const vector<vector<int> >& dependents,
+      const vector<int>& dependencies, const boost::function<void(int)>& run);
+
+ private:
+  void Entry(int device, Caffe::Brew mode, int rand_seed, int solver_count,
+      bool root_solver, int numa_node, bool numa_pinned);
+  // Runs ready tasks until the run is done or, for helpers, shut down.
+  void RunTasks(bool helper);
+
+  const int threads_;
+  shared_ptr<boost::mutex> mutex_;
+  // Signaled when tasks get ready, the run is done or helpers shut down.
+  shared_ptr<boost::condition_variable> condition_;
+  shared_ptr<boost::thread_group> helpers_;
+  bool shutdown_;
+  // The current run, guarded by mutex_.
+  const vector<vector<int> >* dependents_;
+  const boost::function<void(int)>* run_;
+  vector<int> unmet_dependencies_;
+  std::deque<int> ready_;
+  int remaining_;
+
+  DISABLE_COPY_AND_ASSIGN(TaskScheduler);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_TASK_SCHEDULER_H_
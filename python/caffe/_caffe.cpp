@@ -147,6 +147,38 @@ void Net_LoadHDF5(Net<Dtype>* net, string filename) {
   net->CopyTrainedLayersFromHDF5(filename.c_str());
 }
 
+void Net_EnableProfiling(Net<Dtype>* net, bool trace) {
+  net->EnableProfiling(trace);
+}
+
+// Returns (forward calls, forward ms, backward calls, backward ms) per layer.
+bp::list Net_ProfileStats(const Net<Dtype>& net) {
+  bp::list result;
+  if (!net.profiler()) {
+    return result;
+  }
+  const vector<Profiler::LayerStats> stats = net.profiler()->stats();
+  for (int i = 0; i < stats.size(); ++i) {
+    result.append(bp::make_tuple(stats[i].forward_calls,
+        stats[i].forward_us / 1000, stats[i].backward_calls,
+        stats[i].backward_us / 1000));
+  }
+  return result;
+}
+
+void Net_WriteTrace(const Net<Dtype>& net, string filename) {
+  if (!net.profiler()) {
+    throw std::runtime_error("write_trace needs enable_profiling(trace=True)");
+  }
+  net.profiler()->WriteTrace(filename);
+}
+
+void Net_ResetProfile(Net<Dtype>* net) {
+  if (net->profiler()) {
+    net->profiler()->Reset();
+  }
+}
+
 void Net_SetInputArrays(Net<Dtype>* net, bp::object data_obj,
     bp::object labels_obj) {
   // check that this network has an input MemoryDataLayer
@@ -328,6 +360,12 @@ BOOST_PYTHON_MODULE(_caffe) {
         bp::return_value_policy<bp::copy_const_reference>()))
     .def("_set_input_arrays", &Net_SetInputArrays,
         bp::with_custodian_and_ward<1, 2, bp::with_custodian_and_ward<1, 3> >())
+    .def("enable_profiling", &Net_EnableProfiling,
+        (bp::arg("trace")=false))
+    .def("disable_profiling", &Net<Dtype>::DisableProfiling)
+    .def("_profile_stats", &Net_ProfileStats)
+    .def("write_trace", &Net_WriteTrace)
+    .def("reset_profile", &Net_ResetProfile)
     .def("save", &Net_Save)
     .def("save_hdf5", &Net_SaveHDF5)
     .def("load_hdf5", &Net_LoadHDF5);
@@ -344,7 +382,7 @@ BOOST_PYTHON_MODULE(_caffe) {
     .add_property("channels", &Blob<Dtype>::channels)
     .add_property("height",   &Blob<Dtype>::height)
     .add_property("width",    &Blob<Dtype>::width)
-    .add_property("count",    static_cast<int (Blob<Dtype>::*)() const>(
+    .add_property("count",    static_cast<int64_t (Blob<Dtype>::*)() const>(
         &Blob<Dtype>::count))
     .def("reshape",           bp::raw_function(&Blob_Reshape))
     .add_property("data",     bp::make_function(&Blob<Dtype>::mutable_cpu_data,
@@ -3,7 +3,7 @@ Wrap the internal caffe C++ module (_caffe.so) with a clean, Pythonic
 interface.
 """
 
-from collections import OrderedDict
+from collections import OrderedDict, namedtuple
 try:
     from itertools import izip_longest
 except:
@@ -16,6 +16,9 @@ import caffe.io
 
 import six
 
+LayerProfile = namedtuple('LayerProfile', ['forward_calls', 'forward_ms',
+                                           'backward_calls', 'backward_ms'])
+
 # We directly update methods from Net here (rather than using composition or
 # inheritance) so that nets created by caffe (e.g., by SGDSolver) will
 # automatically have the improved interface.
@@ -75,6 +78,17 @@ def _Net_outputs(self):
     return self._output_list
 
 
+@property
+def _Net_profile(self):
+    """
+    An OrderedDict (bottom to top) of the forward and backward call counts
+    and times of each layer, counted since enable_profiling() or
+    reset_profile(); empty until profiling is enabled.
+    """
+    return OrderedDict(zip(self._layer_names,
+                           [LayerProfile(*s) for s in self._profile_stats()]))
+
+
 def _Net_forward(self, blobs=None, start=None, end=None, **kwargs):
     """
     Forward pass: prepare inputs and run the net forward.
@@ -330,5 +344,6 @@ Net.set_input_arrays = _Net_set_input_arrays
 Net._batch = _Net_batch
 Net.inputs = _Net_inputs
 Net.outputs = _Net_outputs
+Net.profile = _Net_profile
 Net.top_names = _Net_get_id_name(Net._top_ids, "_top_names")
 Net.bottom_names = _Net_get_id_name(Net._bottom_ids, "_bottom_names")
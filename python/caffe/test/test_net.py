@@ -64,6 +64,28 @@ class TestNet(unittest.TestCase):
         self.net.forward()
         self.net.backward()
 
+    def test_profile(self):
+        self.assertEqual(len(self.net.profile), 0)
+        self.net.enable_profiling(trace=True)
+        self.net.forward()
+        self.net.backward()
+        self.net.disable_profiling()
+        self.net.forward()
+        profile = self.net.profile
+        self.assertEqual(list(profile.keys()), list(self.net._layer_names))
+        for name, layer in six.iteritems(profile):
+            self.assertEqual(layer.forward_calls, 1)
+            self.assertGreaterEqual(layer.forward_ms, 0)
+        self.assertEqual(profile['conv'].backward_calls, 1)
+        f = tempfile.NamedTemporaryFile(mode='w+', delete=False)
+        f.close()
+        self.net.write_trace(f.name)
+        with open(f.name) as trace:
+            self.assertIn('"name": "conv"', trace.read())
+        os.remove(f.name)
+        self.net.reset_profile()
+        self.assertEqual(self.net.profile['conv'].forward_calls, 0)
+
     def test_clear_param_diffs(self):
         # Run a forward/backward step to have non-zero diffs
         self.net.forward()
@@ -0,0 +1,151 @@
+// Runs the registered micro-benchmarks and reports their time per call.
+// Usage:
+//    caffe_benchmark [--filter=substring] [--min_time=s] [--repetitions=n]
+//        [--csv=file]
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>  // NOLINT(readability/streams)
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "boost/algorithm/string.hpp"
+#include "boost/scoped_ptr.hpp"
+#include "caffe/benchmark/bench_caffe_main.hpp"
+#include "caffe/common.hpp"
+#include "caffe/util/benchmark.hpp"
+
+DEFINE_string(filter, "",
+    "Only run the benchmarks whose name contains this string, e.g. "
+    "'Gemm<float>' or 'Pooling'.");
+DEFINE_double(min_time, 0.2,
+    "Minimum time in seconds of each timed batch of calls.");
+DEFINE_int32(repetitions, 5,
+    "Number of timed batches, over which the statistics are computed.");
+DEFINE_string(csv, "",
+    "Optional; also write the results to this CSV file.");
+
+namespace caffe {
+
+vector<vector<int> > ParseArgs(const string& spec) {
+  vector<string> tuples;
+  boost::split(tuples, spec, boost::is_any_of(";"));
+  vector<vector<int> > args(tuples.size());
+  for (int i = 0; i < tuples.size(); ++i) {
+    vector<string> values;
+    boost::split(values, tuples[i], boost::is_any_of(","));
+    for (int j = 0; j < values.size(); ++j) {
+      args[i].push_back(atoi(values[j].c_str()));
+    }
+  }
+  return args;
+}
+
+// Seconds taken by iterations calls to benchmark->Run().
+static double TimeRuns(Benchmark* benchmark, int iterations) {
+  CPUTimer timer;
+  timer.Start();
+  for (int i = 0; i < iterations; ++i) {
+    benchmark->Run();
+  }
+  return timer.Seconds();
+}
+
+// Times benchmark, which is set up, and returns the time per call in
+// microseconds of each repetition.
+static vector<double> TimeBenchmark(Benchmark* benchmark, int* iterations) {
+  benchmark->Run();
+  // Grow the batch until it lasts min_time, at most 10 times per step.
+  *iterations = 1;
+  for (double seconds = TimeRuns(benchmark, 1); seconds < FLAGS_min_time; ) {
+    const double scale = seconds > 0 ? 1.4 * FLAGS_min_time / seconds : 10;
+    *iterations = static_cast<int>(
+        std::min(std::max(*iterations * std::min(scale, 10.), *iterations + 1.),
+                 1e9));
+    seconds = TimeRuns(benchmark, *iterations);
+  }
+  vector<double> times;
+  for (int r = 0; r < FLAGS_repetitions; ++r) {
+    times.push_back(TimeRuns(benchmark, *iterations) * 1e6 / *iterations);
+  }
+  return times;
+}
+
+static int RunBenchmarks() {
+  std::ofstream csv;
+  if (FLAGS_csv.size()) {
+    csv.open(FLAGS_csv.c_str());
+    CHECK(csv) << "Cannot write " << FLAGS_csv;
+    csv << "benchmark,iterations,mean_us,median_us,stddev_us,min_us,"
+        << "gflops_per_s,gb_per_s\n";
+  }
+  printf("%-44s %10s %10s %7s %10s %10s %9s\n", "Benchmark", "Median us",
+      "Min us", "CV %", "Iterations", "GFLOP/s", "GB/s");
+  const BenchmarkRegistry::CreatorList& registry =
+      BenchmarkRegistry::Registry();
+  for (int b = 0; b < registry.size(); ++b) {
+    boost::scoped_ptr<Benchmark> benchmark(registry[b].second());
+    const vector<vector<int> > args = benchmark->args();
+    for (int a = 0; a < args.size(); ++a) {
+      std::ostringstream name;
+      name << registry[b].first;
+      for (int i = 0; i < args[a].size(); ++i) {
+        name << "/" << args[a][i];
+      }
+      if (name.str().find(FLAGS_filter) == string::npos) {
+        continue;
+      }
+      benchmark->SetUp(args[a]);
+      int iterations;
+      vector<double> times = TimeBenchmark(benchmark.get(), &iterations);
+      std::sort(times.begin(), times.end());
+      double mean = 0;
+      for (int i = 0; i < times.size(); ++i) {
+        mean += times[i];
+      }
+      mean /= times.size();
+      double variance = 0;
+      for (int i = 0; i < times.size(); ++i) {
+        variance += (times[i] - mean) * (times[i] - mean);
+      }
+      const double stddev = std::sqrt(variance / times.size());
+      const int n = times.size();
+      const double median = n % 2 ? times[n / 2] :
+          (times[n / 2 - 1] + times[n / 2]) / 2;
+      // Operations per microsecond are millions per second.
+      const double gflops = benchmark->flops() / median / 1000;
+      const double gbytes = benchmark->bytes() / median / 1000;
+      printf("%-44s %10.2f %10.2f %7.2f %10d %10.2f %9.2f\n",
+          name.str().c_str(), median, times[0], 100 * stddev / mean,
+          iterations, gflops, gbytes);
+      fflush(stdout);
+      if (csv.is_open()) {
+        csv << name.str() << "," << iterations << "," << mean << ","
+            << median << "," << stddev << "," << times[0] << "," << gflops
+            << "," << gbytes << "\n";
+      }
+    }
+  }
+  return 0;
+}
+
+}  // namespace caffe
+
+int main(int argc, char** argv) {
+  // Print output to stderr (while still logging).
+  FLAGS_alsologtostderr = 1;
+  gflags::SetUsageMessage("Run the caffe micro-benchmarks\n"
+      "Usage:\n"
+      "    caffe_benchmark [--filter=substring] [--min_time=s] "
+      "[--repetitions=n] [--csv=file]\n");
+  caffe::GlobalInit(&argc, &argv);
+  CHECK_GT(FLAGS_min_time, 0);
+  CHECK_GT(FLAGS_repetitions, 0);
+  caffe::Caffe::set_mode(caffe::Caffe::CPU);
+  return caffe::RunBenchmarks();
+}
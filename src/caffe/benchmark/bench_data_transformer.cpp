@@ -0,0 +1,117 @@
+#ifdef USE_OPENCV
+#include <opencv2/core/core.hpp>
+#endif  // USE_OPENCV
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/data_transformer.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/io.hpp"
+#include "caffe/util/math_functions.hpp"
+
+#include "caffe/benchmark/bench_caffe_main.hpp"
+
+namespace caffe {
+
+// Args are the height and width of a 3 channel image, the crop size, 0 for
+// none, and the mean subtracted: 0 for none, 1 for per channel values and 2
+// for a mean image. Images are randomly mirrored.
+static vector<vector<int> > TransformArgs() {
+  return ParseArgs("320,0,1;320,224,1;320,227,1;320,299,1;"
+      "256,227,0;256,227,2");
+}
+
+template <typename Dtype>
+class TransformDatum : public Benchmark {
+ public:
+  virtual ~TransformDatum() {
+    if (mean_file_.size()) {
+      remove(mean_file_.c_str());
+    }
+  }
+
+  virtual vector<vector<int> > args() const { return TransformArgs(); }
+  virtual void SetUp(const vector<int>& args) {
+    const int size = args[0];
+    const int channels = 3;
+    datum_.set_channels(channels);
+    datum_.set_height(size);
+    datum_.set_width(size);
+    string data(channels * size * size, 0);
+    for (int j = 0; j < data.size(); ++j) {
+      data[j] = static_cast<char>(caffe_rng_rand());
+    }
+    datum_.set_data(data);
+
+    TransformationParameter param;
+    param.set_crop_size(args[1]);
+    param.set_mirror(true);
+    param.set_scale(0.00390625);
+    if (args[2] == 1) {
+      param.add_mean_value(104);
+      param.add_mean_value(117);
+      param.add_mean_value(123);
+    } else if (args[2] == 2) {
+      if (mean_file_.empty()) {
+        MakeTempFilename(&mean_file_);
+      }
+      BlobProto blob_mean;
+      blob_mean.set_num(1);
+      blob_mean.set_channels(channels);
+      blob_mean.set_height(size);
+      blob_mean.set_width(size);
+      for (int j = 0; j < channels * size * size; ++j) {
+        blob_mean.add_data(j % 256);
+      }
+      WriteProtoToBinaryFile(blob_mean, mean_file_);
+      param.set_mean_file(mean_file_);
+    }
+    transformer_.reset(new DataTransformer<Dtype>(param, TRAIN));
+    transformer_->InitRand();
+    transformed_.Reshape(transformer_->InferBlobShape(datum_));
+  }
+  virtual void Run() {
+    transformer_->Transform(datum_, &transformed_);
+  }
+  virtual double bytes() const {
+    return transformed_.count() * (1 + sizeof(Dtype));
+  }
+
+ protected:
+  Datum datum_;
+  string mean_file_;
+  shared_ptr<DataTransformer<Dtype> > transformer_;
+  Blob<Dtype> transformed_;
+};
+REGISTER_BENCHMARK_CLASS(TransformDatum);
+
+#ifdef USE_OPENCV
+// The path taken by the image and encoded data layers.
+template <typename Dtype>
+class TransformMat : public TransformDatum<Dtype> {
+ public:
+  virtual void SetUp(const vector<int>& args) {
+    TransformDatum<Dtype>::SetUp(args);
+    const int size = args[0];
+    cv_img_.create(size, size, CV_8UC3);
+    for (int h = 0; h < size; ++h) {
+      uchar* ptr = cv_img_.ptr<uchar>(h);
+      for (int j = 0; j < size * 3; ++j) {
+        ptr[j] = static_cast<uchar>(caffe_rng_rand());
+      }
+    }
+  }
+  virtual void Run() {
+    this->transformer_->Transform(cv_img_, &this->transformed_);
+  }
+
+ protected:
+  cv::Mat cv_img_;
+};
+REGISTER_BENCHMARK_CLASS(TransformMat);
+#endif  // USE_OPENCV
+
+}  // namespace caffe
@@ -0,0 +1,63 @@
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/util/im2col.hpp"
+#include "caffe/util/math_functions.hpp"
+
+#include "caffe/benchmark/bench_caffe_main.hpp"
+
+namespace caffe {
+
+// Args are channels, height, width, kernel size, stride and pad of a square
+// convolution.
+static vector<vector<int> > ConvolutionArgs() {
+  // The convolutions of AlexNet, then typical ones of VGG and ResNet.
+  return ParseArgs("3,227,227,11,4,0;96,27,27,5,1,2;256,13,13,3,1,1;"
+      "64,224,224,3,1,1;64,56,56,3,1,1;512,7,7,3,1,1");
+}
+
+template <typename Dtype>
+class Im2col : public Benchmark {
+ public:
+  virtual vector<vector<int> > args() const { return ConvolutionArgs(); }
+  virtual void SetUp(const vector<int>& args) {
+    channels_ = args[0];
+    height_ = args[1];
+    width_ = args[2];
+    kernel_ = args[3];
+    stride_ = args[4];
+    pad_ = args[5];
+    const int height_col = (height_ + 2 * pad_ - kernel_) / stride_ + 1;
+    const int width_col = (width_ + 2 * pad_ - kernel_) / stride_ + 1;
+    image_.Reshape(1, channels_, height_, width_);
+    col_.Reshape(1, channels_ * kernel_ * kernel_, height_col, width_col);
+    caffe_rng_uniform<Dtype>(image_.count(), -1, 1,
+        image_.mutable_cpu_data());
+    caffe_rng_uniform<Dtype>(col_.count(), -1, 1, col_.mutable_cpu_data());
+  }
+  virtual void Run() {
+    im2col_cpu(image_.cpu_data(), channels_, height_, width_, kernel_,
+        kernel_, pad_, pad_, stride_, stride_, 1, 1, col_.mutable_cpu_data());
+  }
+  virtual double bytes() const {
+    return (image_.count() + col_.count()) * sizeof(Dtype);
+  }
+
+ protected:
+  int channels_, height_, width_, kernel_, stride_, pad_;
+  Blob<Dtype> image_, col_;
+};
+REGISTER_BENCHMARK_CLASS(Im2col);
+
+template <typename Dtype>
+class Col2im : public Im2col<Dtype> {
+ public:
+  virtual void Run() {
+    col2im_cpu(this->col_.cpu_data(), this->channels_, this->height_,
+        this->width_, this->kernel_, this->kernel_, this->pad_, this->pad_,
+        this->stride_, this->stride_, 1, 1, this->image_.mutable_cpu_data());
+  }
+};
+REGISTER_BENCHMARK_CLASS(Col2im);
+
+}  // namespace caffe
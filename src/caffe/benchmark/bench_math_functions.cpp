@@ -0,0 +1,107 @@
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/util/math_functions.hpp"
+
+#include "caffe/benchmark/bench_caffe_main.hpp"
+
+namespace caffe {
+
+// Fills blob with uniform values in [-1, 1].
+template <typename Dtype>
+static void FillUniform(Blob<Dtype>* blob) {
+  caffe_rng_uniform<Dtype>(blob->count(), -1, 1, blob->mutable_cpu_data());
+}
+
+// C = A * B with A of M x K and B of K x N; args are M, N, K.
+template <typename Dtype>
+class Gemm : public Benchmark {
+ public:
+  virtual vector<vector<int> > args() const {
+    // Square matrices, then the convolutions of AlexNet at batch 1 and a
+    // fully connected layer at batch 64.
+    return ParseArgs("64,64,64;256,256,256;1024,1024,1024;"
+        "96,3025,363;256,729,1200;384,169,2304;64,4096,9216");
+  }
+  virtual void SetUp(const vector<int>& args) {
+    M_ = args[0];
+    N_ = args[1];
+    K_ = args[2];
+    A_.Reshape(1, 1, M_, K_);
+    B_.Reshape(1, 1, K_, N_);
+    C_.Reshape(1, 1, M_, N_);
+    FillUniform(&A_);
+    FillUniform(&B_);
+  }
+  virtual void Run() {
+    caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, M_, N_, K_, Dtype(1),
+        A_.cpu_data(), B_.cpu_data(), Dtype(0), C_.mutable_cpu_data());
+  }
+  virtual double flops() const { return 2. * M_ * N_ * K_; }
+  virtual double bytes() const {
+    return (A_.count() + B_.count() + C_.count()) * sizeof(Dtype);
+  }
+
+ protected:
+  int M_, N_, K_;
+  Blob<Dtype> A_, B_, C_;
+};
+REGISTER_BENCHMARK_CLASS(Gemm);
+
+// y = A * x with A of M x N; args are M, N.
+template <typename Dtype>
+class Gemv : public Benchmark {
+ public:
+  virtual vector<vector<int> > args() const {
+    return ParseArgs("256,256;1000,4096;4096,9216");
+  }
+  virtual void SetUp(const vector<int>& args) {
+    M_ = args[0];
+    N_ = args[1];
+    A_.Reshape(1, 1, M_, N_);
+    x_.Reshape(1, 1, 1, N_);
+    y_.Reshape(1, 1, 1, M_);
+    FillUniform(&A_);
+    FillUniform(&x_);
+  }
+  virtual void Run() {
+    caffe_cpu_gemv<Dtype>(CblasNoTrans, M_, N_, Dtype(1), A_.cpu_data(),
+        x_.cpu_data(), Dtype(0), y_.mutable_cpu_data());
+  }
+  virtual double flops() const { return 2. * M_ * N_; }
+  virtual double bytes() const {
+    return (A_.count() + x_.count() + y_.count()) * sizeof(Dtype);
+  }
+
+ protected:
+  int M_, N_;
+  Blob<Dtype> A_, x_, y_;
+};
+REGISTER_BENCHMARK_CLASS(Gemv);
+
+// y += a * x; args are the count.
+template <typename Dtype>
+class Axpy : public Benchmark {
+ public:
+  virtual vector<vector<int> > args() const {
+    return ParseArgs("4096;262144;16777216");
+  }
+  virtual void SetUp(const vector<int>& args) {
+    x_.Reshape(1, 1, 1, args[0]);
+    y_.Reshape(1, 1, 1, args[0]);
+    FillUniform(&x_);
+    FillUniform(&y_);
+  }
+  virtual void Run() {
+    caffe_axpy<Dtype>(x_.count(), Dtype(1e-6), x_.cpu_data(),
+        y_.mutable_cpu_data());
+  }
+  virtual double flops() const { return 2. * x_.count(); }
+  virtual double bytes() const { return 3. * x_.count() * sizeof(Dtype); }
+
+ protected:
+  Blob<Dtype> x_, y_;
+};
+REGISTER_BENCHMARK_CLASS(Axpy);
+
+}  // namespace caffe
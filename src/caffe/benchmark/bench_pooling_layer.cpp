@@ -0,0 +1,43 @@
+#include <vector>
+
+#include "caffe/layers/pooling_layer.hpp"
+
+#include "caffe/benchmark/bench_caffe_main.hpp"
+
+namespace caffe {
+
+// Args are the batch size, channels, height, width, kernel size and stride
+// of a square pooling, and its method: 0 for max, 1 for average.
+template <typename Dtype>
+class PoolingForward : public LayerBenchmark<Dtype> {
+ public:
+  PoolingForward() : LayerBenchmark<Dtype>(false) {}
+  explicit PoolingForward(bool backward) : LayerBenchmark<Dtype>(backward) {}
+
+  virtual vector<vector<int> > args() const {
+    // The poolings of AlexNet, VGG and ResNet at batch 32.
+    return ParseArgs("32,96,55,55,3,2,0;32,256,13,13,3,2,0;"
+        "32,64,224,224,2,2,0;32,64,112,112,3,2,0;32,512,14,14,2,2,0;"
+        "32,96,55,55,3,2,1;32,2048,7,7,7,1,1");
+  }
+  virtual void SetUp(const vector<int>& args) {
+    LayerParameter param;
+    PoolingParameter* pooling_param = param.mutable_pooling_param();
+    pooling_param->set_kernel_size(args[4]);
+    pooling_param->set_stride(args[5]);
+    pooling_param->set_pool(args[6] == 0 ? PoolingParameter_PoolMethod_MAX :
+        PoolingParameter_PoolMethod_AVE);
+    vector<int> shape(args.begin(), args.begin() + 4);
+    this->SetUpLayer(new PoolingLayer<Dtype>(param), shape);
+  }
+};
+REGISTER_BENCHMARK_CLASS(PoolingForward);
+
+template <typename Dtype>
+class PoolingBackward : public PoolingForward<Dtype> {
+ public:
+  PoolingBackward() : PoolingForward<Dtype>(true) {}
+};
+REGISTER_BENCHMARK_CLASS(PoolingBackward);
+
+}  // namespace caffe
@@ -0,0 +1,35 @@
+#include <vector>
+
+#include "caffe/layers/softmax_layer.hpp"
+
+#include "caffe/benchmark/bench_caffe_main.hpp"
+
+namespace caffe {
+
+// Args are the batch size, channels, height and width; the softmax is taken
+// over the channels.
+template <typename Dtype>
+class SoftmaxForward : public LayerBenchmark<Dtype> {
+ public:
+  SoftmaxForward() : LayerBenchmark<Dtype>(false) {}
+  explicit SoftmaxForward(bool backward) : LayerBenchmark<Dtype>(backward) {}
+
+  virtual vector<vector<int> > args() const {
+    // Classification over 1000 classes, then per pixel segmentation over 21.
+    return ParseArgs("1,1000,1,1;64,1000,1,1;256,1000,1,1;"
+        "1,21,500,500;16,21,64,64");
+  }
+  virtual void SetUp(const vector<int>& args) {
+    this->SetUpLayer(new SoftmaxLayer<Dtype>(LayerParameter()), args);
+  }
+};
+REGISTER_BENCHMARK_CLASS(SoftmaxForward);
+
+template <typename Dtype>
+class SoftmaxBackward : public SoftmaxForward<Dtype> {
+ public:
+  SoftmaxBackward() : SoftmaxForward<Dtype>(true) {}
+};
+REGISTER_BENCHMARK_CLASS(SoftmaxBackward);
+
+}  // namespace caffe
@@ -1,13 +1,64 @@
+#include <algorithm>
 #include <climits>
+#include <cstring>
+#include <limits>
 #include <vector>
 
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/syncedmem.hpp"
+#include "caffe/util/half.hpp"
 #include "caffe/util/math_functions.hpp"
 
 namespace caffe {
 
+static BlobGrowthPolicy blob_growth_policy;
+
+const BlobGrowthPolicy& GetBlobGrowthPolicy() {
+  return blob_growth_policy;
+}
+
+void SetBlobGrowthPolicy(const BlobGrowthPolicy& policy) {
+  CHECK_GE(policy.growth_factor, 1);
+  blob_growth_policy = policy;
+}
+
+// The capacity of a blob of the given capacity growing to count elements of
+// element_size bytes.
+static int64_t GrownCapacity(int64_t capacity, int64_t count,
+    size_t element_size) {
+  if (capacity == 0) {
+    return count;
+  }
+  const double grown = std::min(capacity * blob_growth_policy.growth_factor,
+      static_cast<double>(std::numeric_limits<int64_t>::max() / 2));
+  const double max_grown = count + static_cast<double>(
+      blob_growth_policy.max_headroom_bytes / element_size);
+  return std::max(count, static_cast<int64_t>(std::min(grown, max_grown)));
+}
+
+// Returns memory of size bytes holding the first size bytes of mem.
+static shared_ptr<SyncedMemory> ShrinkMemory(
+    const shared_ptr<SyncedMemory>& mem, size_t size) {
+  shared_ptr<SyncedMemory> shrunk(new SyncedMemory(size));
+  switch (mem->head()) {
+  case SyncedMemory::UNINITIALIZED:
+    break;
+  case SyncedMemory::HEAD_AT_GPU:
+#ifndef CPU_ONLY
+    caffe_gpu_memcpy(size, mem->gpu_data(), shrunk->mutable_gpu_data());
+#else
+    NO_GPU;
+#endif
+    break;
+  case SyncedMemory::HEAD_AT_CPU:
+  case SyncedMemory::SYNCED:
+    memcpy(shrunk->mutable_cpu_data(), mem->cpu_data(), size);
+    break;
+  }
+  return shrunk;
+}
+
 template <typename Dtype>
 void Blob<Dtype>::Reshape(const int num, const int channels, const int height,
     const int width) {
@@ -31,16 +82,23 @@ void Blob<Dtype>::Reshape(const vector<int>& shape) {
   for (int i = 0; i < shape.size(); ++i) {
     CHECK_GE(shape[i], 0);
     if (count_ != 0) {
-      CHECK_LE(shape[i], INT_MAX / count_) << "blob size exceeds INT_MAX";
+      CHECK_LE(shape[i], std::numeric_limits<int64_t>::max() / count_)
+          << "blob size exceeds INT64_MAX";
     }
     count_ *= shape[i];
     shape_[i] = shape[i];
     shape_data[i] = shape[i];
   }
-  if (count_ > capacity_) {
-    capacity_ = count_;
+  if (count_ > capacity_ && half_storage_) {
+    capacity_ = GrownCapacity(capacity_, count_, sizeof(uint16_t));
+    half_data_.reset(new SyncedMemory(capacity_ * sizeof(uint16_t)));
+  } else if (count_ > capacity_) {
+    capacity_ = GrownCapacity(capacity_, count_, sizeof(Dtype));
     data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
-    diff_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+    if (has_diff_) {
+      diff_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+    }
+    half_data_.reset();
   }
 }
 
@@ -59,18 +117,86 @@ void Blob<Dtype>::ReshapeLike(const Blob<Dtype>& other) {
   Reshape(other.shape());
 }
 
+template <typename Dtype>
+size_t Blob<Dtype>::ShrinkToFit() {
+  if (count_ == capacity_ || !data_.unique() || (diff_ && !diff_.unique())) {
+    return 0;
+  }
+  const size_t size = count_ * sizeof(Dtype);
+  const size_t excess = (capacity_ - count_) * sizeof(Dtype);
+  // Memory never used was never allocated, and releases nothing.
+  size_t released =
+      data_->head() == SyncedMemory::UNINITIALIZED ? 0 : excess;
+  data_ = ShrinkMemory(data_, size);
+  if (diff_) {
+    released += diff_->head() == SyncedMemory::UNINITIALIZED ? 0 : excess;
+    diff_ = ShrinkMemory(diff_, size);
+  }
+  capacity_ = count_;
+  return released;
+}
+
+template <typename Dtype>
+size_t Blob<Dtype>::StoreAsHalf() {
+  if (half_data_ || !data_.unique() || (diff_ && !diff_.unique())) {
+    return 0;
+  }
+  half_data_.reset(new SyncedMemory(count_ * sizeof(uint16_t)));
+  caffe_cpu_to_half(count_, cpu_data(),
+      static_cast<uint16_t*>(half_data_->mutable_cpu_data()));
+  size_t released = capacity_ * sizeof(Dtype) - count_ * sizeof(uint16_t);
+  if (diff_) {
+    released += capacity_ * sizeof(Dtype);
+  }
+  data_.reset();
+  diff_.reset();
+  has_diff_ = false;
+  capacity_ = 0;
+  return released;
+}
+
+template <> size_t Blob<int>::StoreAsHalf() {
+  NOT_IMPLEMENTED;
+  return 0;
+}
+
+template <> size_t Blob<unsigned int>::StoreAsHalf() {
+  NOT_IMPLEMENTED;
+  return 0;
+}
+
+template <typename Dtype>
+size_t Blob<Dtype>::AllocateAsHalf() {
+  CHECK(!has_diff_) << "Only blobs without a diff can be stored as half";
+  if (half_storage_) {
+    return 0;
+  }
+  const size_t released = data_ ?
+      capacity_ * (sizeof(Dtype) - sizeof(uint16_t)) : 0;
+  half_storage_ = true;
+  data_.reset();
+  half_data_.reset(new SyncedMemory(capacity_ * sizeof(uint16_t)));
+  return released;
+}
+
+template <typename Dtype>
+const uint16_t* Blob<Dtype>::cpu_half_data() const {
+  CHECK(half_data_);
+  return static_cast<const uint16_t*>(half_data_->cpu_data());
+}
+
 template <typename Dtype>
 Blob<Dtype>::Blob(const int num, const int channels, const int height,
     const int width)
   // capacity_ must be initialized before calling Reshape
-  : capacity_(0) {
+  : capacity_(0), has_diff_(true), half_storage_(false) {
   Reshape(num, channels, height, width);
 }
 
 template <typename Dtype>
 Blob<Dtype>::Blob(const vector<int>& shape)
   // capacity_ must be initialized before calling Reshape
-  : capacity_(0) {
+  : capacity_(0), has_diff_(true), half_storage_(false) {
   Reshape(shape);
 }
 
@@ -137,13 +263,86 @@ Dtype* Blob<Dtype>::mutable_gpu_diff() {
 template <typename Dtype>
 void Blob<Dtype>::ShareData(const Blob& other) {
   CHECK_EQ(count_, other.count());
-  data_ = other.data();
+  CHECK(other.data_ || other.half_data_);
+  data_ = other.data_;
+  half_data_ = other.half_data_;
+}
+
+template <typename Dtype>
+const Dtype* Blob<Dtype>::cpu_data_block(int64_t offset, int64_t count,
+    vector<Dtype>* buffer) const {
+  CHECK_LE(offset + count, count_);
+  if (!half_data_) {
+    return cpu_data() + offset;
+  }
+  buffer->resize(count);
+  if (count == 0) {
+    return NULL;
+  }
+  caffe_cpu_from_half(count, cpu_half_data() + offset, &(*buffer)[0]);
+  return &(*buffer)[0];
+}
+
+template <> const unsigned int* Blob<unsigned int>::cpu_data_block(
+    int64_t offset, int64_t count, vector<unsigned int>* buffer) const {
+  NOT_IMPLEMENTED;
+  return NULL;
+}
+
+template <> const int* Blob<int>::cpu_data_block(int64_t offset,
+    int64_t count, vector<int>* buffer) const {
+  NOT_IMPLEMENTED;
+  return NULL;
+}
+
+template <typename Dtype>
+Dtype* Blob<Dtype>::mutable_cpu_data_block(int64_t offset, int64_t count,
+    vector<Dtype>* buffer) {
+  CHECK_LE(offset + count, count_);
+  if (!half_data_) {
+    return mutable_cpu_data() + offset;
+  }
+  buffer->resize(count);
+  return count == 0 ? NULL : &(*buffer)[0];
+}
+
+template <typename Dtype>
+void Blob<Dtype>::set_cpu_data_block(int64_t offset, int64_t count,
+    const Dtype* block) {
+  CHECK_LE(offset + count, count_);
+  if (half_data_) {
+    caffe_cpu_to_half(count, block,
+        static_cast<uint16_t*>(half_data_->mutable_cpu_data()) + offset);
+  } else if (block != cpu_data() + offset) {
+    caffe_copy(count, block, mutable_cpu_data() + offset);
+  }
+}
+
+template <> void Blob<unsigned int>::set_cpu_data_block(int64_t offset,
+    int64_t count, const unsigned int* block) {
+  NOT_IMPLEMENTED;
+}
+
+template <> void Blob<int>::set_cpu_data_block(int64_t offset, int64_t count,
+    const int* block) {
+  NOT_IMPLEMENTED;
 }
 
 template <typename Dtype>
 void Blob<Dtype>::ShareDiff(const Blob& other) {
   CHECK_EQ(count_, other.count());
-  diff_ = other.diff();
+  has_diff_ = other.has_diff();
+  diff_ = other.diff_;
+}
+
+template <typename Dtype>
+void Blob<Dtype>::set_has_diff(bool has_diff) {
+  has_diff_ = has_diff;
+  if (!has_diff) {
+    diff_.reset();
+  } else if (!diff_ && data_) {
+    diff_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+  }
 }
 
 // The "update" method is used for parameter blobs in a Net, which are stored
@@ -471,25 +670,28 @@ void Blob<Dtype>::FromProto(const BlobProto& proto, bool reshape) {
   Dtype* data_vec = mutable_cpu_data();
   if (proto.double_data_size() > 0) {
     CHECK_EQ(count_, proto.double_data_size());
-    for (int i = 0; i < count_; ++i) {
+    for (int64_t i = 0; i < count_; ++i) {
       data_vec[i] = proto.double_data(i);
     }
   } else {
     CHECK_EQ(count_, proto.data_size());
-    for (int i = 0; i < count_; ++i) {
+    for (int64_t i = 0; i < count_; ++i) {
       data_vec[i] = proto.data(i);
     }
   }
+  if (!has_diff_) {
+    return;
+  }
   if (proto.double_diff_size() > 0) {
     CHECK_EQ(count_, proto.double_diff_size());
     Dtype* diff_vec = mutable_cpu_diff();
-    for (int i = 0; i < count_; ++i) {
+    for (int64_t i = 0; i < count_; ++i) {
       diff_vec[i] = proto.double_diff(i);
     }
   } else if (proto.diff_size() > 0) {
     CHECK_EQ(count_, proto.diff_size());
     Dtype* diff_vec = mutable_cpu_diff();
-    for (int i = 0; i < count_; ++i) {
+    for (int64_t i = 0; i < count_; ++i) {
       diff_vec[i] = proto.diff(i);
     }
   }
@@ -503,15 +705,20 @@ void Blob<double>::ToProto(BlobProto* proto, bool write_diff) const {
   }
   proto->clear_double_data();
   proto->clear_double_diff();
-  const double* data_vec = cpu_data();
-  for (int i = 0; i < count_; ++i) {
-    proto->add_double_data(data_vec[i]);
+  // Copied in bulk, as snapshots copy every parameter.
+  CHECK_LE(count_, INT_MAX) << "too large for a BlobProto";
+  proto->mutable_double_data()->Resize(count_, 0);
+  if (half_data_) {
+    caffe_cpu_from_half(count_, cpu_half_data(),
+        proto->mutable_double_data()->mutable_data());
+  } else {
+    caffe_copy(count_, cpu_data(),
+        proto->mutable_double_data()->mutable_data());
   }
   if (write_diff) {
-    const double* diff_vec = cpu_diff();
-    for (int i = 0; i < count_; ++i) {
-      proto->add_double_diff(diff_vec[i]);
-    }
+    proto->mutable_double_diff()->Resize(count_, 0);
+    caffe_copy(count_, cpu_diff(),
+        proto->mutable_double_diff()->mutable_data());
   }
 }
 
@@ -523,15 +730,18 @@ void Blob<float>::ToProto(BlobProto* proto, bool write_diff) const {
   }
   proto->clear_data();
   proto->clear_diff();
-  const float* data_vec = cpu_data();
-  for (int i = 0; i < count_; ++i) {
-    proto->add_data(data_vec[i]);
+  // Copied in bulk, as snapshots copy every parameter.
+  CHECK_LE(count_, INT_MAX) << "too large for a BlobProto";
+  proto->mutable_data()->Resize(count_, 0);
+  if (half_data_) {
+    caffe_cpu_from_half(count_, cpu_half_data(),
+        proto->mutable_data()->mutable_data());
+  } else {
+    caffe_copy(count_, cpu_data(), proto->mutable_data()->mutable_data());
   }
   if (write_diff) {
-    const float* diff_vec = cpu_diff();
-    for (int i = 0; i < count_; ++i) {
-      proto->add_diff(diff_vec[i]);
-    }
+    proto->mutable_diff()->Resize(count_, 0);
+    caffe_copy(count_, cpu_diff(), proto->mutable_diff()->mutable_data());
   }
 }
 
@@ -5,6 +5,7 @@
 #include <ctime>
 
 #include "caffe/common.hpp"
+#include "caffe/util/numa.hpp"
 #include "caffe/util/rng.hpp"
 
 namespace caffe {
@@ -49,11 +50,21 @@ void GlobalInit(int* pargc, char*** pargv) {
   ::google::InstallFailureSignalHandler();
 }
 
+void Caffe::SetNumaNode(const int node, const bool pin) {
+  if (!caffe_numa_bind_thread(node, pin)) {
+    LOG_EVERY_N(WARNING, 1000)
+        << "The system did not bind the thread to NUMA node " << node;
+  }
+  Get().numa_node_ = node;
+  Get().numa_pinned_ = node >= 0 && pin;
+}
+
 #ifdef CPU_ONLY  // CPU-only Caffe.
 
 Caffe::Caffe()
     : random_generator_(), mode_(Caffe::CPU),
-      solver_count_(1), root_solver_(true) { }
+      solver_count_(1), root_solver_(true), numa_node_(-1),
+      numa_pinned_(false) { }
 
 Caffe::~Caffe() { }
 
@@ -106,7 +117,8 @@ void* Caffe::RNG::generator() {
 
 Caffe::Caffe()
     : cublas_handle_(NULL), curand_generator_(NULL), random_generator_(),
-    mode_(Caffe::CPU), solver_count_(1), root_solver_(true) {
+    mode_(Caffe::CPU), solver_count_(1), root_solver_(true), numa_node_(-1),
+    numa_pinned_(false) {
   // Try to create a cublas handler, and report an error if failed (but we will
   // keep the program running as one might just want to run CPU code).
   if (cublasCreate(&cublas_handle_) != CUBLAS_STATUS_SUCCESS) {
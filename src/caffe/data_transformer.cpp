@@ -202,6 +202,41 @@ void DataTransformer<Dtype>::Transform(const vector<Datum> & datum_vector,
 }
 
 #ifdef USE_OPENCV
+// Converts one channel of an interleaved 8-bit image row, whose pixels are
+// stride bytes apart, to width outputs: (pixel - mean) * scale, where the
+// mean comes from mean_row or is mean_value if mean_row is NULL. Mirrored
+// rows are stored back to front. Each case is a separate branch-free loop
+// with unit-stride stores so that the compiler can vectorize it.
+template <typename Dtype>
+static inline void TransformRow(const uchar* src, const int stride,
+    const int width, const Dtype* mean_row, const Dtype mean_value,
+    const Dtype scale, const bool mirror, Dtype* dst) {
+  if (mirror) {
+    Dtype* dst_end = dst + width - 1;
+    if (mean_row) {
+      for (int w = 0; w < width; ++w) {
+        dst_end[-w] = (static_cast<Dtype>(src[w * stride]) - mean_row[w])
+            * scale;
+      }
+    } else {
+      for (int w = 0; w < width; ++w) {
+        dst_end[-w] = (static_cast<Dtype>(src[w * stride]) - mean_value)
+            * scale;
+      }
+    }
+  } else {
+    if (mean_row) {
+      for (int w = 0; w < width; ++w) {
+        dst[w] = (static_cast<Dtype>(src[w * stride]) - mean_row[w]) * scale;
+      }
+    } else {
+      for (int w = 0; w < width; ++w) {
+        dst[w] = (static_cast<Dtype>(src[w * stride]) - mean_value) * scale;
+      }
+    }
+  }
+}
+
 template<typename Dtype>
 void DataTransformer<Dtype>::Transform(const vector<cv::Mat> & mat_vector,
                                        Blob<Dtype>* transformed_blob) {
@@ -293,33 +328,17 @@ void DataTransformer<Dtype>::Transform(const cv::Mat& cv_img,
 
   CHECK(cv_cropped_img.data);
 
+  // Fill the output one channel row at a time, so that the mean offsets and
+  // the mirroring are resolved once per row instead of once per pixel.
   Dtype* transformed_data = transformed_blob->mutable_cpu_data();
-  int top_index;
-  for (int h = 0; h < height; ++h) {
-    const uchar* ptr = cv_cropped_img.ptr<uchar>(h);
-    int img_index = 0;
-    for (int w = 0; w < width; ++w) {
-      for (int c = 0; c < img_channels; ++c) {
-        if (do_mirror) {
-          top_index = (c * height + h) * width + (width - 1 - w);
-        } else {
-          top_index = (c * height + h) * width + w;
-        }
-        // int top_index = (c * height + h) * width + w;
-        Dtype pixel = static_cast<Dtype>(ptr[img_index++]);
-        if (has_mean_file) {
-          int mean_index = (c * img_height + h_off + h) * img_width + w_off + w;
-          transformed_data[top_index] =
-            (pixel - mean[mean_index]) * scale;
-        } else {
-          if (has_mean_values) {
-            transformed_data[top_index] =
-              (pixel - mean_values_[c]) * scale;
-          } else {
-            transformed_data[top_index] = pixel * scale;
-          }
-        }
-      }
+  for (int c = 0; c < img_channels; ++c) {
+    const Dtype mean_value = has_mean_values ? mean_values_[c] : Dtype(0);
+    for (int h = 0; h < height; ++h) {
+      const uchar* ptr = cv_cropped_img.ptr<uchar>(h) + c;
+      const Dtype* mean_row = has_mean_file ?
+          mean + (c * img_height + h_off + h) * img_width + w_off : NULL;
+      TransformRow(ptr, img_channels, width, mean_row, mean_value, scale,
+          do_mirror, transformed_data + (c * height + h) * width);
     }
   }
 }
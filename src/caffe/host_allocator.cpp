@@ -0,0 +1,154 @@
+#include <boost/thread.hpp>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "caffe/host_allocator.hpp"
+#include "caffe/util/numa.hpp"
+
+namespace caffe {
+
+const size_t HostAllocator::kAlignment;
+const size_t CachingHostAllocator::kDefaultMaxCachedBytes;
+
+// Allocates from the system, binding the block to node unless -1.
+static void* AllocateAligned(size_t size, int node) {
+  void* ptr = NULL;
+  // posix_memalign may return NULL for size 0, which SyncedMemory allocates.
+  CHECK_EQ(posix_memalign(&ptr, HostAllocator::kAlignment,
+      std::max(size, HostAllocator::kAlignment)), 0)
+      << "host allocation of size " << size << " failed";
+  if (node >= 0) {
+    caffe_numa_bind_memory(ptr, size, node);
+  }
+  return ptr;
+}
+
+static void AddInUse(size_t size, HostAllocator::Stats* stats) {
+  stats->bytes_in_use += size;
+  stats->peak_bytes_in_use =
+      std::max(stats->peak_bytes_in_use, stats->bytes_in_use);
+  ++stats->allocations;
+}
+
+AlignedHostAllocator::AlignedHostAllocator() : mutex_(new boost::mutex()) {}
+
+void* AlignedHostAllocator::Allocate(size_t size) {
+  void* ptr = AllocateAligned(size, Caffe::numa_node());
+  boost::mutex::scoped_lock lock(*mutex_);
+  AddInUse(size, &stats_);
+  return ptr;
+}
+
+void AlignedHostAllocator::Free(void* ptr, size_t size) {
+  free(ptr);
+  boost::mutex::scoped_lock lock(*mutex_);
+  stats_.bytes_in_use -= size;
+}
+
+HostAllocator::Stats AlignedHostAllocator::stats() const {
+  boost::mutex::scoped_lock lock(*mutex_);
+  return stats_;
+}
+
+CachingHostAllocator::CachingHostAllocator(size_t max_cached_bytes)
+    : mutex_(new boost::mutex()), max_cached_bytes_(max_cached_bytes) {}
+
+CachingHostAllocator::~CachingHostAllocator() {
+  EmptyCache();
+}
+
+size_t CachingHostAllocator::BucketSize(size_t size) {
+  // The step is a quarter of the largest power of 2 not above size.
+  size_t step = 1;
+  while (step * 8 <= size) {
+    step *= 2;
+  }
+  step = std::max(step, kAlignment);
+  return std::max((size + step - 1) / step * step, kAlignment);
+}
+
+void* CachingHostAllocator::Allocate(size_t size) {
+  const size_t bucket = BucketSize(size);
+  const int node = Caffe::numa_node();
+  void* ptr = NULL;
+  {
+    boost::mutex::scoped_lock lock(*mutex_);
+    AddInUse(bucket, &stats_);
+    std::map<std::pair<int, size_t>, vector<void*> >::iterator it =
+        free_blocks_.find(std::make_pair(node, bucket));
+    if (it != free_blocks_.end() && !it->second.empty()) {
+      ptr = it->second.back();
+      it->second.pop_back();
+      stats_.bytes_cached -= bucket;
+      ++stats_.cache_hits;
+    }
+  }
+  if (!ptr) {
+    ptr = AllocateAligned(bucket, node);
+  }
+  if (node >= 0) {
+    boost::mutex::scoped_lock lock(*mutex_);
+    block_nodes_[ptr] = node;
+  }
+  return ptr;
+}
+
+void CachingHostAllocator::Free(void* ptr, size_t size) {
+  const size_t bucket = BucketSize(size);
+  {
+    boost::mutex::scoped_lock lock(*mutex_);
+    stats_.bytes_in_use -= bucket;
+    int node = -1;
+    std::map<void*, int>::iterator it = block_nodes_.find(ptr);
+    if (it != block_nodes_.end()) {
+      node = it->second;
+      block_nodes_.erase(it);
+    }
+    if (stats_.bytes_cached + bucket <= max_cached_bytes_) {
+      free_blocks_[std::make_pair(node, bucket)].push_back(ptr);
+      stats_.bytes_cached += bucket;
+      return;
+    }
+  }
+  free(ptr);
+}
+
+void CachingHostAllocator::EmptyCache() {
+  boost::mutex::scoped_lock lock(*mutex_);
+  for (std::map<std::pair<int, size_t>, vector<void*> >::iterator it =
+       free_blocks_.begin(); it != free_blocks_.end(); ++it) {
+    for (int i = 0; i < it->second.size(); ++i) {
+      free(it->second[i]);
+    }
+  }
+  free_blocks_.clear();
+  stats_.bytes_cached = 0;
+}
+
+HostAllocator::Stats CachingHostAllocator::stats() const {
+  boost::mutex::scoped_lock lock(*mutex_);
+  return stats_;
+}
+
+// The allocator is never destroyed, as blobs may be freed during the
+// destruction of static objects.
+static shared_ptr<HostAllocator>& HostAllocatorInstance() {
+  static shared_ptr<HostAllocator>* instance =
+      new shared_ptr<HostAllocator>(new CachingHostAllocator());
+  return *instance;
+}
+
+HostAllocator* Caffe::host_allocator() {
+  return HostAllocatorInstance().get();
+}
+
+void Caffe::set_host_allocator(const shared_ptr<HostAllocator>& allocator) {
+  CHECK(allocator);
+  HostAllocatorInstance() = allocator;
+}
+
+}  // namespace caffe
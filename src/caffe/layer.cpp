@@ -1,4 +1,8 @@
 #include <boost/thread.hpp>
+
+#include <climits>
+#include <vector>
+
 #include "caffe/layer.hpp"
 
 namespace caffe {
@@ -22,6 +26,62 @@ void Layer<Dtype>::Unlock() {
   }
 }
 
+template <typename Dtype>
+void Layer<Dtype>::CheckBlobSizes(const vector<Blob<Dtype>*>& bottom,
+    const vector<Blob<Dtype>*>& top) const {
+  if (AllowLargeBlobs() && Caffe::mode() == Caffe::CPU) {
+    return;
+  }
+  for (int i = 0; i < bottom.size(); ++i) {
+    CHECK_LE(bottom[i]->count(), INT_MAX) << type() << " layer "
+        << layer_param_.name() << " cannot index bottom " << i
+        << " of more than INT_MAX elements";
+  }
+  for (int i = 0; i < top.size(); ++i) {
+    CHECK_LE(top[i]->count(), INT_MAX) << type() << " layer "
+        << layer_param_.name() << " cannot index top " << i
+        << " of more than INT_MAX elements";
+  }
+  for (int i = 0; i < blobs_.size(); ++i) {
+    CHECK_LE(blobs_[i]->count(), INT_MAX) << type() << " layer "
+        << layer_param_.name() << " cannot index parameter " << i
+        << " of more than INT_MAX elements";
+  }
+}
+
+template <typename Dtype>
+bool Layer<Dtype>::ReshapeIfChanged(const vector<Blob<Dtype>*>& bottom,
+    const vector<Blob<Dtype>*>& top) {
+  bool changed = !ReshapesFromBottomShapes() ||
+      reshaped_shapes_.size() != bottom.size() || bottom.empty();
+  for (int i = 0; i < bottom.size() && !changed; ++i) {
+    changed = bottom[i]->shape() != reshaped_shapes_[i] ||
+        bottom[i]->data_memory() != reshaped_data_[i] ||
+        bottom[i]->diff_memory() != reshaped_diff_[i];
+  }
+  if (!changed) {
+    return false;
+  }
+  Reshape(bottom, top);
+  reshaped_shapes_.resize(bottom.size());
+  reshaped_data_.resize(bottom.size());
+  reshaped_diff_.resize(bottom.size());
+  for (int i = 0; i < bottom.size(); ++i) {
+    reshaped_shapes_[i] = bottom[i]->shape();
+    reshaped_data_[i] = bottom[i]->data_memory();
+    reshaped_diff_[i] = bottom[i]->diff_memory();
+  }
+  return true;
+}
+
+template <typename Dtype>
+void Layer<Dtype>::set_reshape_on_change(bool reshape_on_change) {
+  reshape_on_change_ = reshape_on_change;
+  reshaped_shapes_.clear();
+  reshaped_data_.clear();
+  reshaped_diff_.clear();
+}
+
 INSTANTIATE_CLASS(Layer);
 
 }  // namespace caffe
@@ -57,17 +57,17 @@ template <typename Dtype>
 void ConcatLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   if (bottom.size() == 1) { return; }
-  Dtype* top_data = top[0]->mutable_cpu_data();
   int offset_concat_axis = 0;
   const int top_concat_axis = top[0]->shape(concat_axis_);
+  // Copies by blocks, converting activations stored in half precision.
+  vector<Dtype> buffer;
   for (int i = 0; i < bottom.size(); ++i) {
-    const Dtype* bottom_data = bottom[i]->cpu_data();
     const int bottom_concat_axis = bottom[i]->shape(concat_axis_);
+    const int count = bottom_concat_axis * concat_input_size_;
     for (int n = 0; n < num_concats_; ++n) {
-      caffe_copy(bottom_concat_axis * concat_input_size_,
-          bottom_data + n * bottom_concat_axis * concat_input_size_,
-          top_data + (n * top_concat_axis + offset_concat_axis)
-              * concat_input_size_);
+      top[0]->set_cpu_data_block(
+          (n * top_concat_axis + offset_concat_axis) * concat_input_size_,
+          count, bottom[i]->cpu_data_block(n * count, count, &buffer));
     }
     offset_concat_axis += bottom_concat_axis;
   }
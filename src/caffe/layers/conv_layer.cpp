@@ -24,17 +24,24 @@ void ConvolutionLayer<Dtype>::compute_output_shape() {
 template <typename Dtype>
 void ConvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
-  const Dtype* weight = this->blobs_[0]->cpu_data();
+  // Weights stored in half precision are converted back once per pass.
+  vector<Dtype> weight_buffer;
+  const Dtype* weight = this->blobs_[0]->cpu_data_block(0,
+      this->blobs_[0]->count(), &weight_buffer);
+  vector<Dtype> bottom_buffer, top_buffer;
   for (int i = 0; i < bottom.size(); ++i) {
-    const Dtype* bottom_data = bottom[i]->cpu_data();
-    Dtype* top_data = top[i]->mutable_cpu_data();
     for (int n = 0; n < this->num_; ++n) {
-      this->forward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
-          top_data + n * this->top_dim_);
+      const Dtype* bottom_data = bottom[i]->cpu_data_block(
+          n * this->bottom_dim_, this->bottom_dim_, &bottom_buffer);
+      Dtype* top_data = top[i]->mutable_cpu_data_block(n * this->top_dim_,
+          this->top_dim_, &top_buffer);
+      this->forward_cpu_gemm(bottom_data, weight, top_data);
       if (this->bias_term_) {
         const Dtype* bias = this->blobs_[1]->cpu_data();
-        this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
+        this->forward_cpu_bias(top_data, bias);
       }
+      top[i]->set_cpu_data_block(n * this->top_dim_, this->top_dim_,
+          top_data);
     }
   }
 }
@@ -1,3 +1,4 @@
+#include <climits>
 #include <vector>
 
 #include "caffe/filler.hpp"
@@ -48,7 +49,8 @@ void EmbedLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
 template <typename Dtype>
 void EmbedLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
-  // Figure out the dimensions
+  // Figure out the dimensions; the top alone may exceed INT_MAX elements.
+  CHECK_LE(bottom[0]->count(), INT_MAX) << "Too many indices";
   M_ = bottom[0]->count();
   vector<int> top_shape = bottom[0]->shape();
   top_shape.push_back(N_);
@@ -73,7 +75,8 @@ void EmbedLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     DCHECK_GE(index, 0);
     DCHECK_LT(index, K_);
     DCHECK_EQ(static_cast<Dtype>(index), bottom_data[n]) << "non-integer input";
-    caffe_copy(N_, weight + index * N_, top_data + n * N_);
+    caffe_copy(N_, weight + static_cast<int64_t>(index) * N_,
+        top_data + static_cast<int64_t>(n) * N_);
   }
   if (bias_term_) {
     const Dtype* bias = this->blobs_[1]->cpu_data();
@@ -98,7 +101,8 @@ void EmbedLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
       DCHECK_LT(index, K_);
       DCHECK_EQ(static_cast<Dtype>(index), bottom_data[n])
           << "non-integer input";
-      caffe_axpy(N_, Dtype(1), top_diff + n * N_, weight_diff + index * N_);
+      caffe_axpy(N_, Dtype(1), top_diff + static_cast<int64_t>(n) * N_,
+          weight_diff + static_cast<int64_t>(index) * N_);
     }
   }
   if (bias_term_ && this->param_propagate_down_[1]) {
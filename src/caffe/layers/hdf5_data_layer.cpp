@@ -1,11 +1,10 @@
 /*
 TODO:
-- load file in a separate thread ("prefetch")
 - can be smarter about the memcpy call instead of doing it row-by-row
   :: use util functions caffe_copy, and Blob->offset()
   :: don't forget to update hdf5_daa_layer.cu accordingly
-- add ability to shuffle filenames if flag is set
 */
+#include <boost/thread.hpp>
 #include <fstream>  // NOLINT(readability/streams)
 #include <string>
 #include <vector>
@@ -20,60 +19,130 @@ TODO:
 namespace caffe {
 
 template <typename Dtype>
-HDF5DataLayer<Dtype>::~HDF5DataLayer<Dtype>() { }
+HDF5DataLayer<Dtype>::~HDF5DataLayer<Dtype>() {
+  this->StopInternalThread();
+}
 
-// Load data and label from HDF5 filename into the class property blobs.
+// Load data and label from the HDF5 file rows of chunk into its blobs.
 template <typename Dtype>
-void HDF5DataLayer<Dtype>::LoadHDF5FileData(const char* filename) {
-  DLOG(INFO) << "Loading HDF5 file: " << filename;
+void HDF5DataLayer<Dtype>::LoadHDF5FileData(HDF5Chunk<Dtype>* chunk) {
+  const char* filename = chunk->filename_.c_str();
+  DLOG(INFO) << "Loading HDF5 file: " << filename << " from row "
+      << chunk->row_start_;
+  HDF5Lock lock;
   hid_t file_id = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
   if (file_id < 0) {
     LOG(FATAL) << "Failed opening HDF5 file: " << filename;
   }
 
   int top_size = this->layer_param_.top_size();
-  hdf_blobs_.resize(top_size);
+  chunk->blobs_.resize(top_size);
 
   const int MIN_DATA_DIM = 1;
   const int MAX_DATA_DIM = INT_MAX;
 
   for (int i = 0; i < top_size; ++i) {
-    hdf_blobs_[i] = shared_ptr<Blob<Dtype> >(new Blob<Dtype>());
-    hdf5_load_nd_dataset(file_id, this->layer_param_.top(i).c_str(),
-        MIN_DATA_DIM, MAX_DATA_DIM, hdf_blobs_[i].get());
+    if (!chunk->blobs_[i]) {
+      chunk->blobs_[i].reset(new Blob<Dtype>());
+    }
+    const hsize_t file_rows = hdf5_load_nd_dataset_rows(file_id,
+        this->layer_param_.top(i).c_str(), MIN_DATA_DIM, MAX_DATA_DIM,
+        chunk->row_start_, chunk->num_rows_, chunk->blobs_[i].get());
+    // MinTopBlobs==1 guarantees at least one top blob
+    if (i == 0) {
+      chunk->file_rows_ = file_rows;
+    } else {
+      CHECK_EQ(file_rows, chunk->file_rows_);
+    }
   }
 
   herr_t status = H5Fclose(file_id);
   CHECK_GE(status, 0) << "Failed to close HDF5 file: " << filename;
+  DLOG(INFO) << "Successully loaded " << chunk->blobs_[0]->shape(0) << " rows";
+}
+
+template <typename Dtype>
+void HDF5DataLayer<Dtype>::InternalThreadEntry() {
+  try {
+    while (!must_stop()) {
+      HDF5Chunk<Dtype>* chunk = load_queue_.pop();
+      LoadHDF5FileData(chunk);
+      loaded_queue_.push(chunk);
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
+template <typename Dtype>
+void HDF5DataLayer<Dtype>::PrefetchNextChunk() {
+  const hsize_t chunk_rows = this->layer_param_.hdf5_data_param().chunk_rows();
+  const hsize_t next_row = current_->row_start_ + current_->blobs_[0]->shape(0);
+  if (next_row < current_->file_rows_) {
+    // Next rows of the same file.
+    next_->filename_ = current_->filename_;
+    next_->row_start_ = next_row;
+  } else {
+    if (num_files_ > 1) {
+      ++current_file_;
+      if (current_file_ == num_files_) {
+        current_file_ = 0;
+        if (this->layer_param_.hdf5_data_param().shuffle()) {
+          std::random_shuffle(file_permutation_.begin(),
+                              file_permutation_.end());
+        }
+        DLOG(INFO) << "Looping around to first file.";
+      }
+    }
+    next_->filename_ = hdf_filenames_[file_permutation_[current_file_]];
+    next_->row_start_ = 0;
+  }
+  next_->num_rows_ = chunk_rows;
+  next_is_current_ = next_->filename_ == current_->filename_
+      && next_->row_start_ == current_->row_start_;
+  if (!next_is_current_) {
+    load_queue_.push(next_);
+  }
+}
 
-  // MinTopBlobs==1 guarantees at least one top blob
-  CHECK_GE(hdf_blobs_[0]->num_axes(), 1) << "Input must have at least 1 axis.";
-  const int num = hdf_blobs_[0]->shape(0);
-  for (int i = 1; i < top_size; ++i) {
-    CHECK_EQ(hdf_blobs_[i]->shape(0), num);
+template <typename Dtype>
+void HDF5DataLayer<Dtype>::NextChunk() {
+  if (!next_is_current_) {
+    loaded_queue_.pop("Waiting for HDF5 data");
+    std::swap(current_, next_);
+    PrefetchNextChunk();
   }
+  current_row_ = 0;
   // Default to identity permutation.
-  data_permutation_.clear();
-  data_permutation_.resize(hdf_blobs_[0]->shape(0));
-  for (int i = 0; i < hdf_blobs_[0]->shape(0); i++)
+  const int num = current_->blobs_[0]->shape(0);
+  data_permutation_.resize(num);
+  for (int i = 0; i < num; i++)
     data_permutation_[i] = i;
-
   // Shuffle if needed.
   if (this->layer_param_.hdf5_data_param().shuffle()) {
     std::random_shuffle(data_permutation_.begin(), data_permutation_.end());
-    DLOG(INFO) << "Successully loaded " << hdf_blobs_[0]->shape(0)
-               << " rows (shuffled)";
-  } else {
-    DLOG(INFO) << "Successully loaded " << hdf_blobs_[0]->shape(0) << " rows";
   }
 }
 
+template <typename Dtype>
+unsigned int HDF5DataLayer<Dtype>::NextRow() {
+  if (current_row_ == current_->blobs_[0]->shape(0)) {
+    NextChunk();
+  }
+  return data_permutation_[current_row_++];
+}
+
 template <typename Dtype>
 void HDF5DataLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   // Refuse transformation parameters since HDF5 is totally generic.
   CHECK(!this->layer_param_.has_transform_param()) <<
       this->type() << " does not transform data.";
+  // Stop prefetching if the layer is set up again.
+  this->StopInternalThread();
+  HDF5Chunk<Dtype>* chunk;
+  while (load_queue_.try_pop(&chunk)) {}
+  while (loaded_queue_.try_pop(&chunk)) {}
   // Read the source to parse the filenames.
   const string& source = this->layer_param_.hdf5_data_param().source();
   LOG(INFO) << "Loading list of HDF5 filenames from: " << source;
@@ -106,19 +175,28 @@ void HDF5DataLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
     std::random_shuffle(file_permutation_.begin(), file_permutation_.end());
   }
 
-  // Load the first HDF5 file and initialize the line counter.
-  LoadHDF5FileData(hdf_filenames_[file_permutation_[current_file_]].c_str());
-  current_row_ = 0;
+  // Load the first chunk on the prefetch thread and wait for it.
+  current_ = &chunks_[0];
+  next_ = &chunks_[1];
+  next_->filename_ = hdf_filenames_[file_permutation_[current_file_]];
+  next_->row_start_ = 0;
+  next_->num_rows_ = this->layer_param_.hdf5_data_param().chunk_rows();
+  next_is_current_ = false;
+  StartInternalThread();
+  load_queue_.push(next_);
+  NextChunk();
+  CHECK_GT(current_->blobs_[0]->shape(0), 0) << "Empty HDF5 file: "
+      << current_->filename_;
 
   // Reshape blobs.
   const int batch_size = this->layer_param_.hdf5_data_param().batch_size();
   const int top_size = this->layer_param_.top_size();
   vector<int> top_shape;
   for (int i = 0; i < top_size; ++i) {
-    top_shape.resize(hdf_blobs_[i]->num_axes());
+    top_shape.resize(current_->blobs_[i]->num_axes());
     top_shape[0] = batch_size;
     for (int j = 1; j < top_shape.size(); ++j) {
-      top_shape[j] = hdf_blobs_[i]->shape(j);
+      top_shape[j] = current_->blobs_[i]->shape(j);
     }
     top[i]->Reshape(top_shape);
   }
@@ -128,30 +206,13 @@ template <typename Dtype>
 void HDF5DataLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   const int batch_size = this->layer_param_.hdf5_data_param().batch_size();
-  for (int i = 0; i < batch_size; ++i, ++current_row_) {
-    if (current_row_ == hdf_blobs_[0]->shape(0)) {
-      if (num_files_ > 1) {
-        ++current_file_;
-        if (current_file_ == num_files_) {
-          current_file_ = 0;
-          if (this->layer_param_.hdf5_data_param().shuffle()) {
-            std::random_shuffle(file_permutation_.begin(),
-                                file_permutation_.end());
-          }
-          DLOG(INFO) << "Looping around to first file.";
-        }
-        LoadHDF5FileData(
-            hdf_filenames_[file_permutation_[current_file_]].c_str());
-      }
-      current_row_ = 0;
-      if (this->layer_param_.hdf5_data_param().shuffle())
-        std::random_shuffle(data_permutation_.begin(), data_permutation_.end());
-    }
+  for (int i = 0; i < batch_size; ++i) {
+    const unsigned int row = NextRow();
     for (int j = 0; j < this->layer_param_.top_size(); ++j) {
       int data_dim = top[j]->count() / top[j]->shape(0);
       caffe_copy(data_dim,
-          &hdf_blobs_[j]->cpu_data()[data_permutation_[current_row_]
-            * data_dim], &top[j]->mutable_cpu_data()[i * data_dim]);
+          &current_->blobs_[j]->cpu_data()[row * data_dim],
+          &top[j]->mutable_cpu_data()[i * data_dim]);
     }
   }
 }
@@ -6,6 +6,15 @@
 
 namespace caffe {
 
+template <typename Dtype>
+void HingeLossLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
+    const vector<Blob<Dtype>*>& top) {
+  LossLayer<Dtype>::LayerSetUp(bottom, top);
+  // Forward computes the margins in the diff of the predictions, which needs
+  // one even in inference-only nets.
+  bottom[0]->set_has_diff(true);
+}
+
 template <typename Dtype>
 void HingeLossLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     const vector<Blob<Dtype>*>& top) {
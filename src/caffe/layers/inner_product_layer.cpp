@@ -2,6 +2,7 @@
 
 #include "caffe/filler.hpp"
 #include "caffe/layers/inner_product_layer.hpp"
+#include "caffe/util/half.hpp"
 #include "caffe/util/math_functions.hpp"
 
 namespace caffe {
@@ -83,17 +84,29 @@ void InnerProductLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
 template <typename Dtype>
 void InnerProductLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     const vector<Blob<Dtype>*>& top) {
-  const Dtype* bottom_data = bottom[0]->cpu_data();
-  Dtype* top_data = top[0]->mutable_cpu_data();
-  const Dtype* weight = this->blobs_[0]->cpu_data();
-  caffe_cpu_gemm<Dtype>(CblasNoTrans, transpose_ ? CblasNoTrans : CblasTrans,
-      M_, N_, K_, (Dtype)1.,
-      bottom_data, weight, (Dtype)0., top_data);
+  // Activations stored in half precision are converted whole, so that the
+  // weights are still read once.
+  vector<Dtype> bottom_buffer, top_buffer;
+  const Dtype* bottom_data = bottom[0]->cpu_data_block(0, bottom[0]->count(),
+      &bottom_buffer);
+  Dtype* top_data = top[0]->mutable_cpu_data_block(0, top[0]->count(),
+      &top_buffer);
+  if (this->blobs_[0]->half()) {
+    caffe_cpu_gemm_half_b<Dtype>(transpose_ ? CblasNoTrans : CblasTrans,
+        M_, N_, K_, (Dtype)1., bottom_data, this->blobs_[0]->cpu_half_data(),
+        (Dtype)0., top_data);
+  } else {
+    const Dtype* weight = this->blobs_[0]->cpu_data();
+    caffe_cpu_gemm<Dtype>(CblasNoTrans, transpose_ ? CblasNoTrans : CblasTrans,
+        M_, N_, K_, (Dtype)1.,
+        bottom_data, weight, (Dtype)0., top_data);
+  }
   if (bias_term_) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, M_, N_, 1, (Dtype)1.,
         bias_multiplier_.cpu_data(),
         this->blobs_[1]->cpu_data(), (Dtype)1., top_data);
   }
+  top[0]->set_cpu_data_block(0, top[0]->count(), top_data);
 }
 
 template <typename Dtype>
@@ -127,9 +127,11 @@ void PoolingLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
 template <typename Dtype>
 void PoolingLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
-  const Dtype* bottom_data = bottom[0]->cpu_data();
-  Dtype* top_data = top[0]->mutable_cpu_data();
   const int top_count = top[0]->count();
+  // Activations stored in half precision are converted image by image.
+  const int bottom_dim = bottom[0]->count(1);
+  const int top_dim = top[0]->count(1);
+  vector<Dtype> bottom_buffer, top_buffer;
   // We'll output the mask to top[1] if it's of size >1.
   const bool use_top_mask = top.size() > 1;
   int* mask = NULL;  // suppress warnings about uninitalized variables
@@ -146,9 +148,14 @@ void PoolingLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       mask = max_idx_.mutable_cpu_data();
       caffe_set(top_count, -1, mask);
     }
-    caffe_set(top_count, Dtype(-FLT_MAX), top_data);
     // The main loop
     for (int n = 0; n < bottom[0]->num(); ++n) {
+      const Dtype* bottom_data = bottom[0]->cpu_data_block(n * bottom_dim,
+          bottom_dim, &bottom_buffer);
+      Dtype* const top_image = top[0]->mutable_cpu_data_block(n * top_dim,
+          top_dim, &top_buffer);
+      Dtype* top_data = top_image;
+      caffe_set(top_dim, Dtype(-FLT_MAX), top_data);
       for (int c = 0; c < channels_; ++c) {
         for (int ph = 0; ph < pooled_height_; ++ph) {
           for (int pw = 0; pw < pooled_width_; ++pw) {
@@ -183,14 +190,20 @@ void PoolingLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
           mask += top[0]->offset(0, 1);
         }
       }
+      top[0]->set_cpu_data_block(n * top_dim, top_dim, top_image);
     }
     break;
   case PoolingParameter_PoolMethod_AVE:
-    for (int i = 0; i < top_count; ++i) {
-      top_data[i] = 0;
-    }
     // The main loop
     for (int n = 0; n < bottom[0]->num(); ++n) {
+      const Dtype* bottom_data = bottom[0]->cpu_data_block(n * bottom_dim,
+          bottom_dim, &bottom_buffer);
+      Dtype* const top_image = top[0]->mutable_cpu_data_block(n * top_dim,
+          top_dim, &top_buffer);
+      Dtype* top_data = top_image;
+      for (int i = 0; i < top_dim; ++i) {
+        top_data[i] = 0;
+      }
       for (int c = 0; c < channels_; ++c) {
         for (int ph = 0; ph < pooled_height_; ++ph) {
           for (int pw = 0; pw < pooled_width_; ++pw) {
@@ -216,6 +229,7 @@ void PoolingLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
         bottom_data += bottom[0]->offset(0, 1);
         top_data += top[0]->offset(0, 1);
       }
+      top[0]->set_cpu_data_block(n * top_dim, top_dim, top_image);
     }
     break;
   case PoolingParameter_PoolMethod_STOCHASTIC:
@@ -2,19 +2,29 @@
 #include <vector>
 
 #include "caffe/layers/relu_layer.hpp"
+#include "caffe/util/half.hpp"
 
 namespace caffe {
 
 template <typename Dtype>
 void ReLULayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     const vector<Blob<Dtype>*>& top) {
-  const Dtype* bottom_data = bottom[0]->cpu_data();
-  Dtype* top_data = top[0]->mutable_cpu_data();
-  const int count = bottom[0]->count();
+  const int64_t count = bottom[0]->count();
   Dtype negative_slope = this->layer_param_.relu_param().negative_slope();
-  for (int i = 0; i < count; ++i) {
-    top_data[i] = std::max(bottom_data[i], Dtype(0))
-        + negative_slope * std::min(bottom_data[i], Dtype(0));
+  // Activations stored in half precision are converted by blocks.
+  const int64_t block = bottom[0]->half() || top[0]->half() ?
+      kHalfBlockSize : std::max<int64_t>(count, 1);
+  vector<Dtype> bottom_buffer, top_buffer;
+  for (int64_t start = 0; start < count; start += block) {
+    const int64_t n = std::min(block, count - start);
+    const Dtype* bottom_data = bottom[0]->cpu_data_block(start, n,
+        &bottom_buffer);
+    Dtype* top_data = top[0]->mutable_cpu_data_block(start, n, &top_buffer);
+    for (int64_t i = 0; i < n; ++i) {
+      top_data[i] = std::max(bottom_data[i], Dtype(0))
+          + negative_slope * std::min(bottom_data[i], Dtype(0));
+    }
+    top[0]->set_cpu_data_block(start, n, top_data);
   }
 }
 
@@ -26,9 +36,9 @@ void ReLULayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     const Dtype* bottom_data = bottom[0]->cpu_data();
     const Dtype* top_diff = top[0]->cpu_diff();
     Dtype* bottom_diff = bottom[0]->mutable_cpu_diff();
-    const int count = bottom[0]->count();
+    const int64_t count = bottom[0]->count();
     Dtype negative_slope = this->layer_param_.relu_param().negative_slope();
-    for (int i = 0; i < count; ++i) {
+    for (int64_t i = 0; i < count; ++i) {
       bottom_diff[i] = top_diff[i] * ((bottom_data[i] > 0)
           + negative_slope * (bottom_data[i] <= 0));
     }
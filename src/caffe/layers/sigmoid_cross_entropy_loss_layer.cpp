@@ -10,6 +10,12 @@ template <typename Dtype>
 void SigmoidCrossEntropyLossLayer<Dtype>::LayerSetUp(
     const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
   LossLayer<Dtype>::LayerSetUp(bottom, top);
+  // Forward_gpu computes the losses and counts in the diffs of the bottoms,
+  // which need them even in inference-only nets.
+  if (Caffe::mode() == Caffe::GPU) {
+    bottom[0]->set_has_diff(true);
+    bottom[1]->set_has_diff(true);
+  }
   sigmoid_bottom_vec_.clear();
   sigmoid_bottom_vec_.push_back(bottom[0]);
   sigmoid_top_vec_.clear();
@@ -110,14 +116,14 @@ void SigmoidCrossEntropyLossLayer<Dtype>::Backward_cpu(
   }
   if (propagate_down[0]) {
     // First, compute the diff
-    const int count = bottom[0]->count();
+    const int64_t count = bottom[0]->count();
     const Dtype* sigmoid_output_data = sigmoid_output_->cpu_data();
     const Dtype* target = bottom[1]->cpu_data();
     Dtype* bottom_diff = bottom[0]->mutable_cpu_diff();
     caffe_sub(count, sigmoid_output_data, target, bottom_diff);
     // Zero out gradient of ignored targets.
     if (has_ignore_label_) {
-      for (int i = 0; i < count; ++i) {
+      for (int64_t i = 0; i < count; ++i) {
         const int target_value = static_cast<int>(target[i]);
         if (target_value == ignore_label_) {
           bottom_diff[i] = 0;
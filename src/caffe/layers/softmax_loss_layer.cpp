@@ -11,6 +11,11 @@ template <typename Dtype>
 void SoftmaxWithLossLayer<Dtype>::LayerSetUp(
     const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
   LossLayer<Dtype>::LayerSetUp(bottom, top);
+  // Forward_gpu computes the losses in the diff of the predictions, which
+  // needs one even in inference-only nets.
+  if (Caffe::mode() == Caffe::GPU) {
+    bottom[0]->set_has_diff(true);
+  }
   LayerParameter softmax_param(this->layer_param_);
   softmax_param.set_type("Softmax");
   softmax_layer_ = LayerRegistry<Dtype>::CreateLayer(softmax_param);
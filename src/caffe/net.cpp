@@ -1,4 +1,8 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 #include <algorithm>
+#include <list>
 #include <map>
 #include <set>
 #include <string>
@@ -12,18 +16,50 @@
 #include "caffe/net.hpp"
 #include "caffe/parallel.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/syncedmem.hpp"
+#include "caffe/util/half.hpp"
 #include "caffe/util/hdf5.hpp"
 #include "caffe/util/insert_splits.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/numa.hpp"
 #include "caffe/util/upgrade_proto.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
 
 namespace caffe {
 
+// Binds the calling thread to a NUMA node, unless -1, while in scope, as
+// Caffe::SetNumaNode does.
+class NumaNodeScope {
+ public:
+  explicit NumaNodeScope(int node)
+      : previous_node_(Caffe::numa_node()),
+        previous_pinned_(Caffe::numa_pinned()),
+        bound_(node >= 0 && (node != previous_node_ || !previous_pinned_)) {
+    if (bound_) {
+      Caffe::SetNumaNode(node);
+    }
+  }
+  ~NumaNodeScope() {
+    if (bound_) {
+      Caffe::SetNumaNode(previous_node_, previous_pinned_);
+    }
+  }
+
+ private:
+  const int previous_node_;
+  const bool previous_pinned_;
+  const bool bound_;
+
+  DISABLE_COPY_AND_ASSIGN(NumaNodeScope);
+};
+
 template <typename Dtype>
 Net<Dtype>::Net(const NetParameter& param, const Net* root_net)
-    : root_net_(root_net) {
+    : forward_threads_(1), numa_node_(-1), reshape_on_change_(false),
+      inference_shapes_(0),
+      root_net_(root_net),
+      profiling_(false) {
   Init(param);
 }
 
@@ -31,7 +67,10 @@ template <typename Dtype>
 Net<Dtype>::Net(const string& param_file, Phase phase,
     const int level, const vector<string>* stages,
     const Net* root_net)
-    : root_net_(root_net) {
+    : forward_threads_(1), numa_node_(-1), reshape_on_change_(false),
+      inference_shapes_(0),
+      root_net_(root_net),
+      profiling_(false) {
   NetParameter param;
   ReadNetParamsFromTextFileOrDie(param_file, &param);
   // Set phase, stages and level
@@ -46,21 +85,91 @@ Net<Dtype>::Net(const string& param_file, Phase phase,
 }
 
 template <typename Dtype>
-void Net<Dtype>::Init(const NetParameter& in_param) {
+Net<Dtype>::Net(const NetParameter& param, const Net& source)
+    : forward_threads_(1), numa_node_(-1), reshape_on_change_(false),
+      inference_shapes_(0),
+      root_net_(source.root_net_),
+      profiling_(false) {
+  Init(param, &source);
+}
+
+template <typename Dtype>
+shared_ptr<Net<Dtype> > Net<Dtype>::CloneForInference() const {
+  NetParameter param(split_param_);
+  param.set_inference_only(true);
+  param.set_force_backward(false);
+  param.set_forward_threads(forward_threads_);
+  param.set_reshape_on_change(reshape_on_change_);
+  // Inference runs in the test phase, whatever the phase of this net.
+  param.mutable_state()->set_phase(TEST);
+  for (int i = 0; i < param.layer_size(); ++i) {
+    param.mutable_layer(i)->set_phase(TEST);
+  }
+  shared_ptr<Net<Dtype> > clone(new Net<Dtype>(param, *this));
+  // Parameters may point into the raw models of this net.
+  clone->raw_models_ = raw_models_;
+  return clone;
+}
+
+template <typename Dtype>
+shared_ptr<Net<Dtype> > Net<Dtype>::InferenceNetForShapes(
+    const vector<vector<int> >& input_shapes) {
+  CHECK_EQ(input_shapes.size(), net_input_blobs_.size())
+      << "Need the shape of each input blob";
+  typedef typename std::list<std::pair<vector<vector<int> >,
+      shared_ptr<Net> > >::iterator CloneIterator;
+  for (CloneIterator it = inference_clones_.begin();
+       it != inference_clones_.end(); ++it) {
+    if (it->first == input_shapes) {
+      inference_clones_.splice(inference_clones_.begin(), inference_clones_,
+          it);
+      return it->second;
+    }
+  }
+  shared_ptr<Net> clone = CloneForInference();
+  clone->set_reshape_on_change(true);
+  for (int i = 0; i < input_shapes.size(); ++i) {
+    clone->net_input_blobs_[i]->Reshape(input_shapes[i]);
+  }
+  clone->Reshape();
+  if (inference_shapes_ > 0) {
+    inference_clones_.push_front(std::make_pair(input_shapes, clone));
+    if (inference_clones_.size() > inference_shapes_) {
+      inference_clones_.pop_back();
+    }
+  }
+  return clone;
+}
+
+template <typename Dtype>
+void Net<Dtype>::Init(const NetParameter& in_param, const Net* source) {
   CHECK(Caffe::root_solver() || root_net_)
       << "root_net_ needs to be set for all non-root solvers";
   // Set phase from the state.
   phase_ = in_param.state().phase();
-  // Filter layers based on their include/exclude rules and
-  // the current NetState.
-  NetParameter filtered_param;
-  FilterNet(in_param, &filtered_param);
-  LOG_IF(INFO, Caffe::root_solver())
-      << "Initializing net from parameters: " << std::endl
-      << filtered_param.DebugString();
-  // Create a copy of filtered_param with splits added where necessary.
+  inference_only_ = in_param.inference_only();
+  params_shared_ = source != NULL;
+  CHECK(!inference_only_ || !in_param.force_backward())
+      << "An inference-only net cannot force backward";
+  numa_node_ = in_param.numa_node();
+  CHECK_GE(numa_node_, -1);
+  CHECK_LT(numa_node_, caffe_numa_nodes()) << "No such NUMA node";
+  NumaNodeScope numa_scope(numa_node_);
   NetParameter param;
-  InsertSplits(filtered_param, &param);
+  if (source) {
+    // The layers of source are already filtered, with splits.
+    param = in_param;
+  } else {
+    // Filter layers based on their include/exclude rules and
+    // the current NetState.
+    NetParameter filtered_param;
+    FilterNet(in_param, &filtered_param);
+    LOG_IF(INFO, Caffe::root_solver())
+        << "Initializing net from parameters: " << std::endl
+        << filtered_param.DebugString();
+    // Create a copy of filtered_param with splits added where necessary.
+    InsertSplits(filtered_param, &param);
+  }
   // Basically, build all the layers and set up their connections.
   name_ = param.name();
   map<string, int> blob_name_to_idx;
@@ -95,6 +204,10 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
       layers_[layer_id]->SetShared(true);
     } else {
       layers_.push_back(LayerRegistry<Dtype>::CreateLayer(layer_param));
+      if (source) {
+        // Layers given their parameters skip filling them in SetUp.
+        layers_[layer_id]->blobs() = source->layers_[layer_id]->blobs();
+      }
     }
     layer_names_.push_back(layer_param.name());
     LOG_IF(INFO, Caffe::root_solver())
@@ -147,6 +260,23 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
     } else {
       layers_[layer_id]->SetUp(bottom_vecs_[layer_id], top_vecs_[layer_id]);
     }
+    if (source) {
+      // Layers replacing their parameters in SetUp, as recurrent layers do
+      // with those of their unrolled net, share those of source instead.
+      const vector<shared_ptr<Blob<Dtype> > >& source_blobs =
+          source->layers_[layer_id]->blobs();
+      CHECK_EQ(source_blobs.size(), layer->blobs().size())
+          << "Layer " << layer_param.name() << " changed its parameters";
+      for (int param_id = 0; param_id < source_blobs.size(); ++param_id) {
+        if (layer->blobs()[param_id] != source_blobs[param_id]) {
+          layer->blobs()[param_id]->ShareData(*source_blobs[param_id]);
+        }
+      }
+    } else if (inference_only_) {
+      for (int param_id = 0; param_id < layer->blobs().size(); ++param_id) {
+        layer->blobs()[param_id]->set_has_diff(false);
+      }
+    }
     LOG_IF(INFO, Caffe::root_solver())
         << "Setting up " << layer_names_[layer_id];
     for (int top_id = 0; top_id < top_vecs_[layer_id].size(); ++top_id) {
@@ -172,7 +302,8 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
     for (int param_id = 0; param_id < num_param_blobs; ++param_id) {
       const ParamSpec* param_spec = (param_id < param_size) ?
           &layer_param.param(param_id) : &default_param_spec;
-      const bool param_need_backward = param_spec->lr_mult() != 0;
+      const bool param_need_backward =
+          param_spec->lr_mult() != 0 && !inference_only_;
       need_backward |= param_need_backward;
       layers_[layer_id]->set_param_propagate_down(param_id,
                                                   param_need_backward);
@@ -280,9 +411,93 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
   }
   ShareWeights();
   debug_info_ = param.debug_info();
+  split_param_ = param;
+  for (int i = 0; i < split_param_.layer_size(); ++i) {
+    split_param_.mutable_layer(i)->clear_blobs();
+  }
+  set_forward_threads(in_param.forward_threads());
+  set_reshape_on_change(in_param.reshape_on_change());
+  set_inference_shapes(in_param.inference_shapes());
+  if (in_param.memory_budget() > 0) {
+    CheckMemoryBudget(in_param.memory_budget());
+  }
   LOG_IF(INFO, Caffe::root_solver()) << "Network initialization done.";
 }
 
+// Returns the representative of the set of element i, halving the paths.
+static int FindSet(vector<int>* parents, int i) {
+  while ((*parents)[i] != i) {
+    i = (*parents)[i] = (*parents)[(*parents)[i]];
+  }
+  return i;
+}
+
+template <typename Dtype>
+void Net<Dtype>::InitLayerDependencies() {
+  // Group the blobs sharing data, as set up by the layers.
+  vector<int> groups(blobs_.size());
+  map<const SyncedMemory*, int> memory_blobs;
+  for (int i = 0; i < blobs_.size(); ++i) {
+    groups[i] = i;
+    if (blobs_[i]->count() == 0 && blobs_[i]->capacity() == 0) {
+      continue;
+    }
+    const SyncedMemory* memory = blobs_[i]->data_memory();
+    map<const SyncedMemory*, int>::iterator it = memory_blobs.find(memory);
+    if (it == memory_blobs.end()) {
+      memory_blobs[memory] = i;
+    } else {
+      groups[FindSet(&groups, i)] = FindSet(&groups, it->second);
+    }
+  }
+  for (int i = 0; i < blobs_.size(); ++i) {
+    groups[i] = FindSet(&groups, i);
+  }
+  // A layer writing a group runs after the last writer of the group and its
+  // readers since, and a layer reading it after the last writer.
+  vector<int> last_writers(blobs_.size(), -1);
+  vector<vector<int> > readers(blobs_.size());
+  layer_dependencies_.assign(layers_.size(), vector<int>());
+  for (int i = 0; i < layers_.size(); ++i) {
+    set<int> dependencies;
+    for (int j = 0; j < bottom_id_vecs_[i].size(); ++j) {
+      const int group = groups[bottom_id_vecs_[i][j]];
+      if (last_writers[group] >= 0) {
+        dependencies.insert(last_writers[group]);
+      }
+    }
+    for (int j = 0; j < top_id_vecs_[i].size(); ++j) {
+      const int group = groups[top_id_vecs_[i][j]];
+      if (last_writers[group] >= 0) {
+        dependencies.insert(last_writers[group]);
+      }
+      dependencies.insert(readers[group].begin(), readers[group].end());
+    }
+    for (int j = 0; j < bottom_id_vecs_[i].size(); ++j) {
+      readers[groups[bottom_id_vecs_[i][j]]].push_back(i);
+    }
+    for (int j = 0; j < top_id_vecs_[i].size(); ++j) {
+      const int group = groups[top_id_vecs_[i][j]];
+      last_writers[group] = i;
+      readers[group].clear();
+    }
+    dependencies.erase(i);
+    layer_dependencies_[i].assign(dependencies.begin(), dependencies.end());
+  }
+}
+
+template <typename Dtype>
+void Net<Dtype>::set_forward_threads(int threads) {
+  CHECK_GE(threads, 0);
+  if (threads == 0) {
+    threads = std::max<int>(1, boost::thread::hardware_concurrency());
+  }
+  if (threads != forward_threads_) {
+    forward_scheduler_.reset();
+    forward_threads_ = threads;
+  }
+}
+
 template <typename Dtype>
 void Net<Dtype>::FilterNet(const NetParameter& param,
     NetParameter* param_filtered) {
@@ -408,6 +623,9 @@ void Net<Dtype>::AppendTop(const NetParameter& param, const int layer_id,
       LOG(INFO) << layer_param->name() << " -> " << blob_name;
     }
     shared_ptr<Blob<Dtype> > blob_pointer(new Blob<Dtype>());
+    if (inference_only_) {
+      blob_pointer->set_has_diff(false);
+    }
     const int blob_id = blobs_.size();
     blobs_.push_back(blob_pointer);
     blob_names_.push_back(blob_name);
@@ -540,20 +758,229 @@ void Net<Dtype>::AppendParam(const NetParameter& param, const int layer_id,
   }
 }
 
+template <typename Dtype>
+size_t Net<Dtype>::StoreWeightsAsHalf() {
+  CHECK(inference_only_)
+      << "Only inference-only nets can store their weights as half";
+  CHECK_EQ(Caffe::mode(), Caffe::CPU)
+      << "Only nets running on the CPU can store their weights as half";
+  if (params_shared_) {
+    LOG_IF(INFO, Caffe::root_solver()) << "Not storing the weights of "
+        << name_ << " as half, as they are shared with its source";
+    return 0;
+  }
+  size_t released = 0;
+  for (int i = 0; i < layers_.size(); ++i) {
+    for (int j = 0; j < layers_[i]->blobs().size(); ++j) {
+      if (layers_[i]->AllowHalfParam(j)) {
+        released += layers_[i]->blobs()[j]->StoreAsHalf();
+      }
+    }
+  }
+  LOG_IF(INFO, Caffe::root_solver()) << "Stored the weights of " << name_
+      << " as half, releasing " << released << " bytes";
+  return released;
+}
+
+template <typename Dtype>
+size_t Net<Dtype>::StoreActivationsAsHalf() {
+  CHECK(inference_only_)
+      << "Only inference-only nets can store their activations as half";
+  CHECK_EQ(Caffe::mode(), Caffe::CPU)
+      << "Only nets running on the CPU can store their activations as half";
+  // Split layers share their bottom with their tops, which go alike.
+  vector<int> groups(blobs_.size());
+  for (int i = 0; i < blobs_.size(); ++i) {
+    groups[i] = i;
+  }
+  for (int i = 0; i < layers_.size(); ++i) {
+    if (layers_[i]->layer_param().type() == "Split") {
+      for (int j = 0; j < top_id_vecs_[i].size(); ++j) {
+        groups[FindSet(&groups, top_id_vecs_[i][j])] =
+            FindSet(&groups, bottom_id_vecs_[i][0]);
+      }
+    }
+  }
+  // A group stays in full precision if a layer or the caller of the net uses
+  // one of its blobs so.
+  vector<bool> half(blobs_.size(), true);
+  for (int i = 0; i < blobs_.size(); ++i) {
+    if (blobs_[i]->has_diff()) {
+      half[FindSet(&groups, i)] = false;
+    }
+  }
+  for (int i = 0; i < net_input_blob_indices_.size(); ++i) {
+    half[FindSet(&groups, net_input_blob_indices_[i])] = false;
+  }
+  for (int i = 0; i < net_output_blob_indices_.size(); ++i) {
+    half[FindSet(&groups, net_output_blob_indices_[i])] = false;
+  }
+  for (int i = 0; i < layers_.size(); ++i) {
+    if (!layers_[i]->AllowHalfActivations()) {
+      for (int j = 0; j < bottom_id_vecs_[i].size(); ++j) {
+        half[FindSet(&groups, bottom_id_vecs_[i][j])] = false;
+      }
+      for (int j = 0; j < top_id_vecs_[i].size(); ++j) {
+        half[FindSet(&groups, top_id_vecs_[i][j])] = false;
+      }
+    }
+  }
+  size_t released = 0;
+  for (int i = 0; i < blobs_.size(); ++i) {
+    const int group = FindSet(&groups, i);
+    if (half[group]) {
+      // The blobs of a group hold the same data once shared.
+      const size_t bytes = blobs_[i]->AllocateAsHalf();
+      released += group == i ? bytes : 0;
+    }
+  }
+  for (int i = 0; i < layers_.size(); ++i) {
+    if (layers_[i]->layer_param().type() == "Split" &&
+        half[FindSet(&groups, bottom_id_vecs_[i][0])]) {
+      for (int j = 0; j < top_vecs_[i].size(); ++j) {
+        top_vecs_[i][j]->ShareData(*bottom_vecs_[i][0]);
+      }
+    }
+  }
+  LOG_IF(INFO, Caffe::root_solver()) << "Stored the activations of " << name_
+      << " as half, releasing " << released << " bytes";
+  return released;
+}
+
+// Adds the bytes allocated for the data and the diff of blob, at its
+// capacity, unless counted already.
+template <typename Dtype>
+static void CountBlobBytes(const Blob<Dtype>& blob,
+    set<const void*>* counted, size_t* data_bytes, size_t* diff_bytes) {
+  if (blob.capacity() == 0) {
+    return;
+  }
+  if (counted->insert(blob.data_memory()).second) {
+    *data_bytes += CaffeHostBytes(blob.data_memory()->size());
+  }
+  if (blob.has_diff() && counted->insert(blob.diff_memory()).second) {
+    *diff_bytes += CaffeHostBytes(blob.diff_memory()->size());
+  }
+}
+
+template <typename Dtype>
+vector<typename Net<Dtype>::LayerMemory> Net<Dtype>::MemoryFootprint() const {
+  set<const void*> counted;
+  vector<LayerMemory> footprint(layers_.size());
+  for (int i = 0; i < layers_.size(); ++i) {
+    LayerMemory& memory = footprint[i];
+    memory.activation_bytes = 0;
+    memory.param_bytes = 0;
+    memory.diff_bytes = 0;
+    for (int j = 0; j < top_vecs_[i].size(); ++j) {
+      CountBlobBytes(*top_vecs_[i][j], &counted, &memory.activation_bytes,
+          &memory.diff_bytes);
+    }
+    for (int j = 0; j < layers_[i]->blobs().size(); ++j) {
+      CountBlobBytes(*layers_[i]->blobs()[j], &counted, &memory.param_bytes,
+          &memory.diff_bytes);
+    }
+    memory.workspace_bytes = layers_[i]->WorkspaceBytes();
+  }
+  return footprint;
+}
+
+template <typename Dtype>
+void Net<Dtype>::CheckMemoryBudget(uint64_t budget) const {
+  const vector<LayerMemory> footprint = MemoryFootprint();
+  uint64_t total = 0;
+  int largest = -1;
+  uint64_t largest_bytes = 0;
+  for (int i = 0; i < footprint.size(); ++i) {
+    const uint64_t bytes = footprint[i].activation_bytes +
+        footprint[i].param_bytes + footprint[i].diff_bytes +
+        footprint[i].workspace_bytes;
+    total += bytes;
+    if (bytes > largest_bytes) {
+      largest = i;
+      largest_bytes = bytes;
+    }
+  }
+  CHECK_LE(total, budget) << "Net " << name_ << " needs " << total
+      << " bytes of memory, over its budget of " << budget
+      << " bytes; its largest layer, " << layer_names_[largest] << ", needs "
+      << largest_bytes;
+  LOG_IF(INFO, Caffe::root_solver()) << "Net " << name_ << " needs " << total
+      << " bytes of memory, within its budget of " << budget;
+}
+
 template <typename Dtype>
 Dtype Net<Dtype>::ForwardFromTo(int start, int end) {
   CHECK_GE(start, 0);
   CHECK_LT(end, layers_.size());
+  NumaNodeScope numa_scope(numa_node_);
+  const bool concurrently = forward_threads_ > 1 &&
+      Caffe::mode() == Caffe::CPU && !debug_info_ &&
+      before_forward_.empty() && after_forward_.empty();
+  if (concurrently && !layer_dependencies_.empty()) {
+    return ForwardConcurrently(start, end);
+  }
   Dtype loss = 0;
   for (int i = start; i <= end; ++i) {
+    for (int c = 0; c < before_forward_.size(); ++c) {
+      before_forward_[c]->run(i);
+    }
     // LOG(ERROR) << "Forwarding " << layer_names_[i];
+    const int64_t start = profiling_ ? profiler_->Now() : 0;
     Dtype layer_loss = layers_[i]->Forward(bottom_vecs_[i], top_vecs_[i]);
+    if (profiling_) { profiler_->Record(i, Profiler::FORWARD, start); }
     loss += layer_loss;
     if (debug_info_) { ForwardDebugInfo(i); }
+    for (int c = 0; c < after_forward_.size(); ++c) {
+      after_forward_[c]->run(i);
+    }
+  }
+  // Layers such as Split share the data of their tops in Forward, so which
+  // blobs share data is only known after a whole pass.
+  if (concurrently && start == 0 && end == layers_.size() - 1) {
+    InitLayerDependencies();
   }
   return loss;
 }
 
+template <typename Dtype>
+Dtype Net<Dtype>::ForwardConcurrently(int start, int end) {
+  if (!forward_scheduler_) {
+    forward_scheduler_.reset(new TaskScheduler(forward_threads_));
+  }
+  // Layers before start count as run.
+  const int num_layers = end - start + 1;
+  vector<vector<int> > dependents(num_layers);
+  vector<int> dependencies(num_layers, 0);
+  for (int i = 0; i < num_layers; ++i) {
+    const vector<int>& layer_dependencies = layer_dependencies_[start + i];
+    for (int j = 0; j < layer_dependencies.size(); ++j) {
+      if (layer_dependencies[j] >= start) {
+        dependents[layer_dependencies[j] - start].push_back(i);
+        ++dependencies[i];
+      }
+    }
+  }
+  vector<Dtype> losses(num_layers);
+  forward_scheduler_->Run(dependents, dependencies,
+      boost::bind(&Net<Dtype>::ForwardLayer, this, start, &losses[0], _1));
+  // Sum the losses in order, for the same result as the sequential order.
+  Dtype loss = 0;
+  for (int i = 0; i < num_layers; ++i) {
+    loss += losses[i];
+  }
+  return loss;
+}
+
+template <typename Dtype>
+void Net<Dtype>::ForwardLayer(int start, Dtype* losses, int i) {
+  const int layer_id = start + i;
+  const int64_t begin = profiling_ ? profiler_->Now() : 0;
+  losses[i] = layers_[layer_id]->Forward(bottom_vecs_[layer_id],
+      top_vecs_[layer_id]);
+  if (profiling_) { profiler_->Record(layer_id, Profiler::FORWARD, begin); }
+}
+
 template <typename Dtype>
 Dtype Net<Dtype>::ForwardFrom(int start) {
   return ForwardFromTo(start, layers_.size() - 1);
@@ -588,14 +1015,24 @@ const vector<Blob<Dtype>*>& Net<Dtype>::Forward(
 
 template <typename Dtype>
 void Net<Dtype>::BackwardFromTo(int start, int end) {
+  CHECK(!inference_only_) << "Cannot run an inference-only net backward";
   CHECK_GE(end, 0);
   CHECK_LT(start, layers_.size());
+  NumaNodeScope numa_scope(numa_node_);
   for (int i = start; i >= end; --i) {
+    for (int c = 0; c < before_backward_.size(); ++c) {
+      before_backward_[c]->run(i);
+    }
     if (layer_need_backward_[i]) {
+      const int64_t start = profiling_ ? profiler_->Now() : 0;
       layers_[i]->Backward(
           top_vecs_[i], bottom_need_backward_[i], bottom_vecs_[i]);
+      if (profiling_) { profiler_->Record(i, Profiler::BACKWARD, start); }
       if (debug_info_) { BackwardDebugInfo(i); }
     }
+    for (int c = 0; c < after_backward_.size(); ++c) {
+      after_backward_[c]->run(i);
+    }
   }
 }
 
@@ -739,13 +1176,63 @@ void Net<Dtype>::Backward() {
   }
 }
 
+template <typename Dtype>
+void Net<Dtype>::EnableProfiling(bool trace) {
+  if (!profiler_) {
+    profiler_.reset(new Profiler(layer_names_));
+  }
+  profiler_->set_trace(trace);
+  profiling_ = true;
+}
+
 template <typename Dtype>
 void Net<Dtype>::Reshape() {
+  NumaNodeScope numa_scope(numa_node_);
   for (int i = 0; i < layers_.size(); ++i) {
-    layers_[i]->Reshape(bottom_vecs_[i], top_vecs_[i]);
+    if (reshape_on_change_) {
+      layers_[i]->ReshapeIfChanged(bottom_vecs_[i], top_vecs_[i]);
+    } else {
+      layers_[i]->Reshape(bottom_vecs_[i], top_vecs_[i]);
+    }
   }
 }
 
+template <typename Dtype>
+void Net<Dtype>::set_reshape_on_change(bool reshape_on_change) {
+  reshape_on_change_ = reshape_on_change;
+  for (int i = 0; i < layers_.size(); ++i) {
+    layers_[i]->set_reshape_on_change(reshape_on_change);
+  }
+}
+
+template <typename Dtype>
+void Net<Dtype>::set_inference_shapes(int shapes) {
+  CHECK_GE(shapes, 0);
+  inference_shapes_ = shapes;
+  inference_clones_.clear();
+}
+
+template <typename Dtype>
+size_t Net<Dtype>::ShrinkToFit() {
+  size_t released = 0;
+  for (int i = 0; i < blobs_.size(); ++i) {
+    released += blobs_[i]->ShrinkToFit();
+  }
+  for (int i = 0; i < params_.size(); ++i) {
+    released += params_[i]->ShrinkToFit();
+  }
+  for (int i = 0; i < layers_.size(); ++i) {
+    released += layers_[i]->ShrinkToFit();
+  }
+  // Layers sharing the memory of their bottoms reshape again.
+  for (int i = 0; i < layers_.size(); ++i) {
+    layers_[i]->set_reshape_on_change(reshape_on_change_);
+  }
+  LOG_IF(INFO, Caffe::root_solver()) << "Released " << released
+      << " bytes of " << name_;
+  return released;
+}
+
 template <typename Dtype>
 void Net<Dtype>::CopyTrainedLayersFrom(const NetParameter& param) {
   int num_source_layers = param.layer_size();
@@ -789,6 +1276,8 @@ void Net<Dtype>::CopyTrainedLayersFrom(const string trained_filename) {
   if (trained_filename.size() >= 3 &&
       trained_filename.compare(trained_filename.size() - 3, 3, ".h5") == 0) {
     CopyTrainedLayersFromHDF5(trained_filename);
+  } else if (IsRawModelFile(trained_filename)) {
+    CopyTrainedLayersFromRaw(trained_filename);
   } else {
     CopyTrainedLayersFromBinaryProto(trained_filename);
   }
@@ -802,8 +1291,75 @@ void Net<Dtype>::CopyTrainedLayersFromBinaryProto(
   CopyTrainedLayersFrom(param);
 }
 
+template <typename Dtype>
+void Net<Dtype>::CopyTrainedLayersFromRaw(const string trained_filename,
+    bool map) {
+  shared_ptr<RawModel> model(new RawModel(trained_filename));
+  LoadRawModel(model, map && model->element_size() == sizeof(Dtype));
+}
+
+template <typename Dtype>
+void Net<Dtype>::ShareTrainedLayersFromRaw(const string trained_filename) {
+  CHECK_EQ(phase_, TEST) << "Only nets in the TEST phase, which do not write "
+      << "their weights, can share them read-only";
+  const bool kReadOnly = true;
+  shared_ptr<RawModel> model(new RawModel(trained_filename, kReadOnly));
+  CHECK_EQ(model->element_size(), sizeof(Dtype))
+      << trained_filename << " holds elements of another type than the net";
+  const bool kMap = true;
+  LoadRawModel(model, kMap);
+}
+
+template <typename Dtype>
+void Net<Dtype>::LoadRawModel(shared_ptr<RawModel> model, bool map) {
+  const NetParameter& index = model->index();
+  for (int i = 0; i < index.layer_size(); ++i) {
+    const LayerParameter& source_layer = index.layer(i);
+    const string& source_layer_name = source_layer.name();
+    if (!layer_names_index_.count(source_layer_name)) {
+      LOG(INFO) << "Ignoring source layer " << source_layer_name;
+      continue;
+    }
+    int target_layer_id = layer_names_index_[source_layer_name];
+    DLOG(INFO) << "Copying source layer " << source_layer_name;
+    vector<shared_ptr<Blob<Dtype> > >& target_blobs =
+        layers_[target_layer_id]->blobs();
+    CHECK_EQ(target_blobs.size(), source_layer.blobs_size())
+        << "Incompatible number of blobs for layer " << source_layer_name;
+    for (int j = 0; j < target_blobs.size(); ++j) {
+      Blob<Dtype>* target_blob = target_blobs[j].get();
+      if (!target_blob->ShapeEquals(source_layer.blobs(j))) {
+        Blob<Dtype> source_blob;
+        source_blob.Reshape(source_layer.blobs(j).shape());
+        LOG(FATAL) << "Cannot copy param " << j << " weights from layer '"
+            << source_layer_name << "'; shape mismatch.  Source param shape is "
+            << source_blob.shape_string() << "; target param shape is "
+            << target_blob->shape_string() << ".";
+      }
+      void* source_data = model->blob_data(i, j);
+      const int64_t count = target_blob->count();
+      if (map) {
+        target_blob->set_cpu_data(static_cast<Dtype*>(source_data));
+      } else if (model->element_size() == RawModel::kHalfSize) {
+        caffe_cpu_from_half(count, static_cast<const uint16_t*>(source_data),
+            target_blob->mutable_cpu_data());
+      } else if (model->element_size() == sizeof(float)) {
+        const float* source = static_cast<const float*>(source_data);
+        std::copy(source, source + count, target_blob->mutable_cpu_data());
+      } else {
+        const double* source = static_cast<const double*>(source_data);
+        std::copy(source, source + count, target_blob->mutable_cpu_data());
+      }
+    }
+  }
+  if (map) {
+    raw_models_.push_back(model);
+  }
+}
+
 template <typename Dtype>
 void Net<Dtype>::CopyTrainedLayersFromHDF5(const string trained_filename) {
+  HDF5Lock lock;
   hid_t file_hid = H5Fopen(trained_filename.c_str(), H5F_ACC_RDONLY,
                            H5P_DEFAULT);
   CHECK_GE(file_hid, 0) << "Couldn't open " << trained_filename;
@@ -866,6 +1422,7 @@ void Net<Dtype>::ToProto(NetParameter* param, bool write_diff) const {
 
 template <typename Dtype>
 void Net<Dtype>::ToHDF5(const string& filename, bool write_diff) const {
+  HDF5Lock lock;
   hid_t file_hid = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT,
       H5P_DEFAULT);
   CHECK_GE(file_hid, 0)
@@ -923,6 +1480,7 @@ void Net<Dtype>::ToHDF5(const string& filename, bool write_diff) const {
 
 template <typename Dtype>
 void Net<Dtype>::Update() {
+  CHECK(!inference_only_) << "Cannot update an inference-only net";
   for (int i = 0; i < learnable_params_.size(); ++i) {
     learnable_params_[i]->Update();
   }
@@ -930,6 +1488,7 @@ void Net<Dtype>::Update() {
 
 template <typename Dtype>
 void Net<Dtype>::ClearParamDiffs() {
+  CHECK(!inference_only_) << "An inference-only net has no param diffs";
   for (int i = 0; i < learnable_params_.size(); ++i) {
     Blob<Dtype>* blob = learnable_params_[i];
     switch (Caffe::mode()) {
@@ -4,6 +4,7 @@
 #include <glog/logging.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -114,6 +115,43 @@ void GPUParams<Dtype>::configure(Solver<Dtype>* solver) const {
   apply_buffers(net, diff_, size_, replace_gpu_diff);
 }
 
+template<typename Dtype>
+CPUParams<Dtype>::CPUParams(shared_ptr<Solver<Dtype> > root_solver,
+                            const CPUParams<Dtype>* parent)
+    : Params<Dtype>(root_solver),
+      owns_data_(parent == NULL) {
+  bool use_cuda;
+  if (parent) {
+    data_ = parent->data_;
+  } else {
+    CaffeMallocHost(reinterpret_cast<void**>(&data_), size_ * sizeof(Dtype),
+        &use_cuda);
+    // Copy blob values
+    const vector<Blob<Dtype>*>& net =
+        root_solver->net()->learnable_params();
+    apply_buffers(net, data_, size_, copy);
+  }
+  CaffeMallocHost(reinterpret_cast<void**>(&diff_), size_ * sizeof(Dtype),
+      &use_cuda);
+  caffe_set(size_, Dtype(0), diff_);
+}
+
+template<typename Dtype>
+CPUParams<Dtype>::~CPUParams() {
+  if (owns_data_) {
+    CaffeFreeHost(data_, size_ * sizeof(Dtype), false);
+  }
+  CaffeFreeHost(diff_, size_ * sizeof(Dtype), false);
+}
+
+template<typename Dtype>
+void CPUParams<Dtype>::configure(Solver<Dtype>* solver) const {
+  const vector<Blob<Dtype>*>& net =
+      solver->net()->learnable_params();
+  apply_buffers(net, data_, size_, replace_cpu);
+  apply_buffers(net, diff_, size_, replace_cpu_diff);
+}
+
 void DevicePair::compute(const vector<int> devices, vector<DevicePair>* pairs) {
 #ifndef CPU_ONLY
   vector<int> remaining(devices);
@@ -436,8 +474,213 @@ void P2PSync<Dtype>::Run(const vector<int>& gpus) {
   }
 }
 
+//
+
+template<typename Dtype>
+CPUSync<Dtype>::CPUSync(shared_ptr<Solver<Dtype> > root_solver,
+                        CPUSync<Dtype>* root, int rank,
+                        const SolverParameter& param)
+    : CPUParams<Dtype>(root_solver, root),
+      root_(root ? root : this),
+      rank_(rank),
+      syncs_(),
+      barrier_(),
+      initial_iter_(root_solver->iter()),
+      solver_() {
+  if (root == NULL) {
+    solver_ = root_solver;
+  } else {
+    Caffe::set_root_solver(false);
+    solver_.reset(new WorkerSolver<Dtype>(param, root_solver.get()));
+    Caffe::set_root_solver(true);
+  }
+  this->configure(solver_.get());
+  solver_->add_callback(this);
+}
+
+template<typename Dtype>
+CPUSync<Dtype>::~CPUSync() {
+}
+
+template<typename Dtype>
+void CPUSync<Dtype>::InternalThreadEntry() {
+  CHECK(Caffe::root_solver());
+  Caffe::set_root_solver(false);
+  // See if there is a defined seed and reset random state if so
+  if (solver_->param().random_seed() >= 0) {
+    // Modulate the seed by rank so that solvers do not draw the same
+    // numbers, as with P2PSync
+    Caffe::set_random_seed(solver_->param().random_seed() + rank_);
+  }
+  solver_->Step(solver_->param().max_iter() - initial_iter_);
+}
+
+template<typename Dtype>
+void CPUSync<Dtype>::on_start() {
+  // Wait for the root solver to have updated the shared parameters
+  root_->barrier_->wait();
+}
+
+template<typename Dtype>
+void CPUSync<Dtype>::on_gradients_ready() {
+  // Wait for the gradients of all solvers
+  root_->barrier_->wait();
+
+  // Sum this thread's slice of the gradients into the root buffer
+  const vector<CPUSync<Dtype>*>& syncs = root_->syncs_;
+  const size_t slice = (size_ + syncs.size() - 1) / syncs.size();
+  const size_t begin = std::min(size_, rank_ * slice);
+  const int count = std::min(size_, begin + slice) - begin;
+  Dtype* dst = root_->diff_ + begin;
+  for (int i = 1; i < syncs.size(); ++i) {
+    caffe_axpy(count, Dtype(1), syncs[i]->diff_ + begin, dst);
+  }
+  // Loss functions divide gradients by the batch size, so to compensate
+  // for split batch, the gradients are divided by number of solvers.
+  caffe_scal(count, Dtype(1.0 / syncs.size()), dst);
+
+  // Wait for the sum to be complete before the root solver updates
+  root_->barrier_->wait();
+}
+
+template<typename Dtype>
+void CPUSync<Dtype>::Run(int threads) {
+  CHECK(root_ == this) << "Run must be called on the root sync.";
+  vector<shared_ptr<CPUSync<Dtype> > > syncs(threads);
+  syncs_.push_back(this);
+  for (int i = 1; i < threads; ++i) {
+    syncs[i].reset(new CPUSync<Dtype>(solver_, this, i, solver_->param()));
+    syncs_.push_back(syncs[i].get());
+  }
+  barrier_.reset(new boost::barrier(threads));
+
+  LOG(INFO)<< "Starting Optimization on " << threads << " threads";
+
+  for (int i = 1; i < syncs.size(); ++i) {
+    syncs[i]->StartInternalThread();
+  }
+
+  // Run root solver on current thread
+  solver_->Solve();
+
+  for (int i = 1; i < syncs.size(); ++i) {
+    syncs[i]->StopInternalThread();
+  }
+}
+
+//
+
+template<typename Dtype>
+RingSync<Dtype>::RingSync(shared_ptr<Solver<Dtype> > solver,
+                          const vector<string>& addresses, int rank)
+    : CPUParams<Dtype>(solver, NULL),
+      solver_(solver),
+      ring_(addresses, rank),
+      ready_offsets_(),
+      queued_(size_),
+      ready_(),
+      reduced_() {
+  this->configure(solver_.get());
+  // Start from the same parameters everywhere
+  ring_.Broadcast(data_, size_);
+  solver_->add_callback(this);
+
+  // Gradients accumulate over iter_size passes, they can only be reduced
+  // after the last one.
+  if (solver_->param().iter_size() > 1) {
+    return;
+  }
+  // Learnable params are laid out in the order of their owners, each owned
+  // by the lowest layer using it, so after backward of layer i the buffers
+  // are complete from the first param owned by a layer >= i.
+  const Net<Dtype>& net = *solver_->net();
+  const vector<Blob<Dtype>*>& learnable = net.learnable_params();
+  vector<size_t> param_offsets(learnable.size() + 1, 0);
+  for (int i = 0; i < learnable.size(); ++i) {
+    param_offsets[i + 1] = param_offsets[i] + learnable[i]->count();
+  }
+  ready_offsets_.assign(net.layers().size(), size_);
+  for (int i = 0; i < net.params().size(); ++i) {
+    if (net.param_owners()[i] < 0) {
+      const int layer = net.param_layer_indices()[i].first;
+      ready_offsets_[layer] = std::min(ready_offsets_[layer],
+          param_offsets[net.learnable_param_ids()[i]]);
+    }
+  }
+  for (int i = static_cast<int>(ready_offsets_.size()) - 2; i >= 0; --i) {
+    ready_offsets_[i] = std::min(ready_offsets_[i], ready_offsets_[i + 1]);
+  }
+  solver_->net()->add_after_backward(this);
+  StartInternalThread();
+}
+
+template<typename Dtype>
+RingSync<Dtype>::~RingSync() {
+  StopInternalThread();
+}
+
+template<typename Dtype>
+void RingSync<Dtype>::InternalThreadEntry() {
+  try {
+    // Reduce the ranges in the order they become ready, the same on all
+    // processes as it only depends on the net
+    size_t end = size_;
+    while (!must_stop()) {
+      const size_t begin = ready_.pop();
+      ring_.AllReduce(diff_ + begin, end - begin);
+      end = begin;
+      if (end == 0) {
+        reduced_.push(0);
+        end = size_;
+      }
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
+template<typename Dtype>
+void RingSync<Dtype>::run(int layer) {
+  const size_t offset = ready_offsets_[layer];
+  if (offset < queued_) {
+    ready_.push(offset);
+    queued_ = offset;
+  }
+}
+
+template<typename Dtype>
+void RingSync<Dtype>::on_gradients_ready() {
+  // Without learnable params no offset is ever queued, nothing to reduce.
+  if (size_ == 0) {
+    return;
+  }
+  if (is_started()) {
+    // Reduce what remains, if anything, and wait for the reducing thread
+    if (queued_ > 0) {
+      ready_.push(0);
+    }
+    reduced_.pop();
+    queued_ = size_;
+  } else {
+    ring_.AllReduce(diff_, size_);
+  }
+  // Loss functions divide gradients by the batch size, so to compensate
+  // for split batch, the gradients are divided by number of processes.
+  caffe_scal<Dtype>(size_, Dtype(1.0 / ring_.size()), diff_);
+}
+
+template<typename Dtype>
+void RingSync<Dtype>::Run() {
+  LOG(INFO)<< "Starting Optimization as rank " << ring_.rank() << " of "
+      << ring_.size();
+  solver_->Solve();
+}
+
 INSTANTIATE_CLASS(Params);
 INSTANTIATE_CLASS(GPUParams);
+INSTANTIATE_CLASS(CPUParams);
 INSTANTIATE_CLASS(P2PSync);
+INSTANTIATE_CLASS(CPUSync);
+INSTANTIATE_CLASS(RingSync);
 
 }  // namespace caffe
@@ -3,6 +3,8 @@
 #include <string>
 #include <vector>
 
+#include "boost/bind.hpp"
+#include "boost/thread.hpp"
 #include "caffe/solver.hpp"
 #include "caffe/util/format.hpp"
 #include "caffe/util/hdf5.hpp"
@@ -42,6 +44,11 @@ Solver<Dtype>::Solver(const string& param_file, const Solver* root_solver)
   Init(param);
 }
 
+template <typename Dtype>
+Solver<Dtype>::~Solver() {
+  WaitForSnapshot();
+}
+
 template <typename Dtype>
 void Solver<Dtype>::CheckType(SolverParameter* param) {
   // Harmonize solver class type with configured type to avoid confusion.
@@ -309,6 +316,7 @@ void Solver<Dtype>::Solve(const char* resume_file) {
       && (!param_.snapshot() || iter_ % param_.snapshot() != 0)) {
     Snapshot();
   }
+  WaitForSnapshot();
   if (requested_early_exit_) {
     LOG(INFO) << "Optimization stopped early.";
     return;
@@ -418,9 +426,46 @@ void Solver<Dtype>::Test(const int test_net_id) {
   }
 }
 
+// Writes proto to filename through a temporary file renamed into place, so
+// that a snapshot interrupted while being written leaves no partial file.
+static void WriteProtoAtomically(const Message& proto,
+    const string& filename) {
+  const string temp_filename = filename + ".tmp";
+  WriteProtoToBinaryFile(proto, temp_filename);
+  CHECK_EQ(std::rename(temp_filename.c_str(), filename.c_str()), 0)
+      << "Cannot rename " << temp_filename << " to " << filename;
+}
+
+// Runs on the snapshot thread: the model is written before the solver state
+// that refers to it.
+static void WriteSnapshot(shared_ptr<NetParameter> net_param,
+    shared_ptr<SolverState> state, const string& model_filename,
+    const string& state_filename) {
+  WriteProtoAtomically(*net_param, model_filename);
+  WriteProtoAtomically(*state, state_filename);
+  LOG(INFO) << "Snapshot " << model_filename << " written";
+}
+
 template <typename Dtype>
 void Solver<Dtype>::Snapshot() {
   CHECK(Caffe::root_solver());
+  shared_ptr<SolverState> state(new SolverState());
+  if (param_.snapshot_async() && param_.snapshot_format() ==
+      caffe::SolverParameter_SnapshotFormat_BINARYPROTO &&
+      SolverStateToProto(state.get())) {
+    // Only one snapshot is written at a time; the next waits for it.
+    WaitForSnapshot();
+    const string model_filename = SnapshotFilename(".caffemodel");
+    const string state_filename = SnapshotFilename(".solverstate");
+    LOG(INFO) << "Snapshotting asynchronously to binary proto files "
+        << model_filename << " and " << state_filename;
+    shared_ptr<NetParameter> net_param(new NetParameter());
+    net_->ToProto(net_param.get(), param_.snapshot_diff());
+    state->set_learned_net(model_filename);
+    snapshot_thread_.reset(new boost::thread(boost::bind(&WriteSnapshot,
+        net_param, state, model_filename, state_filename)));
+    return;
+  }
   string model_filename;
   switch (param_.snapshot_format()) {
   case caffe::SolverParameter_SnapshotFormat_BINARYPROTO:
@@ -436,6 +481,14 @@ void Solver<Dtype>::Snapshot() {
   SnapshotSolverState(model_filename);
 }
 
+template <typename Dtype>
+void Solver<Dtype>::WaitForSnapshot() {
+  if (snapshot_thread_) {
+    snapshot_thread_->join();
+    snapshot_thread_.reset();
+  }
+}
+
 template <typename Dtype>
 void Solver<Dtype>::CheckSnapshotWritePermissions() {
   if (Caffe::root_solver() && param_.snapshot()) {
@@ -481,6 +534,7 @@ string Solver<Dtype>::SnapshotToHDF5() {
 template <typename Dtype>
 void Solver<Dtype>::Restore(const char* state_file) {
   CHECK(Caffe::root_solver());
+  WaitForSnapshot();
   string state_filename(state_file);
   if (state_filename.size() >= 3 &&
       state_filename.compare(state_filename.size() - 3, 3, ".h5") == 0) {
@@ -1,6 +1,8 @@
+#include <typeinfo>
 #include <vector>
 
 #include "caffe/sgd_solvers.hpp"
+#include "caffe/util/parallel_for.hpp"
 
 namespace caffe {
 
@@ -88,6 +90,57 @@ void AdamSolver<Dtype>::ComputeUpdateValue(int param_id, Dtype rate) {
   }
 }
 
+template <typename Dtype>
+bool AdamSolver<Dtype>::has_fused_update() const {
+  return typeid(*this) == typeid(AdamSolver<Dtype>);
+}
+
+template <typename Dtype>
+struct AdamUpdateCPU {
+  RegularizedGradient<Dtype> gradient;
+  Dtype* data;
+  Dtype* diff;
+  Dtype* m;
+  Dtype* v;
+  Dtype beta1;
+  Dtype beta2;
+  Dtype eps_hat;
+  Dtype corrected_local_rate;
+
+  void operator()(int begin, int end) const {
+    for (int i = begin; i < end; ++i) {
+      const Dtype g = gradient(diff[i], data[i]);
+      m[i] = (Dtype(1) - beta1) * g + beta1 * m[i];
+      v[i] = (Dtype(1) - beta2) * g * g + beta2 * v[i];
+      diff[i] = corrected_local_rate * m[i] / (std::sqrt(v[i]) + eps_hat);
+      data[i] -= diff[i];
+    }
+  }
+};
+
+template <typename Dtype>
+void AdamSolver<Dtype>::FusedUpdate(int param_id, Dtype rate) {
+  const vector<Blob<Dtype>*>& net_params = this->net_->learnable_params();
+  Blob<Dtype>* param = net_params[param_id];
+  const Dtype beta1 = this->param_.momentum();
+  const Dtype beta2 = this->param_.momentum2();
+  const int t = this->iter_ + 1;
+  const Dtype correction = std::sqrt(Dtype(1) - pow(beta2, t)) /
+      (Dtype(1.) - pow(beta1, t));
+  AdamUpdateCPU<Dtype> update;
+  update.gradient = this->GetRegularizedGradient(param_id);
+  update.data = param->mutable_cpu_data();
+  update.diff = param->mutable_cpu_diff();
+  update.m = this->history_[param_id]->mutable_cpu_data();
+  update.v = this->history_[param_id + net_params.size()]->mutable_cpu_data();
+  update.beta1 = beta1;
+  update.beta2 = beta2;
+  update.eps_hat = this->param_.delta();
+  update.corrected_local_rate =
+      rate * this->net_->params_lr()[param_id] * correction;
+  caffe_cpu_parallel_for(param->count(), kFusedUpdateGrain, update);
+}
+
 INSTANTIATE_CLASS(AdamSolver);
 REGISTER_SOLVER_CLASS(Adam);
 
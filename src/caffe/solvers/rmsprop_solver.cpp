@@ -1,6 +1,8 @@
+#include <typeinfo>
 #include <vector>
 
 #include "caffe/sgd_solvers.hpp"
+#include "caffe/util/parallel_for.hpp"
 
 namespace caffe {
 
@@ -64,6 +66,45 @@ void RMSPropSolver<Dtype>::ComputeUpdateValue(int param_id, Dtype rate) {
   }
 }
 
+template <typename Dtype>
+bool RMSPropSolver<Dtype>::has_fused_update() const {
+  return typeid(*this) == typeid(RMSPropSolver<Dtype>);
+}
+
+template <typename Dtype>
+struct RMSPropUpdateCPU {
+  RegularizedGradient<Dtype> gradient;
+  Dtype* data;
+  Dtype* diff;
+  Dtype* history;
+  Dtype rms_decay;
+  Dtype delta;
+  Dtype local_rate;
+
+  void operator()(int begin, int end) const {
+    for (int i = begin; i < end; ++i) {
+      const Dtype g = gradient(diff[i], data[i]);
+      history[i] = (Dtype(1) - rms_decay) * g * g + rms_decay * history[i];
+      diff[i] = local_rate * g / (std::sqrt(history[i]) + delta);
+      data[i] -= diff[i];
+    }
+  }
+};
+
+template <typename Dtype>
+void RMSPropSolver<Dtype>::FusedUpdate(int param_id, Dtype rate) {
+  Blob<Dtype>* param = this->net_->learnable_params()[param_id];
+  RMSPropUpdateCPU<Dtype> update;
+  update.gradient = this->GetRegularizedGradient(param_id);
+  update.data = param->mutable_cpu_data();
+  update.diff = param->mutable_cpu_diff();
+  update.history = this->history_[param_id]->mutable_cpu_data();
+  update.rms_decay = this->param_.rms_decay();
+  update.delta = this->param_.delta();
+  update.local_rate = rate * this->net_->params_lr()[param_id];
+  caffe_cpu_parallel_for(param->count(), kFusedUpdateGrain, update);
+}
+
 INSTANTIATE_CLASS(RMSPropSolver);
 REGISTER_SOLVER_CLASS(RMSProp);
 
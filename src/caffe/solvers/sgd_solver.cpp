@@ -1,9 +1,11 @@
 #include <string>
+#include <typeinfo>
 #include <vector>
 
 #include "caffe/sgd_solvers.hpp"
 #include "caffe/util/hdf5.hpp"
 #include "caffe/util/io.hpp"
+#include "caffe/util/parallel_for.hpp"
 #include "caffe/util/upgrade_proto.hpp"
 
 namespace caffe {
@@ -106,6 +108,13 @@ void SGDSolver<Dtype>::ApplyUpdate() {
     LOG(INFO) << "Iteration " << this->iter_ << ", lr = " << rate;
   }
   ClipGradients();
+  if (Caffe::mode() == Caffe::CPU && has_fused_update()) {
+    for (int param_id = 0; param_id < this->net_->learnable_params().size();
+         ++param_id) {
+      FusedUpdate(param_id, rate);
+    }
+    return;
+  }
   for (int param_id = 0; param_id < this->net_->learnable_params().size();
        ++param_id) {
     Normalize(param_id);
@@ -115,6 +124,58 @@ void SGDSolver<Dtype>::ApplyUpdate() {
   this->net_->Update();
 }
 
+template <typename Dtype>
+bool SGDSolver<Dtype>::has_fused_update() const {
+  return typeid(*this) == typeid(SGDSolver<Dtype>);
+}
+
+template <typename Dtype>
+RegularizedGradient<Dtype> SGDSolver<Dtype>::GetRegularizedGradient(
+    int param_id) {
+  const string& regularization_type = this->param_.regularization_type();
+  RegularizedGradient<Dtype> gradient;
+  gradient.normalization = Dtype(1.) / this->param_.iter_size();
+  gradient.decay = this->param_.weight_decay() *
+      this->net_->params_weight_decay()[param_id];
+  gradient.l1 = (regularization_type == "L1");
+  if (gradient.decay && !gradient.l1 && regularization_type != "L2") {
+    LOG(FATAL) << "Unknown regularization type: " << regularization_type;
+  }
+  return gradient;
+}
+
+template <typename Dtype>
+struct SGDUpdateCPU {
+  RegularizedGradient<Dtype> gradient;
+  Dtype* data;
+  Dtype* diff;
+  Dtype* history;
+  Dtype momentum;
+  Dtype local_rate;
+
+  void operator()(int begin, int end) const {
+    for (int i = begin; i < end; ++i) {
+      const Dtype g = gradient(diff[i], data[i]);
+      history[i] = momentum * history[i] + local_rate * g;
+      diff[i] = history[i];
+      data[i] -= history[i];
+    }
+  }
+};
+
+template <typename Dtype>
+void SGDSolver<Dtype>::FusedUpdate(int param_id, Dtype rate) {
+  Blob<Dtype>* param = this->net_->learnable_params()[param_id];
+  SGDUpdateCPU<Dtype> update;
+  update.gradient = GetRegularizedGradient(param_id);
+  update.data = param->mutable_cpu_data();
+  update.diff = param->mutable_cpu_diff();
+  update.history = history_[param_id]->mutable_cpu_data();
+  update.momentum = this->param_.momentum();
+  update.local_rate = rate * this->net_->params_lr()[param_id];
+  caffe_cpu_parallel_for(param->count(), kFusedUpdateGrain, update);
+}
+
 template <typename Dtype>
 void SGDSolver<Dtype>::Normalize(int param_id) {
   if (this->param_.iter_size() == 1) { return; }
@@ -257,18 +318,24 @@ void SGDSolver<Dtype>::SnapshotSolverState(const string& model_filename) {
 }
 
 template <typename Dtype>
-void SGDSolver<Dtype>::SnapshotSolverStateToBinaryProto(
-    const string& model_filename) {
-  SolverState state;
-  state.set_iter(this->iter_);
-  state.set_learned_net(model_filename);
-  state.set_current_step(this->current_step_);
-  state.clear_history();
+bool SGDSolver<Dtype>::SolverStateToProto(SolverState* state) {
+  state->set_iter(this->iter_);
+  state->set_current_step(this->current_step_);
+  state->clear_history();
   for (int i = 0; i < history_.size(); ++i) {
     // Add history
-    BlobProto* history_blob = state.add_history();
+    BlobProto* history_blob = state->add_history();
     history_[i]->ToProto(history_blob);
   }
+  return true;
+}
+
+template <typename Dtype>
+void SGDSolver<Dtype>::SnapshotSolverStateToBinaryProto(
+    const string& model_filename) {
+  SolverState state;
+  SolverStateToProto(&state);
+  state.set_learned_net(model_filename);
   string snapshot_filename = Solver<Dtype>::SnapshotFilename(".solverstate");
   LOG(INFO)
     << "Snapshotting solver state to binary proto file " << snapshot_filename;
@@ -281,6 +348,7 @@ void SGDSolver<Dtype>::SnapshotSolverStateToHDF5(
   string snapshot_filename =
       Solver<Dtype>::SnapshotFilename(".solverstate.h5");
   LOG(INFO) << "Snapshotting solver state to HDF5 file " << snapshot_filename;
+  HDF5Lock lock;
   hid_t file_hid = H5Fcreate(snapshot_filename.c_str(), H5F_ACC_TRUNC,
       H5P_DEFAULT, H5P_DEFAULT);
   CHECK_GE(file_hid, 0)
@@ -323,6 +391,7 @@ void SGDSolver<Dtype>::RestoreSolverStateFromBinaryProto(
 
 template <typename Dtype>
 void SGDSolver<Dtype>::RestoreSolverStateFromHDF5(const string& state_file) {
+  HDF5Lock lock;
   hid_t file_hid = H5Fopen(state_file.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
   CHECK_GE(file_hid, 0) << "Couldn't open solver state file " << state_file;
   this->iter_ = hdf5_load_int(file_hid, "iter");
@@ -59,6 +59,88 @@ TYPED_TEST(BlobSimpleTest, TestReshapeZero) {
   EXPECT_EQ(this->blob_->count(), 0);
 }
 
+TYPED_TEST(BlobSimpleTest, TestReshapeBeyondInt) {
+  // Memory is allocated when accessed, so the blob only has a shape.
+  vector<int> shape(3);
+  shape[0] = 4;
+  shape[1] = 1 << 16;
+  shape[2] = 1 << 15;
+  this->blob_->Reshape(shape);
+  const int64_t count = int64_t(1) << 33;
+  EXPECT_EQ(count, this->blob_->count());
+  EXPECT_EQ(count / 4, this->blob_->count(1));
+  EXPECT_EQ(count, this->blob_->capacity());
+  vector<int> indices(3);
+  indices[0] = 3;
+  indices[1] = 5;
+  indices[2] = 7;
+  EXPECT_EQ(3 * (count / 4) + 5 * (1 << 15) + 7,
+      this->blob_->offset(indices));
+  EXPECT_EQ(3 * (count / 4) + 5 * (1 << 15), this->blob_->offset(3, 5));
+}
+
+TYPED_TEST(BlobSimpleTest, TestReshapeGrowth) {
+  vector<int> shape(1, 10);
+  this->blob_->Reshape(shape);
+  EXPECT_EQ(10, this->blob_->capacity());
+  shape[0] = 12;
+  this->blob_->Reshape(shape);
+  EXPECT_EQ(12, this->blob_->count());
+  EXPECT_EQ(15, this->blob_->capacity());
+  // Growing within the capacity does not reallocate.
+  const void* data = this->blob_->cpu_data();
+  shape[0] = 15;
+  this->blob_->Reshape(shape);
+  EXPECT_EQ(data, this->blob_->cpu_data());
+  // The headroom is capped.
+  const BlobGrowthPolicy policy = GetBlobGrowthPolicy();
+  BlobGrowthPolicy capped = policy;
+  capped.max_headroom_bytes = 2 * sizeof(TypeParam);
+  SetBlobGrowthPolicy(capped);
+  shape[0] = 16;
+  this->blob_->Reshape(shape);
+  EXPECT_EQ(18, this->blob_->capacity());
+  SetBlobGrowthPolicy(policy);
+}
+
+TYPED_TEST(BlobSimpleTest, TestShrinkToFit) {
+  vector<int> shape(1, 10);
+  this->blob_->Reshape(shape);
+  TypeParam* data = this->blob_->mutable_cpu_data();
+  for (int i = 0; i < 10; ++i) {
+    data[i] = i;
+  }
+  EXPECT_EQ(0, this->blob_->ShrinkToFit());
+  shape[0] = 4;
+  this->blob_->Reshape(shape);
+  EXPECT_EQ(10, this->blob_->capacity());
+  // The diff was never used, and never allocated.
+  EXPECT_EQ(6 * sizeof(TypeParam), this->blob_->ShrinkToFit());
+  EXPECT_EQ(4, this->blob_->capacity());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(i, this->blob_->cpu_data()[i]);
+  }
+  shape[0] = 10;
+  this->blob_->Reshape(shape);
+  this->blob_->mutable_cpu_data();
+  this->blob_->mutable_cpu_diff();
+  shape[0] = 4;
+  this->blob_->Reshape(shape);
+  EXPECT_EQ(2 * 6 * sizeof(TypeParam), this->blob_->ShrinkToFit());
+}
+
+TYPED_TEST(BlobSimpleTest, TestShrinkToFitShared) {
+  vector<int> shape(1, 10);
+  this->blob_->Reshape(shape);
+  Blob<TypeParam> other(shape);
+  other.ShareData(*this->blob_);
+  shape[0] = 4;
+  this->blob_->Reshape(shape);
+  EXPECT_EQ(0, this->blob_->ShrinkToFit());
+  EXPECT_EQ(10, this->blob_->capacity());
+  EXPECT_EQ(other.cpu_data(), this->blob_->cpu_data());
+}
+
 TYPED_TEST(BlobSimpleTest, TestLegacyBlobProtoShapeEquals) {
   BlobProto blob_proto;
 
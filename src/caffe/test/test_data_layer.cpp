@@ -90,6 +90,9 @@ class DataLayerTest : public MultiDeviceTest<TypeParam> {
     EXPECT_EQ(blob_top_label_->channels(), 1);
     EXPECT_EQ(blob_top_label_->height(), 1);
     EXPECT_EQ(blob_top_label_->width(), 1);
+    // The prefetched batches, of the shapes of the tops.
+    EXPECT_EQ(DataLayer<Dtype>::PREFETCH_COUNT * (blob_top_data_->count() +
+        blob_top_label_->count()) * sizeof(Dtype), layer.WorkspaceBytes());
 
     for (int iter = 0; iter < 100; ++iter) {
       layer.Forward(blob_bottom_vec_, blob_top_vec_);
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "gtest/gtest.h"
+#include "opencv2/core/core.hpp"
 
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
@@ -340,5 +341,73 @@ TYPED_TEST(DataTransformTest, TestMeanFile) {
   }
 }
 
+TYPED_TEST(DataTransformTest, TestMatCropMirrorMeanFile) {
+  typedef TypeParam Dtype;
+  TransformationParameter transform_param;
+  const int channels = 3;
+  const int height = 6;
+  const int width = 7;
+  const int crop_size = 4;
+  // Center crop in the TEST phase
+  const int h_off = 1;
+  const int w_off = 1;
+  const Dtype scale = 0.5;
+
+  // Create a mean file
+  string mean_file;
+  MakeTempFilename(&mean_file);
+  BlobProto blob_mean;
+  blob_mean.set_num(1);
+  blob_mean.set_channels(channels);
+  blob_mean.set_height(height);
+  blob_mean.set_width(width);
+  for (int j = 0; j < channels * height * width; ++j) {
+    blob_mean.add_data(j % 11);
+  }
+  WriteProtoToBinaryFile(blob_mean, mean_file);
+
+  cv::Mat cv_img(height, width, CV_8UC3);
+  for (int h = 0; h < height; ++h) {
+    uchar* ptr = cv_img.ptr<uchar>(h);
+    for (int j = 0; j < width * channels; ++j) {
+      ptr[j] = static_cast<uchar>(h * width * channels + j);
+    }
+  }
+
+  transform_param.set_mean_file(mean_file);
+  transform_param.set_crop_size(crop_size);
+  transform_param.set_mirror(true);
+  transform_param.set_scale(scale);
+  Blob<Dtype> blob(1, channels, crop_size, crop_size);
+  DataTransformer<Dtype> transformer(transform_param, TEST);
+  Caffe::set_random_seed(this->seed_);
+  transformer.InitRand();
+  int num_mirrored = 0;
+  for (int iter = 0; iter < this->num_iter_; ++iter) {
+    transformer.Transform(cv_img, &blob);
+    int num_plain_matches = 0;
+    int num_mirror_matches = 0;
+    for (int c = 0; c < channels; ++c) {
+      for (int h = 0; h < crop_size; ++h) {
+        for (int w = 0; w < crop_size; ++w) {
+          const Dtype pixel = cv_img.ptr<uchar>(h_off + h)[
+              (w_off + w) * channels + c];
+          const Dtype mean = blob_mean.data(
+              (c * height + h_off + h) * width + w_off + w);
+          const Dtype expected = (pixel - mean) * scale;
+          num_plain_matches += (expected == blob.data_at(0, c, h, w));
+          num_mirror_matches +=
+              (expected == blob.data_at(0, c, h, crop_size - 1 - w));
+        }
+      }
+    }
+    const int size = channels * crop_size * crop_size;
+    EXPECT_TRUE(num_plain_matches == size || num_mirror_matches == size);
+    num_mirrored += (num_mirror_matches == size);
+  }
+  EXPECT_GT(num_mirrored, 0);
+  EXPECT_LT(num_mirrored, this->num_iter_);
+}
+
 }  // namespace caffe
 #endif  // USE_OPENCV
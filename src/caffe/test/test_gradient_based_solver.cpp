@@ -1,3 +1,5 @@
+#include <boost/thread.hpp>
+
 #include <algorithm>
 #include <string>
 #include <utility>
@@ -26,7 +28,7 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
  protected:
   GradientBasedSolverTest() :
       seed_(1701), num_(4), channels_(3), height_(10), width_(10),
-      share_(false) {
+      share_(false), snapshot_async_(false), ring_(false) {
         input_file_ = new string(
         CMAKE_SOURCE_DIR "caffe/test/test_data/solver_data_list.txt" CMAKE_EXT);
       }
@@ -37,11 +39,16 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
   string snapshot_prefix_;
   shared_ptr<SGDSolver<Dtype> > solver_;
   shared_ptr<P2PSync<Dtype> > sync_;
+  shared_ptr<CPUSync<Dtype> > cpu_sync_;
   int seed_;
   // Dimensions are determined by generate_sample_data.py
   // TODO this is brittle and the hdf5 file should be checked instead.
   int num_, channels_, height_, width_;
   bool share_;
+  bool snapshot_async_;
+  // Whether to train on several devices with a ring of RingSync ranks, on
+  // threads, rather than with CPUSync on CPU.
+  bool ring_;
   Dtype delta_;  // Stability constant for RMSProp, AdaGrad, AdaDelta and Adam
 
   // Test data: check out generate_sample_data.py in the same directory.
@@ -181,6 +188,9 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
     if (snapshot) {
       proto << "snapshot: " << num_iters << " ";
     }
+    if (snapshot_async_) {
+      proto << "snapshot_async: true ";
+    }
     Caffe::set_random_seed(this->seed_);
     this->InitSolverFromProtoString(proto.str());
     if (from_snapshot != NULL) {
@@ -191,6 +201,16 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
     }
     if (devices == 1) {
       this->solver_->Solve();
+    } else if (Caffe::mode() == Caffe::CPU && ring_) {
+      LOG(INFO) << "Ring test on " << devices << " threads";
+      RunRing(devices);
+    } else if (Caffe::mode() == Caffe::CPU) {
+      LOG(INFO) << "Multi-thread CPU test on " << devices << " threads";
+      Caffe::set_solver_count(devices);
+      this->cpu_sync_.reset(new CPUSync<Dtype>(
+          this->solver_, NULL, 0, this->solver_->param()));
+      this->cpu_sync_->Run(devices);
+      Caffe::set_solver_count(1);
     } else {
       LOG(INFO) << "Multi-GPU test on " << devices << " devices";
       vector<int> gpus;
@@ -217,6 +237,42 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
     return string();
   }
 
+  // Trains solver_ as rank 0 of a ring of the given size, each rank on its
+  // own thread and net, as `caffe train --ring` does with processes.
+  void RunRing(int size) {
+    vector<string> addresses;
+    for (int i = 0; i < size; ++i) {
+      ostringstream address;
+      address << "unix:" << snapshot_prefix_ << "/ring" << i;
+      addresses.push_back(address.str());
+    }
+    vector<shared_ptr<SGDSolver<Dtype> > > solvers(1, solver_);
+    SolverParameter param = solver_->param();
+    param.set_snapshot(0);
+    param.set_snapshot_after_train(false);
+    for (int i = 1; i < size; ++i) {
+      InitSolver(param);
+      // Each rank reads its own share of the data.
+      for (int j = 0; j < i * param.iter_size(); ++j) {
+        solver_->net()->Forward();
+      }
+      solvers.push_back(solver_);
+    }
+    solver_ = solvers[0];
+    boost::thread_group ranks;
+    for (int i = 0; i < size; ++i) {
+      ranks.create_thread(boost::bind(&GradientBasedSolverTest::RunRank,
+          solvers[i], addresses, i));
+    }
+    ranks.join_all();
+  }
+
+  static void RunRank(shared_ptr<SGDSolver<Dtype> > solver,
+      const vector<string>& addresses, int rank) {
+    RingSync<Dtype> sync(solver, addresses, rank);
+    sync.Run();
+  }
+
   // Compute an update value given the current state of the train net,
   // using the analytical formula for the least squares gradient.
   // updated_params will store the updated weight and bias results,
@@ -397,12 +453,13 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
   }
 
   void CheckAccumulation(const Dtype kLearningRate, const Dtype kWeightDecay,
-      const Dtype kMomentum, const int kNumIters, const int kIterSize) {
+      const Dtype kMomentum, const int kNumIters, const int kIterSize,
+      const int devices = 1) {
     const double kPrecision = 1e-2;
     const double kMinPrecision = 1e-7;
     // Solve without accumulation and save parameters.
     this->RunLeastSquaresSolver(kLearningRate, kWeightDecay, kMomentum,
-        kNumIters);
+        kNumIters, 1, devices);
     // Save parameters for comparison.
     Net<Dtype>& net = *this->solver_->net();
     const vector<shared_ptr<Blob<Dtype> > >& param_blobs =
@@ -414,7 +471,7 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
     }
     // Solve by equivalent accumulation of gradients over divided batches.
     this->RunLeastSquaresSolver(kLearningRate, kWeightDecay, kMomentum,
-        kNumIters, kIterSize);
+        kNumIters, kIterSize, devices);
     Net<Dtype>& net_accum = *this->solver_->net();
     const vector<shared_ptr<Blob<Dtype> > >& accum_params =
         net_accum.layer_by_name("innerprod")->blobs();
@@ -455,13 +512,16 @@ class GradientBasedSolverTest : public MultiDeviceTest<TypeParam> {
       const int iter_to_check = 0) {
     const int kNum = num_;
     const int kIterSize = 1;
-    // Test over all numbers of devices.
+    // Test over all numbers of devices, or of threads on CPU.
     int available_devices = 1;
 #ifndef CPU_ONLY
     if (Caffe::mode() == Caffe::GPU) {
       CUDA_CHECK(cudaGetDeviceCount(&available_devices));
     }
 #endif
+    if (Caffe::mode() == Caffe::CPU) {
+      available_devices = 2;
+    }
     for (int devices = 1; devices <= available_devices; ++devices) {
       // Configure batch size for single / multi device equivalence.
       // Constant data is needed for multi device as for accumulation.
@@ -671,6 +731,35 @@ TYPED_TEST(SGDSolverTest, TestLeastSquaresUpdateWithEverythingAccumShare) {
       kIterSize);
 }
 
+TYPED_TEST(SGDSolverTest, TestLeastSquaresUpdateWithEverythingRing) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.01;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.5;
+  const int kNumIters = 4;
+  this->ring_ = true;
+  for (int i = 0; i <= kNumIters; ++i) {
+    this->TestLeastSquaresUpdate(kLearningRate, kWeightDecay, kMomentum, i);
+  }
+}
+
+TYPED_TEST(SGDSolverTest, TestLeastSquaresUpdateWithEverythingRingAccum) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.01;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  const int kIterSize = 2;
+  if (Caffe::mode() != Caffe::CPU) {
+    return;  // RingSync is CPU only.
+  }
+  // Reducing during backward without accumulation gives the same result as
+  // reducing the accumulated gradients at once.
+  this->ring_ = true;
+  this->CheckAccumulation(kLearningRate, kWeightDecay, kMomentum, kNumIters,
+      kIterSize, 2);
+}
+
 TYPED_TEST(SGDSolverTest, TestSnapshot) {
   typedef typename TypeParam::Dtype Dtype;
   const Dtype kLearningRate = 0.01;
@@ -694,6 +783,18 @@ TYPED_TEST(SGDSolverTest, TestSnapshotShare) {
   }
 }
 
+TYPED_TEST(SGDSolverTest, TestSnapshotAsync) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.01;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  this->snapshot_async_ = true;
+  for (int i = 1; i <= kNumIters; ++i) {
+    this->TestSnapshot(kLearningRate, kWeightDecay, kMomentum, i);
+  }
+}
+
 TYPED_TEST(SGDSolverTest, TestSolverType) {
   this->TestLeastSquaresUpdate();
   EXPECT_NE(this->solver_->type(), string(""));
@@ -1164,6 +1265,18 @@ TYPED_TEST(AdamSolverTest, TestSnapshotShare) {
   }
 }
 
+TYPED_TEST(AdamSolverTest, TestSnapshotAsync) {
+  typedef typename TypeParam::Dtype Dtype;
+  const Dtype kLearningRate = 0.01;
+  const Dtype kWeightDecay = 0.5;
+  const Dtype kMomentum = 0.9;
+  const int kNumIters = 4;
+  this->snapshot_async_ = true;
+  for (int i = 1; i <= kNumIters; ++i) {
+    this->TestSnapshot(kLearningRate, kWeightDecay, kMomentum, i);
+  }
+}
+
 template <typename TypeParam>
 class RMSPropSolverTest : public GradientBasedSolverTest<TypeParam> {
   typedef typename TypeParam::Dtype Dtype;
@@ -1267,4 +1380,110 @@ TYPED_TEST(RMSPropSolverTest, TestSnapshotShare) {
   }
 }
 
+// Takes the separate update steps, as the solvers deriving from Solver do.
+template <typename Solver>
+class UnfusedSolver : public Solver {
+ public:
+  explicit UnfusedSolver(const SolverParameter& param) : Solver(param) {}
+};
+
+template <typename Dtype>
+class FusedUpdateTest : public CPUDeviceTest<Dtype> {
+ protected:
+  // Returns the parameters of a solver with enough weights for the fused
+  // update to split them across threads.
+  SolverParameter SolverParam(Dtype momentum) {
+    ostringstream proto;
+    proto <<
+       "max_iter: 3 "
+       "base_lr: 0.01 "
+       "lr_policy: 'fixed' "
+       "weight_decay: 0.005 "
+       "momentum: " << momentum << " "
+       "snapshot_after_train: false "
+       "solver_mode: CPU "
+       "net_param { "
+       "  layer { "
+       "    name: 'data' "
+       "    type: 'DummyData' "
+       "    dummy_data_param { "
+       "      shape { dim: 4 dim: 1000 } "
+       "      shape { dim: 4 dim: 160 } "
+       "      data_filler { type: 'gaussian' std: 1.0 } "
+       "      data_filler { type: 'gaussian' std: 1.0 } "
+       "    } "
+       "    top: 'data' "
+       "    top: 'targets' "
+       "  } "
+       "  layer { "
+       "    name: 'innerprod' "
+       "    type: 'InnerProduct' "
+       "    inner_product_param { "
+       "      num_output: 160 "
+       "      weight_filler { type: 'gaussian' std: 0.1 } "
+       "      bias_filler { type: 'gaussian' std: 0.1 } "
+       "    } "
+       "    bottom: 'data' "
+       "    top: 'innerprod' "
+       "  } "
+       "  layer { "
+       "    name: 'loss' "
+       "    type: 'EuclideanLoss' "
+       "    bottom: 'innerprod' "
+       "    bottom: 'targets' "
+       "  } "
+       "} ";
+    SolverParameter param;
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto.str(), &param));
+    EXPECT_GE(param.net_param().layer(1).inner_product_param().num_output() *
+        1000, 2 * kFusedUpdateGrain);
+    return param;
+  }
+
+  void ExpectBlobsNear(const vector<shared_ptr<Blob<Dtype> > >& expected,
+      const vector<shared_ptr<Blob<Dtype> > >& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int i = 0; i < expected.size(); ++i) {
+      ASSERT_EQ(expected[i]->count(), actual[i]->count());
+      for (int j = 0; j < expected[i]->count(); ++j) {
+        const Dtype value = expected[i]->cpu_data()[j];
+        EXPECT_NEAR(value, actual[i]->cpu_data()[j],
+            1e-5 * std::max<Dtype>(1, fabs(value))) << "blob " << i;
+      }
+    }
+  }
+
+  // Trains with Solver and with its separate steps and compares the
+  // parameters and histories.
+  template <typename Solver>
+  void TestFusedUpdate(const SolverParameter& param) {
+    Caffe::set_random_seed(1701);
+    Solver fused(param);
+    fused.Solve();
+    Caffe::set_random_seed(1701);
+    UnfusedSolver<Solver> unfused(param);
+    unfused.Solve();
+    ExpectBlobsNear(unfused.net()->params(), fused.net()->params());
+    ExpectBlobsNear(unfused.history(), fused.history());
+  }
+};
+
+TYPED_TEST_CASE(FusedUpdateTest, TestDtypes);
+
+TYPED_TEST(FusedUpdateTest, TestSGD) {
+  this->template TestFusedUpdate<SGDSolver<TypeParam> >(
+      this->SolverParam(0.9));
+}
+
+TYPED_TEST(FusedUpdateTest, TestRMSProp) {
+  SolverParameter param = this->SolverParam(0);
+  param.set_rms_decay(0.95);
+  this->template TestFusedUpdate<RMSPropSolver<TypeParam> >(param);
+}
+
+TYPED_TEST(FusedUpdateTest, TestAdam) {
+  this->template TestFusedUpdate<AdamSolver<TypeParam> >(
+      this->SolverParam(0.9));
+}
+
 }  // namespace caffe
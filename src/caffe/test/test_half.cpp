@@ -0,0 +1,109 @@
+#include <stdint.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/util/half.hpp"
+#include "caffe/util/math_functions.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class HalfTest : public ::testing::Test {
+ protected:
+  uint16_t ToHalf(Dtype value) {
+    uint16_t half;
+    caffe_cpu_to_half(1, &value, &half);
+    return half;
+  }
+
+  Dtype FromHalf(uint16_t half) {
+    Dtype value;
+    caffe_cpu_from_half(1, &half, &value);
+    return value;
+  }
+
+  // Checks that gemm with the half matrix converted back gives the result of
+  // the half gemm.
+  void TestGemm(const CBLAS_TRANSPOSE TransB, int M, int N, int K) {
+    Blob<Dtype> a(1, 1, M, K), b(1, 1, K, N), c(1, 1, M, N);
+    Blob<Dtype> expected(c.shape());
+    caffe_rng_gaussian(a.count(), Dtype(0), Dtype(1), a.mutable_cpu_data());
+    caffe_rng_gaussian(b.count(), Dtype(0), Dtype(1), b.mutable_cpu_data());
+    caffe_rng_gaussian(c.count(), Dtype(0), Dtype(1), c.mutable_cpu_data());
+    caffe_copy(c.count(), c.cpu_data(), expected.mutable_cpu_data());
+    vector<uint16_t> half_data(b.count());
+    caffe_cpu_to_half(b.count(), b.cpu_data(), &half_data[0]);
+    caffe_cpu_from_half(b.count(), &half_data[0], b.mutable_cpu_data());
+    caffe_cpu_gemm<Dtype>(CblasNoTrans, TransB, M, N, K, Dtype(0.5),
+        a.cpu_data(), b.cpu_data(), Dtype(2), expected.mutable_cpu_data());
+    caffe_cpu_gemm_half_b<Dtype>(TransB, M, N, K, Dtype(0.5), a.cpu_data(),
+        &half_data[0], Dtype(2), c.mutable_cpu_data());
+    for (int i = 0; i < c.count(); ++i) {
+      EXPECT_NEAR(expected.cpu_data()[i], c.cpu_data()[i], 1e-3);
+    }
+  }
+};
+
+TYPED_TEST_CASE(HalfTest, TestDtypes);
+
+TYPED_TEST(HalfTest, TestExact) {
+  const TypeParam kValues[] = {0, 1, -2, 0.5, 0.1875, 65504, -65504,
+      // The least normal and subnormal halves.
+      std::pow(TypeParam(2), -14), std::pow(TypeParam(2), -24)};
+  const uint16_t kHalves[] = {0x0000, 0x3c00, 0xc000, 0x3800, 0x3200, 0x7bff,
+      0xfbff, 0x0400, 0x0001};
+  for (int i = 0; i < sizeof(kValues) / sizeof(kValues[0]); ++i) {
+    EXPECT_EQ(kHalves[i], this->ToHalf(kValues[i])) << kValues[i];
+    EXPECT_EQ(kValues[i], this->FromHalf(kHalves[i])) << kValues[i];
+  }
+  EXPECT_EQ(0x8000, this->ToHalf(-TypeParam(0)));
+  EXPECT_EQ(0x7c00,
+      this->ToHalf(std::numeric_limits<TypeParam>::infinity()));
+  EXPECT_EQ(std::numeric_limits<TypeParam>::infinity(),
+      this->FromHalf(0x7c00));
+  EXPECT_TRUE(std::isnan(this->FromHalf(
+      this->ToHalf(std::numeric_limits<TypeParam>::quiet_NaN()))));
+}
+
+TYPED_TEST(HalfTest, TestRounding) {
+  const TypeParam kUlp = std::pow(TypeParam(2), -10);
+  // Ties round to the even mantissa.
+  EXPECT_EQ(0x3c00, this->ToHalf(1 + kUlp / 2));
+  EXPECT_EQ(0x3c02, this->ToHalf(1 + 3 * kUlp / 2));
+  EXPECT_EQ(0x3c01, this->ToHalf(1 + kUlp * 0.6));
+  EXPECT_EQ(0x7bff, this->ToHalf(65519));
+  EXPECT_EQ(0x7c00, this->ToHalf(65520));
+  EXPECT_EQ(0x0000, this->ToHalf(std::pow(TypeParam(2), -25)));
+  EXPECT_EQ(0x0001, this->ToHalf(std::pow(TypeParam(2), -25) * 1.5));
+}
+
+TYPED_TEST(HalfTest, TestArray) {
+  // Longer than a vector, with a tail.
+  const int n = 21;
+  vector<TypeParam> values(n), converted(n);
+  vector<uint16_t> halves(n);
+  for (int i = 0; i < n; ++i) {
+    values[i] = (i - 10) * TypeParam(0.25);
+  }
+  caffe_cpu_to_half(n, &values[0], &halves[0]);
+  caffe_cpu_from_half(n, &halves[0], &converted[0]);
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(values[i], converted[i]);
+  }
+}
+
+TYPED_TEST(HalfTest, TestGemmHalfB) {
+  // Larger than a block, so that it takes several.
+  this->TestGemm(CblasTrans, 3, 200, 300);
+  this->TestGemm(CblasNoTrans, 3, 200, 300);
+}
+
+}  // namespace caffe
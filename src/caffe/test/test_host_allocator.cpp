@@ -0,0 +1,131 @@
+#include <stdint.h>
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/host_allocator.hpp"
+#include "caffe/syncedmem.hpp"
+#include "caffe/util/numa.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class HostAllocatorTest : public ::testing::Test {};
+
+TEST_F(HostAllocatorTest, TestBucketSize) {
+  EXPECT_EQ(64, CachingHostAllocator::BucketSize(0));
+  EXPECT_EQ(64, CachingHostAllocator::BucketSize(1));
+  EXPECT_EQ(64, CachingHostAllocator::BucketSize(64));
+  EXPECT_EQ(128, CachingHostAllocator::BucketSize(65));
+  EXPECT_EQ(1024, CachingHostAllocator::BucketSize(1024));
+  EXPECT_EQ(1280, CachingHostAllocator::BucketSize(1025));
+  EXPECT_EQ(1792, CachingHostAllocator::BucketSize(1700));
+  for (size_t size = 1; size < (1 << 20); size = size * 3 / 2 + 1) {
+    const size_t bucket = CachingHostAllocator::BucketSize(size);
+    EXPECT_EQ(0, bucket % HostAllocator::kAlignment);
+    EXPECT_GE(bucket, size);
+    EXPECT_LE(bucket,
+        std::max<size_t>(size * 5 / 4, size + HostAllocator::kAlignment - 1));
+  }
+}
+
+TEST_F(HostAllocatorTest, TestCaching) {
+  CachingHostAllocator allocator;
+  void* ptr = allocator.Allocate(1000);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(ptr) % HostAllocator::kAlignment);
+  HostAllocator::Stats stats = allocator.stats();
+  EXPECT_EQ(1024, stats.bytes_in_use);
+  EXPECT_EQ(0, stats.bytes_cached);
+  allocator.Free(ptr, 1000);
+  stats = allocator.stats();
+  EXPECT_EQ(0, stats.bytes_in_use);
+  EXPECT_EQ(1024, stats.bytes_cached);
+  // Another size of the same bucket reuses the block, and one of another
+  // bucket does not.
+  void* ptr1 = allocator.Allocate(1010);
+  void* ptr2 = allocator.Allocate(1010);
+  void* ptr3 = allocator.Allocate(2000);
+  EXPECT_EQ(ptr, ptr1);
+  EXPECT_NE(ptr, ptr2);
+  EXPECT_NE(ptr, ptr3);
+  stats = allocator.stats();
+  EXPECT_EQ(2 * 1024 + 2048, stats.bytes_in_use);
+  EXPECT_EQ(stats.bytes_in_use, stats.peak_bytes_in_use);
+  EXPECT_EQ(0, stats.bytes_cached);
+  EXPECT_EQ(4, stats.allocations);
+  EXPECT_EQ(1, stats.cache_hits);
+  EXPECT_EQ(0.25, stats.hit_rate());
+  allocator.Free(ptr1, 1010);
+  allocator.Free(ptr2, 1010);
+  allocator.Free(ptr3, 2000);
+  stats = allocator.stats();
+  EXPECT_EQ(0, stats.bytes_in_use);
+  EXPECT_EQ(2 * 1024 + 2048, stats.peak_bytes_in_use);
+  EXPECT_EQ(2 * 1024 + 2048, stats.bytes_cached);
+  allocator.EmptyCache();
+  EXPECT_EQ(0, allocator.stats().bytes_cached);
+}
+
+TEST_F(HostAllocatorTest, TestCachingByNode) {
+  // A block freed on a NUMA node serves that node only, another node, or
+  // threads bound to none, getting blocks of their own.
+  const int other_node = caffe_numa_nodes() > 1 ? 1 : -1;
+  CachingHostAllocator allocator;
+  Caffe::SetNumaNode(0);
+  void* ptr = allocator.Allocate(1000);
+  allocator.Free(ptr, 1000);
+  Caffe::SetNumaNode(other_node);
+  void* other_ptr = allocator.Allocate(1000);
+  EXPECT_NE(ptr, other_ptr);
+  EXPECT_EQ(0, allocator.stats().cache_hits);
+  allocator.Free(other_ptr, 1000);
+  Caffe::SetNumaNode(0);
+  EXPECT_EQ(ptr, allocator.Allocate(1000));
+  EXPECT_EQ(1, allocator.stats().cache_hits);
+  allocator.Free(ptr, 1000);
+  Caffe::SetNumaNode(other_node);
+  EXPECT_EQ(other_ptr, allocator.Allocate(1000));
+  EXPECT_EQ(2, allocator.stats().cache_hits);
+  allocator.Free(other_ptr, 1000);
+  Caffe::SetNumaNode(-1);
+}
+
+TEST_F(HostAllocatorTest, TestMaxCachedBytes) {
+  CachingHostAllocator allocator(1024);
+  void* ptr1 = allocator.Allocate(1000);
+  void* ptr2 = allocator.Allocate(1000);
+  allocator.Free(ptr1, 1000);
+  allocator.Free(ptr2, 1000);
+  EXPECT_EQ(1024, allocator.stats().bytes_cached);
+}
+
+TEST_F(HostAllocatorTest, TestAligned) {
+  AlignedHostAllocator allocator;
+  void* ptr = allocator.Allocate(1000);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(ptr) % HostAllocator::kAlignment);
+  EXPECT_EQ(1000, allocator.stats().bytes_in_use);
+  allocator.Free(ptr, 1000);
+  EXPECT_EQ(0, allocator.stats().bytes_in_use);
+  EXPECT_EQ(1000, allocator.stats().peak_bytes_in_use);
+  EXPECT_EQ(0, allocator.stats().cache_hits);
+}
+
+TEST_F(HostAllocatorTest, TestSyncedMemory) {
+  if (Caffe::mode() != Caffe::CPU) {
+    return;
+  }
+  const size_t bytes_in_use = Caffe::host_allocator()->stats().bytes_in_use;
+  {
+    SyncedMemory mem(10000);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(mem.cpu_data()) %
+        HostAllocator::kAlignment);
+    EXPECT_EQ(bytes_in_use + CachingHostAllocator::BucketSize(10000),
+        Caffe::host_allocator()->stats().bytes_in_use);
+  }
+  EXPECT_EQ(bytes_in_use, Caffe::host_allocator()->stats().bytes_in_use);
+}
+
+}  // namespace caffe
@@ -0,0 +1,67 @@
+#ifdef USE_OPENCV
+#include <opencv2/core/core.hpp>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/image_cache.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class ImageCacheTest : public ::testing::Test {
+ protected:
+  ImageCacheTest()
+      : image_(4, 5, CV_8UC3, cv::Scalar(1, 2, 3)),
+        image_bytes_(4 * 5 * 3) {}
+
+  cv::Mat image_;
+  const size_t image_bytes_;
+};
+
+TEST_F(ImageCacheTest, TestLookup) {
+  ImageCache cache(10 * image_bytes_);
+  cv::Mat cached;
+  EXPECT_FALSE(cache.Lookup("a", &cached));
+  cache.Insert("a", image_);
+  EXPECT_TRUE(cache.Lookup("a", &cached));
+  EXPECT_EQ(image_.data, cached.data);
+  EXPECT_EQ(image_bytes_, cache.size());
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(1, cache.misses());
+}
+
+TEST_F(ImageCacheTest, TestEvictLeastRecentlyUsed) {
+  ImageCache cache(2 * image_bytes_);
+  cv::Mat cached;
+  cache.Insert("a", image_);
+  cache.Insert("b", image_.clone());
+  // Touch a, so that b is the least recently used image.
+  EXPECT_TRUE(cache.Lookup("a", &cached));
+  cache.Insert("c", image_.clone());
+  EXPECT_EQ(2 * image_bytes_, cache.size());
+  EXPECT_TRUE(cache.Lookup("a", &cached));
+  EXPECT_FALSE(cache.Lookup("b", &cached));
+  EXPECT_TRUE(cache.Lookup("c", &cached));
+}
+
+TEST_F(ImageCacheTest, TestSkipOversized) {
+  ImageCache cache(image_bytes_ - 1);
+  cv::Mat cached;
+  cache.Insert("a", image_);
+  EXPECT_FALSE(cache.Lookup("a", &cached));
+  EXPECT_EQ(0, cache.size());
+}
+
+TEST_F(ImageCacheTest, TestShared) {
+  shared_ptr<ImageCache> cache = ImageCache::GetShared("test", image_bytes_);
+  cache->Insert("a", image_);
+  cv::Mat cached;
+  EXPECT_TRUE(ImageCache::GetShared("test", image_bytes_)->Lookup("a",
+      &cached));
+  EXPECT_NE(cache, ImageCache::GetShared("other", image_bytes_));
+}
+
+}  // namespace caffe
+#endif  // USE_OPENCV
@@ -186,6 +186,39 @@ TYPED_TEST(ImageDataLayerTest, TestShuffle) {
   }
 }
 
+TYPED_TEST(ImageDataLayerTest, TestCache) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter param;
+  ImageDataParameter* image_data_param = param.mutable_image_data_param();
+  image_data_param->set_batch_size(5);
+  image_data_param->set_source(this->filename_.c_str());
+  image_data_param->set_shuffle(false);
+  ImageDataLayer<Dtype> reference_layer(param);
+  Blob<Dtype> reference_data;
+  Blob<Dtype> reference_label;
+  vector<Blob<Dtype>*> reference_top_vec;
+  reference_top_vec.push_back(&reference_data);
+  reference_top_vec.push_back(&reference_label);
+  reference_layer.SetUp(this->blob_bottom_vec_, reference_top_vec);
+  reference_layer.Forward(this->blob_bottom_vec_, reference_top_vec);
+  // Room for a single decoded 480x360 image.
+  image_data_param->set_cache_size(480 * 360 * 3);
+  ImageDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  // Go through the data twice, the second epoch is served from the cache
+  for (int iter = 0; iter < 2; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    ASSERT_EQ(reference_data.count(), this->blob_top_data_->count());
+    for (int i = 0; i < reference_data.count(); ++i) {
+      EXPECT_EQ(reference_data.cpu_data()[i],
+                this->blob_top_data_->cpu_data()[i]);
+    }
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_EQ(i, this->blob_top_label_->cpu_data()[i]);
+    }
+  }
+}
+
 TYPED_TEST(ImageDataLayerTest, TestSpace) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter param;
@@ -1,3 +1,8 @@
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -8,9 +13,12 @@
 
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
+#include "caffe/host_allocator.hpp"
 #include "caffe/net.hpp"
+#include "caffe/util/half.hpp"
 #include "caffe/util/io.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/raw_model.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
 #include "caffe/test/test_gradient_check_util.hpp"
@@ -879,6 +887,81 @@ TYPED_TEST(NetTest, TestGetLayerByName) {
   EXPECT_FALSE(this->net_->layer_by_name("label"));
 }
 
+// Records the layers it is run with.
+template <typename Dtype>
+class RecordingCallback : public Net<Dtype>::Callback {
+ public:
+  vector<int> layers_;
+
+ protected:
+  void run(int layer) { layers_.push_back(layer); }
+};
+
+TYPED_TEST(NetTest, TestCallbacks) {
+  typedef typename TypeParam::Dtype Dtype;
+  this->InitTinyNet();
+  RecordingCallback<Dtype> before_forward, after_forward, before_backward,
+      after_backward;
+  this->net_->add_before_forward(&before_forward);
+  this->net_->add_after_forward(&after_forward);
+  this->net_->add_before_backward(&before_backward);
+  this->net_->add_after_backward(&after_backward);
+  this->net_->ForwardBackward();
+  const int num_layers = this->net_->layers().size();
+  ASSERT_EQ(num_layers, before_forward.layers_.size());
+  ASSERT_EQ(num_layers, after_forward.layers_.size());
+  ASSERT_EQ(num_layers, before_backward.layers_.size());
+  ASSERT_EQ(num_layers, after_backward.layers_.size());
+  for (int i = 0; i < num_layers; ++i) {
+    EXPECT_EQ(i, before_forward.layers_[i]);
+    EXPECT_EQ(i, after_forward.layers_[i]);
+    // Backward runs from the top, including layers that need no backward.
+    EXPECT_EQ(num_layers - 1 - i, before_backward.layers_[i]);
+    EXPECT_EQ(num_layers - 1 - i, after_backward.layers_[i]);
+  }
+}
+
+TYPED_TEST(NetTest, TestProfiling) {
+  typedef typename TypeParam::Dtype Dtype;
+  this->InitTinyNet();
+  this->net_->ForwardBackward();
+  EXPECT_FALSE(this->net_->profiler());
+  this->net_->EnableProfiling(true);
+  this->net_->ForwardBackward();
+  // Another thread counts on its own, and the stats sum both.
+  boost::thread thread(&Net<Dtype>::ForwardBackward, this->net_.get());
+  thread.join();
+  this->net_->DisableProfiling();
+  this->net_->ForwardBackward();
+  const Profiler& profiler = *this->net_->profiler();
+  vector<Profiler::LayerStats> stats = profiler.stats();
+  const vector<bool>& need_backward = this->net_->layer_need_backward();
+  ASSERT_EQ(this->net_->layers().size(), stats.size());
+  int calls = 0;
+  for (int i = 0; i < stats.size(); ++i) {
+    EXPECT_EQ(2, stats[i].forward_calls);
+    EXPECT_EQ(need_backward[i] ? 2 : 0, stats[i].backward_calls);
+    EXPECT_GE(stats[i].forward_us, 0);
+    EXPECT_GE(stats[i].backward_us, 0);
+    calls += stats[i].forward_calls + stats[i].backward_calls;
+  }
+  std::ostringstream trace;
+  profiler.WriteTrace(trace);
+  int events = 0;
+  for (size_t pos = trace.str().find("\"ph\": \"X\""); pos != string::npos;
+       pos = trace.str().find("\"ph\": \"X\"", pos + 1)) {
+    ++events;
+  }
+  EXPECT_EQ(calls, events);
+  EXPECT_NE(string::npos, trace.str().find("\"tid\": 1"));
+  this->net_->profiler()->Reset();
+  stats = profiler.stats();
+  for (int i = 0; i < stats.size(); ++i) {
+    EXPECT_EQ(0, stats[i].forward_calls);
+    EXPECT_EQ(0, stats[i].backward_calls);
+  }
+}
+
 TYPED_TEST(NetTest, TestBottomNeedBackward) {
   this->InitTinyNet();
   const vector<vector<bool> >& bottom_need_backward =
@@ -1342,6 +1425,714 @@ TYPED_TEST(NetTest, TestSharedWeightsResume) {
   }
 }
 
+TYPED_TEST(NetTest, TestRawModel) {
+  typedef typename TypeParam::Dtype Dtype;
+  Caffe::set_random_seed(this->seed_);
+  this->InitDiffDataSharedWeightsNet();
+  this->net_->ForwardBackward();
+  this->net_->Update();
+  NetParameter net_param;
+  this->net_->ToProto(&net_param);
+  string filename;
+  MakeTempFilename(&filename);
+  filename += ".raw";
+  WriteRawModel<Dtype>(net_param, filename);
+
+  // Whether mapped or copied, the shared weights hold the saved values.
+  for (int map = 0; map < 2; ++map) {
+    Caffe::set_random_seed(this->seed_ + 1);
+    this->InitDiffDataSharedWeightsNet();
+    if (map) {
+      this->net_->CopyTrainedLayersFrom(filename);
+    } else {
+      this->net_->CopyTrainedLayersFromRaw(filename, false);
+    }
+    Blob<Dtype>* ip1_weights = this->net_->layers()[1]->blobs()[0].get();
+    Blob<Dtype>* ip2_weights = this->net_->layers()[2]->blobs()[0].get();
+    EXPECT_EQ(ip1_weights->cpu_data(), ip2_weights->cpu_data());
+    EXPECT_EQ(ip1_weights->cpu_diff(), ip2_weights->cpu_diff());
+    Blob<Dtype> saved_weights;
+    saved_weights.FromProto(net_param.layer(1).blobs(0));
+    ASSERT_EQ(saved_weights.count(), ip1_weights->count());
+    for (int i = 0; i < ip1_weights->count(); ++i) {
+      EXPECT_EQ(saved_weights.cpu_data()[i], ip1_weights->cpu_data()[i]);
+    }
+    // The mapping is private, so updates do not reach the file.
+    this->net_->ForwardBackward();
+    this->net_->Update();
+  }
+  RawModel model(filename);
+  ASSERT_EQ(2, model.index().layer_size());
+  EXPECT_EQ(sizeof(Dtype), model.element_size());
+  Blob<Dtype> saved_weights;
+  saved_weights.FromProto(net_param.layer(1).blobs(0));
+  const Dtype* mapped_weights =
+      static_cast<const Dtype*>(model.blob_data(0, 0));
+  for (int i = 0; i < saved_weights.count(); ++i) {
+    EXPECT_EQ(saved_weights.cpu_data()[i], mapped_weights[i]);
+  }
+  remove(filename.c_str());
+}
+
+TYPED_TEST(NetTest, TestShareRawModel) {
+  typedef typename TypeParam::Dtype Dtype;
+  const string proto =
+      "state: { phase: TEST } "
+      "layer { "
+      "  name: 'data' "
+      "  type: 'DummyData' "
+      "  dummy_data_param { "
+      "    shape { dim: 5 dim: 4 } "
+      "    data_filler { type: 'constant' value: 1 } "
+      "  } "
+      "  top: 'data' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 3 "
+      "    weight_filler { type: 'gaussian' } "
+      "    bias_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'innerproduct' "
+      "} ";
+  Caffe::set_random_seed(this->seed_);
+  this->InitNetFromProtoString(proto);
+  this->net_->Forward();
+  Blob<Dtype> expected_output;
+  const bool kCopyDiff = false;
+  const bool kReshape = true;
+  expected_output.CopyFrom(*this->net_->blob_by_name("innerproduct"),
+      kCopyDiff, kReshape);
+  NetParameter net_param;
+  this->net_->ToProto(&net_param);
+  string filename;
+  MakeTempFilename(&filename);
+  filename += ".raw";
+  WriteRawModel<Dtype>(net_param, filename);
+
+  // Two nets sharing the weights compute the output of the saved one.
+  shared_ptr<Net<Dtype> > nets[2];
+  for (int n = 0; n < 2; ++n) {
+    Caffe::set_random_seed(this->seed_ + 1 + n);
+    this->InitNetFromProtoString(proto);
+    this->net_->ShareTrainedLayersFromRaw(filename);
+    this->net_->Forward();
+    const Blob<Dtype>* output = this->net_->blob_by_name("innerproduct").get();
+    ASSERT_EQ(expected_output.count(), output->count());
+    for (int i = 0; i < output->count(); ++i) {
+      EXPECT_EQ(expected_output.cpu_data()[i], output->cpu_data()[i]);
+    }
+    nets[n] = this->net_;
+  }
+  remove(filename.c_str());
+}
+
+TYPED_TEST(NetTest, TestInferenceOnly) {
+  typedef typename TypeParam::Dtype Dtype;
+  const string proto =
+      "layer { "
+      "  name: 'data' "
+      "  type: 'DummyData' "
+      "  dummy_data_param { "
+      "    shape { dim: 8 dim: 20 } "
+      "    shape { dim: 8 } "
+      "    data_filler { type: 'gaussian' } "
+      "    data_filler { type: 'constant' value: 3 } "
+      "  } "
+      "  top: 'data' "
+      "  top: 'label' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct1' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 30 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'innerproduct1' "
+      "} "
+      "layer { "
+      "  name: 'relu' "
+      "  type: 'ReLU' "
+      "  bottom: 'innerproduct1' "
+      "  top: 'innerproduct1' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct2' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 10 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'innerproduct1' "
+      "  top: 'innerproduct2' "
+      "} "
+      "layer { "
+      "  name: 'loss' "
+      "  type: 'SoftmaxWithLoss' "
+      "  bottom: 'innerproduct2' "
+      "  bottom: 'label' "
+      "  top: 'loss' "
+      "} ";
+  const bool cpu = Caffe::mode() == Caffe::CPU;
+  HostAllocator* allocator = Caffe::host_allocator();
+
+  // Train a regular net, and run it forward and backward.
+  size_t bytes_in_use = allocator->stats().bytes_in_use;
+  Caffe::set_random_seed(this->seed_);
+  this->InitNetFromProtoString(proto);
+  EXPECT_FALSE(this->net_->inference_only());
+  Dtype loss;
+  this->net_->Forward(&loss);
+  this->net_->Backward();
+  const size_t regular_bytes = allocator->stats().bytes_in_use - bytes_in_use;
+  // The diffs it allocates and an inference-only net does not.
+  size_t diff_bytes = 0;
+  const vector<Blob<Dtype>*>& params = this->net_->learnable_params();
+  for (int i = 0; i < params.size(); ++i) {
+    diff_bytes += CachingHostAllocator::BucketSize(
+        params[i]->count() * sizeof(Dtype));
+  }
+  for (int i = 0; i < 2; ++i) {
+    const char* name = i ? "innerproduct2" : "innerproduct1";
+    diff_bytes += CachingHostAllocator::BucketSize(
+        this->net_->blob_by_name(name)->count() * sizeof(Dtype));
+  }
+  this->net_.reset();
+
+  bytes_in_use = allocator->stats().bytes_in_use;
+  Caffe::set_random_seed(this->seed_);
+  this->InitNetFromProtoString("inference_only: true " + proto);
+  EXPECT_TRUE(this->net_->inference_only());
+  Dtype inference_loss;
+  this->net_->Forward(&inference_loss);
+  const size_t inference_bytes =
+      allocator->stats().bytes_in_use - bytes_in_use;
+  EXPECT_EQ(loss, inference_loss);
+  if (cpu) {
+    EXPECT_EQ(regular_bytes - diff_bytes, inference_bytes);
+  }
+  // Only the loss output has a diff, holding its loss weight, and on GPU the
+  // predictions, in which the loss computes the losses of each item.
+  const vector<string>& blob_names = this->net_->blob_names();
+  for (int i = 0; i < blob_names.size(); ++i) {
+    EXPECT_EQ(blob_names[i] == "loss" ||
+        (!cpu && blob_names[i] == "innerproduct2"),
+        this->net_->blobs()[i]->has_diff()) << blob_names[i];
+  }
+  for (int i = 0; i < this->net_->params().size(); ++i) {
+    EXPECT_FALSE(this->net_->params()[i]->has_diff());
+  }
+  for (int i = 0; i < this->net_->layers().size(); ++i) {
+    EXPECT_FALSE(this->net_->layer_need_backward()[i]);
+  }
+  // Reshaping creates no diffs either.
+  this->net_->blob_by_name("data")->Reshape(16, 20, 1, 1);
+  this->net_->blob_by_name("label")->Reshape(16, 1, 1, 1);
+  this->net_->Reshape();
+  EXPECT_FALSE(this->net_->blob_by_name("innerproduct1")->has_diff());
+}
+
+TYPED_TEST(NetTest, TestInferenceOnlyHingeLoss) {
+  typedef typename TypeParam::Dtype Dtype;
+  // The hinge loss computes its margins in the diff of its predictions.
+  const string proto =
+      "layer { "
+      "  name: 'data' "
+      "  type: 'DummyData' "
+      "  dummy_data_param { "
+      "    shape { dim: 8 dim: 20 } "
+      "    shape { dim: 8 } "
+      "    data_filler { type: 'gaussian' } "
+      "    data_filler { type: 'constant' value: 3 } "
+      "  } "
+      "  top: 'data' "
+      "  top: 'label' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 10 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'innerproduct' "
+      "} "
+      "layer { "
+      "  name: 'loss' "
+      "  type: 'HingeLoss' "
+      "  bottom: 'innerproduct' "
+      "  bottom: 'label' "
+      "  top: 'loss' "
+      "} ";
+  Caffe::set_random_seed(this->seed_);
+  this->InitNetFromProtoString(proto);
+  Dtype loss;
+  this->net_->Forward(&loss);
+  Caffe::set_random_seed(this->seed_);
+  this->InitNetFromProtoString("inference_only: true " + proto);
+  EXPECT_TRUE(this->net_->blob_by_name("innerproduct")->has_diff());
+  EXPECT_FALSE(this->net_->blob_by_name("data")->has_diff());
+  Dtype inference_loss;
+  this->net_->Forward(&inference_loss);
+  EXPECT_EQ(loss, inference_loss);
+}
+
+TYPED_TEST(NetTest, TestForwardThreads) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Three branches off a split, the last starting with an in-place layer on
+  // the memory the other two read, which must therefore run before it.
+  const string proto =
+      "layer { "
+      "  name: 'data' "
+      "  type: 'Input' "
+      "  input_param { shape { dim: 2 dim: 10 } } "
+      "  top: 'data' "
+      "} "
+      "layer { "
+      "  name: 'split' "
+      "  type: 'Split' "
+      "  bottom: 'data' "
+      "  top: 'data_a' "
+      "  top: 'data_b' "
+      "  top: 'data_c' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct_a' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 5 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'data_a' "
+      "  top: 'a' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct_b' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 5 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'data_b' "
+      "  top: 'b' "
+      "} "
+      "layer { "
+      "  name: 'relu_c' "
+      "  type: 'ReLU' "
+      "  bottom: 'data_c' "
+      "  top: 'data_c' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct_c' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 5 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'data_c' "
+      "  top: 'c' "
+      "} "
+      "layer { "
+      "  name: 'relu_a' "
+      "  type: 'ReLU' "
+      "  bottom: 'a' "
+      "  top: 'a' "
+      "} "
+      "layer { "
+      "  name: 'sum' "
+      "  type: 'Eltwise' "
+      "  bottom: 'a' "
+      "  bottom: 'b' "
+      "  bottom: 'c' "
+      "  top: 'sum' "
+      "} ";
+  Caffe::set_random_seed(this->seed_);
+  this->InitNetFromProtoString(proto);
+  EXPECT_EQ(1, this->net_->forward_threads());
+  Blob<Dtype>* data = this->net_->blob_by_name("data").get();
+  Blob<Dtype>* sum = this->net_->blob_by_name("sum").get();
+  for (int i = 0; i < data->count(); ++i) {
+    data->mutable_cpu_data()[i] = Dtype(i - 10) / 10;
+  }
+  this->net_->Forward();
+  Blob<Dtype> expected_sum;
+  expected_sum.CopyFrom(*sum, false, true);
+  this->net_->set_forward_threads(0);
+  EXPECT_GE(this->net_->forward_threads(), 1);
+  this->net_->set_forward_threads(4);
+  EXPECT_EQ(4, this->net_->forward_threads());
+  for (int run = 0; run < 20; ++run) {
+    for (int i = 0; i < data->count(); ++i) {
+      data->mutable_cpu_data()[i] = Dtype(i - 10) / 10;
+    }
+    this->net_->Forward();
+    for (int i = 0; i < sum->count(); ++i) {
+      ASSERT_EQ(expected_sum.cpu_data()[i], sum->cpu_data()[i]);
+    }
+  }
+  // relu_c runs after the layers reading the memory it overwrites.
+  const vector<string>& names = this->net_->layer_names();
+  const vector<vector<int> >& dependencies =
+      this->net_->layer_dependencies();
+  ASSERT_EQ(names.size(), dependencies.size());
+  std::map<string, int> layer_ids;
+  for (int i = 0; i < names.size(); ++i) {
+    layer_ids[names[i]] = i;
+  }
+  const vector<int>& relu_c = dependencies[layer_ids["relu_c"]];
+  EXPECT_EQ(3, relu_c.size());
+  EXPECT_EQ(1, std::count(relu_c.begin(), relu_c.end(), layer_ids["split"]));
+  EXPECT_EQ(1, std::count(relu_c.begin(), relu_c.end(),
+      layer_ids["innerproduct_a"]));
+  EXPECT_EQ(1, std::count(relu_c.begin(), relu_c.end(),
+      layer_ids["innerproduct_b"]));
+}
+
+TYPED_TEST(NetTest, TestCloneForInference) {
+  typedef typename TypeParam::Dtype Dtype;
+  const string proto =
+      "layer { "
+      "  name: 'data' "
+      "  type: 'Input' "
+      "  input_param { shape { dim: 2 dim: 10 } } "
+      "  top: 'data' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct1' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 8 "
+      "    weight_filler { type: 'gaussian' } "
+      "    bias_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'innerproduct1' "
+      "} "
+      "layer { "
+      "  name: 'relu' "
+      "  type: 'ReLU' "
+      "  bottom: 'innerproduct1' "
+      "  top: 'innerproduct1' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct2' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 4 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'innerproduct1' "
+      "  top: 'innerproduct2' "
+      "} ";
+  Caffe::set_random_seed(this->seed_);
+  this->InitNetFromProtoString(proto);
+  shared_ptr<Net<Dtype> > clone = this->net_->CloneForInference();
+  EXPECT_TRUE(clone->inference_only());
+  EXPECT_EQ(this->net_->layer_names(), clone->layer_names());
+  EXPECT_EQ(this->net_->blob_names(), clone->blob_names());
+  // The clone shares the parameters, which keep their diffs, and has blobs
+  // of its own.
+  ASSERT_EQ(this->net_->params().size(), clone->params().size());
+  for (int i = 0; i < clone->params().size(); ++i) {
+    EXPECT_EQ(this->net_->params()[i]->cpu_data(),
+              clone->params()[i]->cpu_data());
+    EXPECT_TRUE(this->net_->params()[i]->has_diff());
+  }
+  for (int i = 0; i < clone->blobs().size(); ++i) {
+    EXPECT_NE(this->net_->blobs()[i]->cpu_data(),
+              clone->blobs()[i]->cpu_data());
+  }
+  Blob<Dtype>* data = this->net_->blob_by_name("data").get();
+  Blob<Dtype>* clone_data = clone->blob_by_name("data").get();
+  for (int i = 0; i < data->count(); ++i) {
+    data->mutable_cpu_data()[i] = Dtype(i - 10) / 10;
+  }
+  clone_data->CopyFrom(*data);
+  for (int run = 0; run < 2; ++run) {
+    this->net_->Forward();
+    clone->Forward();
+    const Blob<Dtype>& output = *this->net_->blob_by_name("innerproduct2");
+    const Blob<Dtype>& clone_output = *clone->blob_by_name("innerproduct2");
+    for (int i = 0; i < output.count(); ++i) {
+      EXPECT_EQ(output.cpu_data()[i], clone_output.cpu_data()[i]);
+    }
+    // Updates of the parameters of the net are seen by the clone.
+    caffe_scal(this->net_->params()[0]->count(), Dtype(2),
+               this->net_->params()[0]->mutable_cpu_data());
+  }
+}
+
+TYPED_TEST(NetTest, TestCloneForInferenceOfTrainNet) {
+  typedef typename TypeParam::Dtype Dtype;
+  const string proto =
+      "state { phase: TRAIN } "
+      "layer { "
+      "  name: 'data' "
+      "  type: 'Input' "
+      "  input_param { shape { dim: 2 dim: 10 } } "
+      "  top: 'data' "
+      "} "
+      "layer { "
+      "  name: 'dropout' "
+      "  type: 'Dropout' "
+      "  bottom: 'data' "
+      "  top: 'dropout' "
+      "} ";
+  this->InitNetFromProtoString(proto);
+  EXPECT_EQ(TRAIN, this->net_->phase());
+  shared_ptr<Net<Dtype> > clone = this->net_->CloneForInference();
+  EXPECT_EQ(TEST, clone->phase());
+  EXPECT_EQ(TEST, clone->layer_by_name("dropout")->layer_param().phase());
+  // Dropout passes its input through at test time.
+  Blob<Dtype>* data = clone->blob_by_name("data").get();
+  for (int i = 0; i < data->count(); ++i) {
+    data->mutable_cpu_data()[i] = i + 1;
+  }
+  clone->Forward();
+  const Blob<Dtype>& output = *clone->blob_by_name("dropout");
+  for (int i = 0; i < output.count(); ++i) {
+    EXPECT_EQ(i + 1, output.cpu_data()[i]);
+  }
+}
+
+TYPED_TEST(NetTest, TestStoreWeightsAsHalf) {
+  typedef typename TypeParam::Dtype Dtype;
+  if (Caffe::mode() != Caffe::CPU) {
+    return;
+  }
+  const string proto =
+      "inference_only: true "
+      "layer { "
+      "  name: 'data' "
+      "  type: 'Input' "
+      "  input_param { shape { dim: 2 dim: 3 dim: 6 dim: 6 } } "
+      "  top: 'data' "
+      "} "
+      "layer { "
+      "  name: 'conv' "
+      "  type: 'Convolution' "
+      "  convolution_param { "
+      "    num_output: 4 "
+      "    kernel_size: 3 "
+      "    weight_filler { type: 'gaussian' } "
+      "    bias_filler { type: 'constant' value: 0.1 } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'conv' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 5 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'conv' "
+      "  top: 'innerproduct' "
+      "} ";
+  Caffe::set_random_seed(this->seed_);
+  this->InitNetFromProtoString(proto);
+  Blob<Dtype>* data = this->net_->blob_by_name("data").get();
+  for (int i = 0; i < data->count(); ++i) {
+    data->mutable_cpu_data()[i] = Dtype(i % 7 - 3) / 3;
+  }
+  // Round the weights to half first, so that the outputs only differ by the
+  // order of the sums.
+  const vector<shared_ptr<Layer<Dtype> > >& layers = this->net_->layers();
+  for (int i = 1; i < 3; ++i) {
+    Blob<Dtype>* weights = layers[i]->blobs()[0].get();
+    vector<uint16_t> half_weights(weights->count());
+    caffe_cpu_to_half(weights->count(), weights->cpu_data(),
+        &half_weights[0]);
+    caffe_cpu_from_half(weights->count(), &half_weights[0],
+        weights->mutable_cpu_data());
+  }
+  this->net_->Forward();
+  Blob<Dtype> expected_output;
+  expected_output.CopyFrom(*this->net_->blob_by_name("innerproduct"), false,
+      true);
+  NetParameter full_param;
+  this->net_->ToProto(&full_param);
+
+  EXPECT_EQ(sizeof(Dtype) * 4 * 3 * 3 * 3 - 2 * 4 * 3 * 3 * 3 +
+      sizeof(Dtype) * 5 * 64 - 2 * 5 * 64, this->net_->StoreWeightsAsHalf());
+  EXPECT_TRUE(layers[1]->blobs()[0]->half());
+  EXPECT_FALSE(layers[1]->blobs()[1]->half());
+  EXPECT_TRUE(layers[2]->blobs()[0]->half());
+  EXPECT_FALSE(layers[2]->blobs()[1]->half());
+  this->net_->Forward();
+  const Blob<Dtype>& output = *this->net_->blob_by_name("innerproduct");
+  for (int i = 0; i < output.count(); ++i) {
+    const Dtype expected = expected_output.cpu_data()[i];
+    EXPECT_NEAR(expected, output.cpu_data()[i],
+        1e-4 * std::max(Dtype(1), std::fabs(expected)));
+  }
+
+  // A raw model in half precision loads the same weights.
+  string filename;
+  MakeTempFilename(&filename);
+  filename += ".raw";
+  const bool kHalf = true;
+  WriteRawModel<Dtype>(full_param, filename, kHalf);
+  NetParameter half_param;
+  this->net_->ToProto(&half_param);
+  this->InitNetFromProtoString(proto);
+  this->net_->CopyTrainedLayersFrom(filename);
+  for (int i = 1; i < 3; ++i) {
+    Blob<Dtype> half_weights;
+    half_weights.FromProto(half_param.layer(i).blobs(0));
+    const Blob<Dtype>& weights = *this->net_->layers()[i]->blobs()[0];
+    for (int j = 0; j < weights.count(); ++j) {
+      EXPECT_EQ(half_weights.cpu_data()[j], weights.cpu_data()[j]);
+    }
+  }
+  remove(filename.c_str());
+}
+
+TYPED_TEST(NetTest, TestStoreWeightsAsHalfOfClone) {
+  if (Caffe::mode() != Caffe::CPU) {
+    return;
+  }
+  const string proto =
+      "layer { "
+      "  name: 'data' "
+      "  type: 'Input' "
+      "  input_param { shape { dim: 2 dim: 5 } } "
+      "  top: 'data' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 3 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'innerproduct' "
+      "} ";
+  this->InitNetFromProtoString(proto);
+  typedef typename TypeParam::Dtype Dtype;
+  shared_ptr<Net<Dtype> > clone = this->net_->CloneForInference();
+  // The weights are those of the source net, which keeps training them.
+  EXPECT_EQ(0, clone->StoreWeightsAsHalf());
+  EXPECT_FALSE(this->net_->layers()[1]->blobs()[0]->half());
+  clone->Forward();
+  this->net_->Forward();
+}
+
+TYPED_TEST(NetTest, TestStoreActivationsAsHalf) {
+  typedef typename TypeParam::Dtype Dtype;
+  if (Caffe::mode() != Caffe::CPU) {
+    return;
+  }
+  const string proto =
+      "inference_only: true "
+      "layer { "
+      "  name: 'data' "
+      "  type: 'Input' "
+      "  input_param { shape { dim: 2 dim: 3 dim: 8 dim: 8 } } "
+      "  top: 'data' "
+      "} "
+      "layer { "
+      "  name: 'conv' "
+      "  type: 'Convolution' "
+      "  convolution_param { "
+      "    num_output: 4 "
+      "    kernel_size: 3 "
+      "    weight_filler { type: 'gaussian' } "
+      "    bias_filler { type: 'constant' value: 0.1 } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'conv' "
+      "} "
+      "layer { "
+      "  name: 'relu' "
+      "  type: 'ReLU' "
+      "  bottom: 'conv' "
+      "  top: 'conv' "
+      "} "
+      "layer { "
+      "  name: 'pool' "
+      "  type: 'Pooling' "
+      "  pooling_param { pool: MAX kernel_size: 2 stride: 2 } "
+      "  bottom: 'conv' "
+      "  top: 'pool' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct_a' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 5 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'pool' "
+      "  top: 'innerproduct_a' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct_b' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 3 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'pool' "
+      "  top: 'innerproduct_b' "
+      "} "
+      "layer { "
+      "  name: 'concat' "
+      "  type: 'Concat' "
+      "  bottom: 'innerproduct_a' "
+      "  bottom: 'innerproduct_b' "
+      "  top: 'concat' "
+      "} "
+      "layer { "
+      "  name: 'output' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 2 "
+      "    weight_filler { type: 'gaussian' } "
+      "  } "
+      "  bottom: 'concat' "
+      "  top: 'output' "
+      "} ";
+  Caffe::set_random_seed(this->seed_);
+  this->InitNetFromProtoString(proto);
+  Blob<Dtype>* data = this->net_->blob_by_name("data").get();
+  for (int i = 0; i < data->count(); ++i) {
+    data->mutable_cpu_data()[i] = Dtype(i % 7 - 3) / 3;
+  }
+  this->net_->Forward();
+  Blob<Dtype> expected_output;
+  expected_output.CopyFrom(*this->net_->blob_by_name("output"), false, true);
+
+  // All but the input and the output, with the tops of the split of pool
+  // sharing its data.
+  EXPECT_EQ((2 * 4 * 6 * 6 + 2 * 4 * 3 * 3 + 2 * 5 + 2 * 3 + 2 * 8) *
+      (sizeof(Dtype) - sizeof(uint16_t)),
+      this->net_->StoreActivationsAsHalf());
+  const char* kHalfBlobs[] = {"conv", "pool", "innerproduct_a",
+      "innerproduct_b", "concat"};
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(this->net_->blob_by_name(kHalfBlobs[i])->half())
+        << kHalfBlobs[i];
+  }
+  EXPECT_FALSE(this->net_->blob_by_name("data")->half());
+  EXPECT_FALSE(this->net_->blob_by_name("output")->half());
+  this->net_->Forward();
+  const Blob<Dtype>& output = *this->net_->blob_by_name("output");
+  for (int i = 0; i < output.count(); ++i) {
+    const Dtype expected = expected_output.cpu_data()[i];
+    EXPECT_NEAR(expected, output.cpu_data()[i],
+        1e-2 * std::max(Dtype(1), std::fabs(expected)));
+  }
+}
+
 TYPED_TEST(NetTest, TestParamPropagateDown) {
   typedef typename TypeParam::Dtype Dtype;
   const bool kBiasTerm = true, kForceBackward = false;
@@ -2446,6 +3237,199 @@ TYPED_TEST(NetTest, TestReshape) {
   EXPECT_FALSE(same_spatial_shape);
 }
 
+TYPED_TEST(NetTest, TestReshapeOnChange) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Alternate between two input shapes with and without reshape on change,
+  // and check that the outputs are the same and that nothing reallocates.
+  Caffe::set_random_seed(this->seed_);
+  FillerParameter filler_param;
+  filler_param.set_std(1);
+  GaussianFiller<Dtype> filler(filler_param);
+  Blob<Dtype> blob1(2, 3, 12, 10);
+  Blob<Dtype> blob2(4, 3, 9, 11);
+  filler.Fill(&blob1);
+  filler.Fill(&blob2);
+  Blob<Dtype>* blobs[2] = {&blob1, &blob2};
+
+  this->InitReshapableNet();
+  shared_ptr<Blob<Dtype> > input_blob = this->net_->blob_by_name("data");
+  Blob<Dtype>* output_blob = this->net_->output_blobs()[0];
+  Blob<Dtype> outputs[2];
+  for (int i = 0; i < 2; ++i) {
+    input_blob->ReshapeLike(*blobs[i]);
+    input_blob->CopyFrom(*blobs[i]);
+    this->net_->Reshape();
+    this->net_->Forward();
+    outputs[i].CopyFrom(*output_blob, false, true);
+  }
+
+  this->net_->set_reshape_on_change(true);
+  EXPECT_TRUE(this->net_->reshape_on_change());
+  const Dtype* output_data = NULL;
+  for (int pass = 0; pass < 3; ++pass) {
+    for (int i = 0; i < 2; ++i) {
+      input_blob->ReshapeLike(*blobs[i]);
+      input_blob->CopyFrom(*blobs[i]);
+      this->net_->Reshape();
+      EXPECT_EQ(outputs[i].shape(), output_blob->shape());
+      this->net_->Forward();
+      if (pass > 0) {
+        EXPECT_EQ(output_data, output_blob->cpu_data());
+      }
+      output_data = output_blob->cpu_data();
+      for (int j = 0; j < outputs[i].count(); ++j) {
+        EXPECT_FLOAT_EQ(outputs[i].cpu_data()[j], output_blob->cpu_data()[j]);
+      }
+      // The layers do not reshape again until the inputs change, except
+      // the input layer, which has no bottoms to tell.
+      for (int j = 1; j < this->net_->layers().size(); ++j) {
+        EXPECT_FALSE(this->net_->layers()[j]->ReshapeIfChanged(
+            this->net_->bottom_vecs()[j], this->net_->top_vecs()[j]))
+            << this->net_->layer_names()[j];
+      }
+    }
+  }
+  // Replacing the diff of a bottom, as Flatten does, reshapes its layers.
+  Blob<Dtype> diff;
+  diff.ReshapeLike(*input_blob);
+  input_blob->ShareDiff(diff);
+  EXPECT_TRUE(this->net_->layers()[1]->ReshapeIfChanged(
+      this->net_->bottom_vecs()[1], this->net_->top_vecs()[1]));
+  EXPECT_FALSE(this->net_->layers()[1]->ReshapeIfChanged(
+      this->net_->bottom_vecs()[1], this->net_->top_vecs()[1]));
+}
+
+TYPED_TEST(NetTest, TestInferenceNetForShapes) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Alternate between two input shapes through the clones kept for them,
+  // and check that they match the net and reshape nothing.
+  Caffe::set_random_seed(this->seed_);
+  FillerParameter filler_param;
+  filler_param.set_std(1);
+  GaussianFiller<Dtype> filler(filler_param);
+  Blob<Dtype> blob1(2, 3, 12, 10);
+  Blob<Dtype> blob2(4, 3, 9, 11);
+  filler.Fill(&blob1);
+  filler.Fill(&blob2);
+  Blob<Dtype>* blobs[2] = {&blob1, &blob2};
+
+  this->InitReshapableNet();
+  EXPECT_EQ(5, this->net_->inference_shapes());
+  shared_ptr<Blob<Dtype> > input_blob = this->net_->blob_by_name("data");
+  Blob<Dtype>* output_blob = this->net_->output_blobs()[0];
+  Blob<Dtype> outputs[2];
+  for (int i = 0; i < 2; ++i) {
+    input_blob->ReshapeLike(*blobs[i]);
+    input_blob->CopyFrom(*blobs[i]);
+    this->net_->Reshape();
+    this->net_->Forward();
+    outputs[i].CopyFrom(*output_blob, false, true);
+  }
+
+  shared_ptr<Net<Dtype> > clones[2];
+  for (int pass = 0; pass < 3; ++pass) {
+    for (int i = 0; i < 2; ++i) {
+      vector<vector<int> > shapes(1, blobs[i]->shape());
+      shared_ptr<Net<Dtype> > clone =
+          this->net_->InferenceNetForShapes(shapes);
+      if (pass == 0) {
+        clones[i] = clone;
+      }
+      EXPECT_EQ(clones[i].get(), clone.get());
+      EXPECT_TRUE(clone->inference_only());
+      EXPECT_EQ(this->net_->params()[0]->cpu_data(),
+                clone->params()[0]->cpu_data());
+      // The clone is already set up for its shape.
+      for (int j = 1; j < clone->layers().size(); ++j) {
+        EXPECT_FALSE(clone->layers()[j]->ReshapeIfChanged(
+            clone->bottom_vecs()[j], clone->top_vecs()[j]))
+            << clone->layer_names()[j];
+      }
+      clone->input_blobs()[0]->CopyFrom(*blobs[i]);
+      clone->Forward();
+      const Blob<Dtype>& clone_output = *clone->output_blobs()[0];
+      ASSERT_EQ(outputs[i].shape(), clone_output.shape());
+      for (int j = 0; j < outputs[i].count(); ++j) {
+        EXPECT_FLOAT_EQ(outputs[i].cpu_data()[j], clone_output.cpu_data()[j]);
+      }
+    }
+  }
+  EXPECT_NE(clones[0].get(), clones[1].get());
+
+  // Three more shapes fill the cache; after using the second shape again, a
+  // sixth drops the least recently used, the first.
+  vector<vector<int> > shapes(1, blob1.shape());
+  for (int i = 0; i < 3; ++i) {
+    shapes[0][0] = 5 + i;
+    this->net_->InferenceNetForShapes(shapes);
+  }
+  shapes[0] = blob2.shape();
+  EXPECT_EQ(clones[1].get(), this->net_->InferenceNetForShapes(shapes).get());
+  shapes[0][0] = 8;
+  this->net_->InferenceNetForShapes(shapes);
+  shapes[0] = blob2.shape();
+  EXPECT_EQ(clones[1].get(), this->net_->InferenceNetForShapes(shapes).get());
+  shapes[0] = blob1.shape();
+  EXPECT_NE(clones[0].get(), this->net_->InferenceNetForShapes(shapes).get());
+  // Keeping no shapes keeps no clones.
+  this->net_->set_inference_shapes(0);
+  shapes[0] = blob2.shape();
+  EXPECT_NE(clones[1].get(), this->net_->InferenceNetForShapes(shapes).get());
+  EXPECT_NE(this->net_->InferenceNetForShapes(shapes).get(),
+            this->net_->InferenceNetForShapes(shapes).get());
+}
+
+TYPED_TEST(NetTest, TestMemoryFootprint) {
+  typedef typename TypeParam::Dtype Dtype;
+  this->InitReshapableNet();
+  vector<typename Net<Dtype>::LayerMemory> footprint =
+      this->net_->MemoryFootprint();
+  ASSERT_EQ(6, footprint.size());
+  const size_t kInput = 3 * 100 * 100 * sizeof(Dtype);
+  const size_t kConv = 5 * 49 * 49 * sizeof(Dtype);
+  const size_t kPool = 5 * 25 * 25 * sizeof(Dtype);
+  // data
+  EXPECT_EQ(CaffeHostBytes(kInput), footprint[0].activation_bytes);
+  EXPECT_EQ(CaffeHostBytes(kInput), footprint[0].diff_bytes);
+  EXPECT_EQ(0, footprint[0].param_bytes);
+  EXPECT_EQ(0, footprint[0].workspace_bytes);
+  // conv1, with the columns of one image and the bias multiplier
+  const size_t conv_params = CaffeHostBytes(5 * 3 * 3 * 3 * sizeof(Dtype)) +
+      CaffeHostBytes(5 * sizeof(Dtype));
+  EXPECT_EQ(CaffeHostBytes(kConv), footprint[1].activation_bytes);
+  EXPECT_EQ(conv_params, footprint[1].param_bytes);
+  EXPECT_EQ(CaffeHostBytes(kConv) + conv_params, footprint[1].diff_bytes);
+  const size_t conv_workspace =
+      CaffeHostBytes(3 * 3 * 3 * 49 * 49 * sizeof(Dtype)) +
+      CaffeHostBytes(49 * 49 * sizeof(Dtype));
+  EXPECT_EQ(conv_workspace, footprint[1].workspace_bytes);
+  // relu1, in place
+  EXPECT_EQ(0, footprint[2].activation_bytes);
+  EXPECT_EQ(0, footprint[2].diff_bytes);
+  // pool1, with its mask
+  EXPECT_EQ(CaffeHostBytes(kPool), footprint[3].activation_bytes);
+  const size_t pool_workspace = CaffeHostBytes(5 * 25 * 25 * sizeof(int));
+  EXPECT_EQ(pool_workspace, footprint[3].workspace_bytes);
+  // norm1, with its scale
+  EXPECT_EQ(CaffeHostBytes(kPool), footprint[4].activation_bytes);
+  EXPECT_EQ(CaffeHostBytes(kPool), footprint[4].workspace_bytes);
+  // softmax
+  EXPECT_EQ(CaffeHostBytes(kPool), footprint[5].activation_bytes);
+  EXPECT_EQ(CaffeHostBytes(kPool), footprint[5].diff_bytes);
+
+  // The blobs keep their capacity when the input shrinks.
+  shared_ptr<Blob<Dtype> > input_blob = this->net_->blob_by_name("data");
+  input_blob->Reshape(1, 3, 50, 50);
+  this->net_->Reshape();
+  footprint = this->net_->MemoryFootprint();
+  EXPECT_EQ(CaffeHostBytes(kInput), footprint[0].activation_bytes);
+  EXPECT_EQ(CaffeHostBytes(kConv), footprint[1].activation_bytes);
+  // So do the buffers of the layers.
+  EXPECT_EQ(conv_workspace, footprint[1].workspace_bytes);
+  EXPECT_EQ(pool_workspace, footprint[3].workspace_bytes);
+  EXPECT_EQ(CaffeHostBytes(kPool), footprint[4].workspace_bytes);
+}
+
 TYPED_TEST(NetTest, TestSkipPropagateDown) {
   // check bottom_need_backward if propagate_down is true
   this->InitSkipPropNet(false);
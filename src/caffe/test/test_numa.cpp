@@ -0,0 +1,159 @@
+#include <boost/thread.hpp>
+#include <sched.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/numa.hpp"
+#include "caffe/util/task_scheduler.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+// Records the NUMA node and the CPU of the threads running tasks.
+struct RecordNumaNode {
+  boost::mutex* mutex;
+  vector<int>* nodes;
+  vector<int>* cpus;
+  void operator()(int task) const {
+    boost::mutex::scoped_lock lock(*mutex);
+    nodes->push_back(Caffe::numa_node());
+    cpus->push_back(sched_getcpu());
+  }
+};
+
+class NumaTest : public ::testing::Test {
+ protected:
+  virtual void TearDown() {
+    Caffe::SetNumaNode(-1);
+  }
+
+  // Whether the system lets the thread bind to node 0, as containers may
+  // not.
+  bool CanBind() {
+    if (!caffe_numa_bind_thread(0, true)) {
+      LOG(ERROR) << "Skipping test: NUMA binding not permitted";
+      return false;
+    }
+    return true;
+  }
+
+  bool OnNode(int cpu, int node) {
+    const vector<int> cpus = caffe_numa_node_cpus(node);
+    return std::find(cpus.begin(), cpus.end(), cpu) != cpus.end();
+  }
+};
+
+TEST_F(NumaTest, TestTopology) {
+  ASSERT_GE(caffe_numa_nodes(), 1);
+  for (int node = 0; node < caffe_numa_nodes(); ++node) {
+    const vector<int> cpus = caffe_numa_node_cpus(node);
+    for (int i = 1; i < cpus.size(); ++i) {
+      EXPECT_LT(cpus[i - 1], cpus[i]);
+    }
+  }
+}
+
+TEST_F(NumaTest, TestBindThread) {
+  if (!CanBind()) {
+    return;
+  }
+  Caffe::SetNumaNode(0);
+  EXPECT_EQ(0, Caffe::numa_node());
+  EXPECT_TRUE(Caffe::numa_pinned());
+  EXPECT_TRUE(OnNode(sched_getcpu(), 0));
+  Caffe::SetNumaNode(-1);
+  EXPECT_EQ(-1, Caffe::numa_node());
+  EXPECT_FALSE(Caffe::numa_pinned());
+}
+
+TEST_F(NumaTest, TestBlobMemory) {
+  if (!CanBind() || caffe_numa_memory_node(this) < 0) {
+    return;
+  }
+  Caffe::set_mode(Caffe::CPU);
+  Caffe::SetNumaNode(0, false);
+  EXPECT_FALSE(Caffe::numa_pinned());
+  Blob<float> blob(1, 1, 1024, 1024);
+  const float* data = blob.cpu_data();
+  for (int i = 0; i < blob.count(); i += 4096) {
+    EXPECT_EQ(0, caffe_numa_memory_node(data + i));
+  }
+}
+
+TEST_F(NumaTest, TestWorkersInherit) {
+  if (!CanBind()) {
+    return;
+  }
+  Caffe::SetNumaNode(0);
+  TaskScheduler scheduler(3);
+  const int kTasks = 30;
+  vector<vector<int> > dependents(kTasks);
+  vector<int> dependencies(kTasks, 0);
+  boost::mutex mutex;
+  vector<int> nodes, cpus;
+  RecordNumaNode record;
+  record.mutex = &mutex;
+  record.nodes = &nodes;
+  record.cpus = &cpus;
+  scheduler.Run(dependents, dependencies, record);
+  ASSERT_EQ(kTasks, nodes.size());
+  for (int i = 0; i < kTasks; ++i) {
+    EXPECT_EQ(0, nodes[i]);
+    EXPECT_TRUE(OnNode(cpus[i], 0));
+  }
+}
+
+TEST_F(NumaTest, TestNetNode) {
+  const string proto =
+      "numa_node: 0 "
+      "layer { "
+      "  name: 'data' "
+      "  type: 'Input' "
+      "  input_param { shape { dim: 2 dim: 10 } } "
+      "  top: 'data' "
+      "} "
+      "layer { "
+      "  name: 'innerproduct' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { num_output: 5 } "
+      "  bottom: 'data' "
+      "  top: 'innerproduct' "
+      "} ";
+  NetParameter param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+  Caffe::set_mode(Caffe::CPU);
+  const bool bound = CanBind() && caffe_numa_memory_node(this) >= 0;
+  cpu_set_t cpus;
+  if (bound) {
+    Caffe::SetNumaNode(-1);
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(cpus), &cpus));
+    // Cached blocks keep the node they were first bound to.
+    Caffe::host_allocator()->EmptyCache();
+  }
+  Net<float> net(param);
+  EXPECT_EQ(0, net.numa_node());
+  // The net binds the thread while running only.
+  EXPECT_EQ(-1, Caffe::numa_node());
+  net.Forward();
+  EXPECT_EQ(-1, Caffe::numa_node());
+  if (bound) {
+    cpu_set_t after;
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(after), &after));
+    EXPECT_TRUE(CPU_EQUAL(&cpus, &after));
+    EXPECT_EQ(0, caffe_numa_memory_node(
+        net.blob_by_name("innerproduct")->cpu_data()));
+    EXPECT_EQ(0, caffe_numa_memory_node(
+        net.layer_by_name("innerproduct")->blobs()[0]->cpu_data()));
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,68 @@
+#include <boost/thread.hpp>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/util/parallel_for.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+// Counts the calls covering each element.
+struct CountCalls {
+  int* counts;
+  void operator()(int begin, int end) const {
+    for (int i = begin; i < end; ++i) {
+      ++counts[i];
+    }
+  }
+};
+
+class ParallelForTest : public ::testing::Test {
+ protected:
+  static void TestCoverage(int n, int grain) {
+    std::vector<int> counts(n + 1, 0);
+    CountCalls f;
+    f.counts = &counts[0];
+    caffe_cpu_parallel_for(n, grain, f);
+    for (int i = 0; i < n; ++i) {
+      EXPECT_EQ(1, counts[i]) << "element " << i;
+    }
+    EXPECT_EQ(0, counts[n]);
+  }
+};
+
+TEST_F(ParallelForTest, TestEmpty) {
+  this->TestCoverage(0, 16);
+}
+
+TEST_F(ParallelForTest, TestSmall) {
+  this->TestCoverage(10, 16);
+}
+
+TEST_F(ParallelForTest, TestLarge) {
+  this->TestCoverage(100003, 16);
+}
+
+TEST_F(ParallelForTest, TestGrainOne) {
+  this->TestCoverage(7, 1);
+}
+
+TEST_F(ParallelForTest, TestRepeated) {
+  for (int i = 0; i < 100; ++i) {
+    this->TestCoverage(100003, 16);
+  }
+}
+
+TEST_F(ParallelForTest, TestConcurrentCallers) {
+  boost::thread_group callers;
+  for (int i = 0; i < 4; ++i) {
+    callers.create_thread(boost::bind(&ParallelForTest::TestCoverage, 100003,
+        16));
+  }
+  callers.join_all();
+}
+
+}  // namespace caffe
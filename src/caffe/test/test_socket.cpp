@@ -0,0 +1,90 @@
+#include <boost/thread.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/util/io.hpp"
+#include "caffe/util/socket.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class SocketRingTest : public ::testing::Test {
+ protected:
+  SocketRingTest() {
+    MakeTempDir(&dir_);
+  }
+
+  // Runs a ring of size members on as many threads, each one summing a
+  // buffer of count elements and receiving a broadcast.
+  void TestRing(int size, size_t count) {
+    vector<string> addresses;
+    for (int i = 0; i < size; ++i) {
+      std::ostringstream address;
+      address << "unix:" << dir_ << "/ring" << i;
+      addresses.push_back(address.str());
+    }
+    results_.assign(size, vector<Dtype>());
+    broadcasts_.assign(size, vector<Dtype>());
+    boost::thread_group members;
+    for (int i = 0; i < size; ++i) {
+      members.create_thread(boost::bind(&SocketRingTest::Member, this,
+          addresses, i, count));
+    }
+    members.join_all();
+    for (int r = 0; r < size; ++r) {
+      ASSERT_EQ(count, results_[r].size());
+      for (size_t i = 0; i < count; ++i) {
+        // Sum over ranks of rank * count + i
+        const Dtype expected = size * (size - 1) / 2 * count + size * i;
+        EXPECT_EQ(expected, results_[r][i]) << "rank " << r << " at " << i;
+        EXPECT_EQ(Dtype(i), broadcasts_[r][i]) << "rank " << r << " at " << i;
+      }
+    }
+  }
+
+  void Member(const vector<string>& addresses, int rank, size_t count) {
+    SocketRing<Dtype> ring(addresses, rank);
+    EXPECT_EQ(rank, ring.rank());
+    EXPECT_EQ(addresses.size(), ring.size());
+    vector<Dtype>& buffer = results_[rank];
+    for (size_t i = 0; i < count; ++i) {
+      buffer.push_back(rank * count + i);
+    }
+    ring.AllReduce(count ? &buffer[0] : NULL, count);
+    vector<Dtype>& broadcast = broadcasts_[rank];
+    for (size_t i = 0; i < count; ++i) {
+      broadcast.push_back(rank == 0 ? i : -1);
+    }
+    ring.Broadcast(count ? &broadcast[0] : NULL, count);
+  }
+
+  string dir_;
+  vector<vector<Dtype> > results_;
+  vector<vector<Dtype> > broadcasts_;
+};
+
+TYPED_TEST_CASE(SocketRingTest, TestDtypes);
+
+TYPED_TEST(SocketRingTest, TestSingle) {
+  this->TestRing(1, 10);
+}
+
+TYPED_TEST(SocketRingTest, TestPair) {
+  this->TestRing(2, 10);
+}
+
+TYPED_TEST(SocketRingTest, TestSmallerThanRing) {
+  this->TestRing(4, 3);
+}
+
+TYPED_TEST(SocketRingTest, TestPipelined) {
+  // Several pieces per segment.
+  this->TestRing(3, 300001);
+}
+
+}  // namespace caffe
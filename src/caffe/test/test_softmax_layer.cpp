@@ -83,6 +83,23 @@ TYPED_TEST(SoftmaxLayerTest, TestGradient) {
       this->blob_top_vec_);
 }
 
+TYPED_TEST(SoftmaxLayerTest, TestForwardBeyondInt) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Softmax indexes its blobs with int, so it fails on a bottom of more than
+  // INT_MAX elements, before allocating them.
+  vector<int> shape(3);
+  shape[0] = 1 << 16;
+  shape[1] = 2;
+  shape[2] = 1 << 15;
+  this->blob_bottom_->Reshape(shape);
+  LayerParameter layer_param;
+  SoftmaxLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  EXPECT_DEATH(layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_),
+      "INT_MAX");
+}
+
 #ifdef USE_CUDNN
 template <typename Dtype>
 class CuDNNSoftmaxLayerTest : public GPUDeviceTest<Dtype> {
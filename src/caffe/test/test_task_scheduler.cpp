@@ -0,0 +1,74 @@
+#include <boost/thread.hpp>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/util/task_scheduler.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+// Records the order in which tasks run.
+struct RecordTasks {
+  boost::mutex* mutex;
+  vector<int>* order;
+  void operator()(int task) const {
+    boost::mutex::scoped_lock lock(*mutex);
+    order->push_back(task);
+  }
+};
+
+class TaskSchedulerTest : public ::testing::Test {
+ protected:
+  // Runs a graph where task i > 0 depends on tasks i / 2 and i / 3, and
+  // checks that each task runs once, after its dependencies.
+  void TestGraph(int threads, int num_tasks) {
+    vector<vector<int> > dependents(num_tasks);
+    vector<int> dependencies(num_tasks, 0);
+    for (int i = 1; i < num_tasks; ++i) {
+      dependents[i / 2].push_back(i);
+      ++dependencies[i];
+      if (i / 3 != i / 2) {
+        dependents[i / 3].push_back(i);
+        ++dependencies[i];
+      }
+    }
+    TaskScheduler scheduler(threads);
+    EXPECT_EQ(threads, scheduler.threads());
+    for (int run = 0; run < 3; ++run) {
+      boost::mutex mutex;
+      vector<int> order;
+      RecordTasks record;
+      record.mutex = &mutex;
+      record.order = &order;
+      scheduler.Run(dependents, dependencies, record);
+      ASSERT_EQ(num_tasks, order.size());
+      vector<int> positions(num_tasks, -1);
+      for (int i = 0; i < num_tasks; ++i) {
+        EXPECT_EQ(-1, positions[order[i]]) << "task " << order[i];
+        positions[order[i]] = i;
+      }
+      for (int i = 0; i < num_tasks; ++i) {
+        for (int j = 0; j < dependents[i].size(); ++j) {
+          EXPECT_LT(positions[i], positions[dependents[i][j]]);
+        }
+      }
+    }
+  }
+};
+
+TEST_F(TaskSchedulerTest, TestEmpty) {
+  this->TestGraph(4, 0);
+}
+
+TEST_F(TaskSchedulerTest, TestSingleThread) {
+  this->TestGraph(1, 100);
+}
+
+TEST_F(TaskSchedulerTest, TestThreads) {
+  this->TestGraph(4, 1000);
+}
+
+}  // namespace caffe
@@ -0,0 +1,154 @@
+#ifdef USE_OPENCV
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "opencv2/core/core.hpp"
+#include "opencv2/highgui/highgui.hpp"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layers/window_data_layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/io.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class WindowDataLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  WindowDataLayerTest()
+      : seed_(1701),
+        blob_top_data_(new Blob<Dtype>()),
+        blob_top_label_(new Blob<Dtype>()) {}
+  virtual void SetUp() {
+    blob_top_vec_.push_back(blob_top_data_);
+    blob_top_vec_.push_back(blob_top_label_);
+    // Two images of a single gray level, and a third one missing. The
+    // foreground windows of image i have label i + 1, so that the label of
+    // an item tells the gray level of its window.
+    MakeTempDir(&folder_);
+    const string images[3] = {"dark.png", "light.png", "missing.png"};
+    for (int i = 0; i < 2; ++i) {
+      cv::Mat image(20, 30, CV_8UC3, cv::Scalar::all(kLevels[i]));
+      CHECK(cv::imwrite(folder_ + "/" + images[i], image));
+    }
+    MakeTempFilename(&filename_);
+    std::ofstream outfile(filename_.c_str(), std::ofstream::out);
+    for (int i = 0; i < 3; ++i) {
+      outfile << "# " << i << "\n" << images[i] << "\n3\n20\n30\n2\n"
+          << i + 1 << " 0.9 2 3 12 15\n"
+          << "0 0.1 0 0 29 19\n";
+    }
+    outfile.close();
+  }
+
+  virtual ~WindowDataLayerTest() {
+    delete blob_top_data_;
+    delete blob_top_label_;
+  }
+
+  // Reads batches of 12 windows with the given number of threads.
+  void ReadBatches(int threads, int batches, vector<Dtype>* data,
+      vector<Dtype>* labels) {
+    Caffe::set_random_seed(seed_);
+    LayerParameter param;
+    param.mutable_transform_param()->set_crop_size(8);
+    WindowDataParameter* window_data_param =
+        param.mutable_window_data_param();
+    window_data_param->set_source(filename_);
+    window_data_param->set_root_folder(folder_ + "/");
+    window_data_param->set_batch_size(12);
+    window_data_param->set_fg_threshold(0.5);
+    window_data_param->set_bg_threshold(0.5);
+    window_data_param->set_fg_fraction(0.5);
+    window_data_param->set_threads(threads);
+    WindowDataLayer<Dtype> layer(param);
+    layer.SetUp(blob_bottom_vec_, blob_top_vec_);
+    EXPECT_EQ(12, blob_top_data_->num());
+    EXPECT_EQ(3, blob_top_data_->channels());
+    EXPECT_EQ(8, blob_top_data_->height());
+    EXPECT_EQ(8, blob_top_data_->width());
+    for (int i = 0; i < batches; ++i) {
+      layer.Forward(blob_bottom_vec_, blob_top_vec_);
+      data->insert(data->end(), blob_top_data_->cpu_data(),
+          blob_top_data_->cpu_data() + blob_top_data_->count());
+      labels->insert(labels->end(), blob_top_label_->cpu_data(),
+          blob_top_label_->cpu_data() + blob_top_label_->count());
+    }
+  }
+
+  // Checks that each window holds the gray level of its image, or zeros if
+  // the image could not be read, and returns how many did not.
+  int CheckWindows(const vector<Dtype>& data, const vector<Dtype>& labels) {
+    const int dim = 3 * 8 * 8;
+    int unread = 0;
+    for (int i = 0; i < labels.size(); ++i) {
+      const int label = labels[i];
+      const Dtype level = data[i * dim];
+      if (label == 1 || label == 2) {
+        EXPECT_EQ(kLevels[label - 1], level);
+      } else if (label == 3) {
+        EXPECT_EQ(0, level);
+      } else {
+        EXPECT_EQ(0, label);
+        EXPECT_TRUE(level == kLevels[0] || level == kLevels[1] || level == 0)
+            << level;
+      }
+      unread += level == 0;
+      for (int j = 1; j < dim; ++j) {
+        EXPECT_EQ(level, data[i * dim + j]);
+      }
+    }
+    return unread;
+  }
+
+  static const int kLevels[2];
+  int seed_;
+  string folder_;
+  string filename_;
+  Blob<Dtype>* const blob_top_data_;
+  Blob<Dtype>* const blob_top_label_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+template <typename TypeParam>
+const int WindowDataLayerTest<TypeParam>::kLevels[2] = {40, 200};
+
+TYPED_TEST_CASE(WindowDataLayerTest, TestDtypesAndDevices);
+
+TYPED_TEST(WindowDataLayerTest, TestRead) {
+  typedef typename TypeParam::Dtype Dtype;
+  vector<Dtype> data, labels;
+  this->ReadBatches(1, 5, &data, &labels);
+  ASSERT_EQ(5 * 12, labels.size());
+  // Windows of the missing image are left zero.
+  EXPECT_GT(this->CheckWindows(data, labels), 0);
+  for (int i = 0; i < labels.size(); i += 12) {
+    for (int j = 0; j < 6; ++j) {
+      EXPECT_EQ(0, labels[i + j]);
+      EXPECT_GT(labels[i + 6 + j], 0);
+    }
+  }
+}
+
+TYPED_TEST(WindowDataLayerTest, TestReadThreads) {
+  typedef typename TypeParam::Dtype Dtype;
+  vector<Dtype> data, labels;
+  this->ReadBatches(1, 5, &data, &labels);
+  vector<Dtype> threads_data, threads_labels;
+  this->ReadBatches(3, 5, &threads_data, &threads_labels);
+  this->CheckWindows(threads_data, threads_labels);
+  // The batches do not depend on the number of threads.
+  EXPECT_TRUE(labels == threads_labels);
+  EXPECT_TRUE(data == threads_data);
+}
+
+}  // namespace caffe
+#endif  // USE_OPENCV
@@ -0,0 +1,162 @@
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/half.hpp"
+
+namespace caffe {
+
+// The rows of row_size elements in a block, of at most rows.
+static int BlockRows(int rows, int row_size) {
+  return std::max(1, std::min(rows, kHalfBlockSize / std::max(row_size, 1)));
+}
+
+static inline uint16_t FloatToHalf(float value) {
+  const uint32_t kInfinity = 255u << 23;
+  // 2^16, the least float rounding to infinity as half is 65520.
+  const uint32_t kHalfOverflow = (127u + 16) << 23;
+  // 0.5, adding which rounds subnormal halves into the low mantissa bits.
+  const uint32_t kDenormMagic = ((127u - 15) + (23 - 10) + 1) << 23;
+  uint32_t x;
+  memcpy(&x, &value, sizeof(x));
+  const uint32_t sign = x & 0x80000000u;
+  x ^= sign;
+  uint16_t half;
+  if (x >= kHalfOverflow) {
+    half = x > kInfinity ? 0x7e00 : 0x7c00;
+  } else if (x < (113u << 23)) {
+    float magic, sum;
+    memcpy(&magic, &kDenormMagic, sizeof(magic));
+    memcpy(&sum, &x, sizeof(sum));
+    sum += magic;
+    memcpy(&x, &sum, sizeof(x));
+    half = x - kDenormMagic;
+  } else {
+    const uint32_t odd = (x >> 13) & 1;
+    // Rebias the exponent and round the mantissa to the nearest even.
+    x += ((15u - 127) << 23) + 0xfff + odd;
+    half = x >> 13;
+  }
+  return half | (sign >> 16);
+}
+
+static inline float HalfToFloat(uint16_t half) {
+  const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+  const uint32_t exponent = (half >> 10) & 0x1f;
+  const uint32_t mantissa = half & 0x3ff;
+  uint32_t x;
+  if (exponent == 0x1f) {
+    x = sign | 0x7f800000u | (mantissa << 13);
+  } else if (exponent != 0) {
+    x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+  } else {
+    const float value = mantissa * (1.f / (1 << 24));
+    return sign ? -value : value;
+  }
+  float value;
+  memcpy(&value, &x, sizeof(value));
+  return value;
+}
+
+template <>
+void caffe_cpu_to_half<float>(const int64_t n, const float* x, uint16_t* y) {
+  int64_t i = 0;
+#ifdef __F16C__
+  for (; i + 8 <= n; i += 8) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y + i),
+        _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT));
+  }
+#endif
+  for (; i < n; ++i) {
+    y[i] = FloatToHalf(x[i]);
+  }
+}
+
+template <>
+void caffe_cpu_to_half<double>(const int64_t n, const double* x, uint16_t* y) {
+  for (int64_t i = 0; i < n; ++i) {
+    y[i] = FloatToHalf(static_cast<float>(x[i]));
+  }
+}
+
+template <>
+void caffe_cpu_from_half<float>(const int64_t n, const uint16_t* x, float* y) {
+  int64_t i = 0;
+#ifdef __F16C__
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(y + i, _mm256_cvtph_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i))));
+  }
+#endif
+  for (; i < n; ++i) {
+    y[i] = HalfToFloat(x[i]);
+  }
+}
+
+template <>
+void caffe_cpu_from_half<double>(const int64_t n, const uint16_t* x,
+    double* y) {
+  for (int64_t i = 0; i < n; ++i) {
+    y[i] = HalfToFloat(x[i]);
+  }
+}
+
+// cblas gemm on row major matrices with leading dimensions.
+static inline void Gemm(const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
+    const float alpha, const float* A, const int lda, const float* B,
+    const int ldb, const float beta, float* C, const int ldc) {
+  cblas_sgemm(CblasRowMajor, TransA, TransB, M, N, K, alpha, A, lda, B, ldb,
+      beta, C, ldc);
+}
+
+static inline void Gemm(const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
+    const double alpha, const double* A, const int lda, const double* B,
+    const int ldb, const double beta, double* C, const int ldc) {
+  cblas_dgemm(CblasRowMajor, TransA, TransB, M, N, K, alpha, A, lda, B, ldb,
+      beta, C, ldc);
+}
+
+template <typename Dtype>
+void caffe_cpu_gemm_half_b(const CBLAS_TRANSPOSE TransB, const int M,
+    const int N, const int K, const Dtype alpha, const Dtype* A,
+    const uint16_t* B, const Dtype beta, Dtype* C) {
+  if (TransB == CblasTrans) {
+    // B is N x K: a block of its rows gives a block of columns of C.
+    const int rows = BlockRows(N, K);
+    vector<Dtype> block(rows * K);
+    for (int n = 0; n < N; n += rows) {
+      const int block_rows = std::min(rows, N - n);
+      caffe_cpu_from_half(block_rows * K,
+          B + static_cast<int64_t>(n) * K, &block[0]);
+      Gemm(CblasNoTrans, CblasTrans, M, block_rows, K, alpha, A, K,
+          &block[0], K, beta, C + n, N);
+    }
+  } else {
+    // B is K x N: a block of its rows adds to all of C.
+    const int rows = BlockRows(K, N);
+    vector<Dtype> block(rows * N);
+    for (int k = 0; k < K; k += rows) {
+      const int block_rows = std::min(rows, K - k);
+      caffe_cpu_from_half(block_rows * N,
+          B + static_cast<int64_t>(k) * N, &block[0]);
+      Gemm(CblasNoTrans, CblasNoTrans, M, N, block_rows, alpha, A + k, K,
+          &block[0], N, k == 0 ? beta : Dtype(1), C, N);
+    }
+  }
+}
+
+template void caffe_cpu_gemm_half_b<float>(const CBLAS_TRANSPOSE TransB,
+    const int M, const int N, const int K, const float alpha, const float* A,
+    const uint16_t* B, const float beta, float* C);
+template void caffe_cpu_gemm_half_b<double>(const CBLAS_TRANSPOSE TransB,
+    const int M, const int N, const int K, const double alpha,
+    const double* A, const uint16_t* B, const double beta, double* C);
+
+}  // namespace caffe
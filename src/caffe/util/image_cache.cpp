@@ -0,0 +1,99 @@
+#ifdef USE_OPENCV
+#include <boost/thread.hpp>
+#include <opencv2/core/core.hpp>
+
+#include <map>
+#include <string>
+
+#include "caffe/util/image_cache.hpp"
+
+namespace caffe {
+
+using boost::weak_ptr;
+
+class ImageCache::sync {
+ public:
+  mutable boost::mutex mutex_;
+};
+
+static map<const string, weak_ptr<ImageCache> > shared_caches_;
+static boost::mutex shared_caches_mutex_;
+
+ImageCache::ImageCache(size_t capacity)
+    : capacity_(capacity), size_(0), hits_(0), misses_(0),
+      sync_(new sync()) {
+}
+
+ImageCache::~ImageCache() {
+  if (hits_ + misses_ > 0) {
+    DLOG(INFO) << "Image cache: " << hits_ << " hits, " << misses_
+        << " misses, " << size_ << " bytes in " << lru_.size() << " images.";
+  }
+}
+
+shared_ptr<ImageCache> ImageCache::GetShared(const string& key,
+    size_t capacity) {
+  boost::mutex::scoped_lock lock(shared_caches_mutex_);
+  weak_ptr<ImageCache>& weak = shared_caches_[key];
+  shared_ptr<ImageCache> cache = weak.lock();
+  if (!cache) {
+    cache.reset(new ImageCache(capacity));
+    weak = cache;
+  } else if (cache->capacity() != capacity) {
+    LOG(WARNING) << "Image cache " << key << " is shared with a capacity of "
+        << cache->capacity() << " bytes, ignoring " << capacity << " bytes.";
+  }
+  return cache;
+}
+
+bool ImageCache::Lookup(const string& filename, cv::Mat* image) {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  map<string, LRUList::iterator>::iterator it = index_.find(filename);
+  if (it == index_.end()) {
+    ++misses_;
+    return false;
+  }
+  // Move the entry to the front, iterators stay valid.
+  lru_.splice(lru_.begin(), lru_, it->second);
+  *image = it->second->second;
+  ++hits_;
+  return true;
+}
+
+void ImageCache::Insert(const string& filename, const cv::Mat& image) {
+  const size_t bytes = ImageBytes(image);
+  if (bytes > capacity_) {
+    return;
+  }
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  if (index_.count(filename)) {
+    // Another thread decoded the same image concurrently.
+    return;
+  }
+  while (size_ + bytes > capacity_) {
+    size_ -= ImageBytes(lru_.back().second);
+    index_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+  lru_.push_front(std::make_pair(filename, image));
+  index_[filename] = lru_.begin();
+  size_ += bytes;
+}
+
+size_t ImageCache::size() const {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  return size_;
+}
+
+size_t ImageCache::hits() const {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  return hits_;
+}
+
+size_t ImageCache::misses() const {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  return misses_;
+}
+
+}  // namespace caffe
+#endif  // USE_OPENCV
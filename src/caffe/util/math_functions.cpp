@@ -1,6 +1,8 @@
 #include <boost/math/special_functions/next.hpp>
 #include <boost/random.hpp>
 
+#include <algorithm>
+#include <climits>
 #include <limits>
 
 #include "caffe/common.hpp"
@@ -9,6 +11,16 @@
 
 namespace caffe {
 
+// BLAS and the MKL vector functions take int lengths, so the level 1 and
+// element-wise routines process longer vectors by chunks of kBlasChunk
+// elements.
+static const int64_t kBlasChunk = INT_MAX;
+
+// The length of the chunk of a vector of n elements starting at offset.
+static inline int BlasLength(int64_t n, int64_t offset) {
+  return static_cast<int>(std::min(n - offset, kBlasChunk));
+}
+
 template<>
 void caffe_cpu_gemm<float>(const CBLAS_TRANSPOSE TransA,
     const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
@@ -46,44 +58,52 @@ void caffe_cpu_gemv<double>(const CBLAS_TRANSPOSE TransA, const int M,
 }
 
 template <>
-void caffe_axpy<float>(const int N, const float alpha, const float* X,
-    float* Y) { cblas_saxpy(N, alpha, X, 1, Y, 1); }
+void caffe_axpy<float>(const int64_t N, const float alpha, const float* X,
+    float* Y) {
+  for (int64_t i = 0; i < N; i += kBlasChunk) {
+    cblas_saxpy(BlasLength(N, i), alpha, X + i, 1, Y + i, 1);
+  }
+}
 
 template <>
-void caffe_axpy<double>(const int N, const double alpha, const double* X,
-    double* Y) { cblas_daxpy(N, alpha, X, 1, Y, 1); }
+void caffe_axpy<double>(const int64_t N, const double alpha, const double* X,
+    double* Y) {
+  for (int64_t i = 0; i < N; i += kBlasChunk) {
+    cblas_daxpy(BlasLength(N, i), alpha, X + i, 1, Y + i, 1);
+  }
+}
 
 template <typename Dtype>
-void caffe_set(const int N, const Dtype alpha, Dtype* Y) {
+void caffe_set(const int64_t N, const Dtype alpha, Dtype* Y) {
   if (alpha == 0) {
     memset(Y, 0, sizeof(Dtype) * N);  // NOLINT(caffe/alt_fn)
     return;
   }
-  for (int i = 0; i < N; ++i) {
+  for (int64_t i = 0; i < N; ++i) {
     Y[i] = alpha;
   }
 }
 
-template void caffe_set<int>(const int N, const int alpha, int* Y);
-template void caffe_set<float>(const int N, const float alpha, float* Y);
-template void caffe_set<double>(const int N, const double alpha, double* Y);
+template void caffe_set<int>(const int64_t N, const int alpha, int* Y);
+template void caffe_set<float>(const int64_t N, const float alpha, float* Y);
+template void caffe_set<double>(const int64_t N, const double alpha, double* Y);
 
 template <>
-void caffe_add_scalar(const int N, const float alpha, float* Y) {
-  for (int i = 0; i < N; ++i) {
+void caffe_add_scalar(const int64_t N, const float alpha, float* Y) {
+  for (int64_t i = 0; i < N; ++i) {
     Y[i] += alpha;
   }
 }
 
 template <>
-void caffe_add_scalar(const int N, const double alpha, double* Y) {
-  for (int i = 0; i < N; ++i) {
+void caffe_add_scalar(const int64_t N, const double alpha, double* Y) {
+  for (int64_t i = 0; i < N; ++i) {
     Y[i] += alpha;
   }
 }
 
 template <typename Dtype>
-void caffe_copy(const int N, const Dtype* X, Dtype* Y) {
+void caffe_copy(const int64_t N, const Dtype* X, Dtype* Y) {
   if (X != Y) {
     if (Caffe::mode() == Caffe::GPU) {
 #ifndef CPU_ONLY
@@ -98,132 +118,176 @@ void caffe_copy(const int N, const Dtype* X, Dtype* Y) {
   }
 }
 
-template void caffe_copy<int>(const int N, const int* X, int* Y);
-template void caffe_copy<unsigned int>(const int N, const unsigned int* X,
+template void caffe_copy<int>(const int64_t N, const int* X, int* Y);
+template void caffe_copy<unsigned int>(const int64_t N, const unsigned int* X,
     unsigned int* Y);
-template void caffe_copy<float>(const int N, const float* X, float* Y);
-template void caffe_copy<double>(const int N, const double* X, double* Y);
+template void caffe_copy<float>(const int64_t N, const float* X, float* Y);
+template void caffe_copy<double>(const int64_t N, const double* X, double* Y);
 
 template <>
-void caffe_scal<float>(const int N, const float alpha, float *X) {
-  cblas_sscal(N, alpha, X, 1);
+void caffe_scal<float>(const int64_t N, const float alpha, float *X) {
+  for (int64_t i = 0; i < N; i += kBlasChunk) {
+    cblas_sscal(BlasLength(N, i), alpha, X + i, 1);
+  }
 }
 
 template <>
-void caffe_scal<double>(const int N, const double alpha, double *X) {
-  cblas_dscal(N, alpha, X, 1);
+void caffe_scal<double>(const int64_t N, const double alpha, double *X) {
+  for (int64_t i = 0; i < N; i += kBlasChunk) {
+    cblas_dscal(BlasLength(N, i), alpha, X + i, 1);
+  }
 }
 
 template <>
-void caffe_cpu_axpby<float>(const int N, const float alpha, const float* X,
-                            const float beta, float* Y) {
-  cblas_saxpby(N, alpha, X, 1, beta, Y, 1);
+void caffe_cpu_axpby<float>(const int64_t N, const float alpha,
+    const float* X, const float beta, float* Y) {
+  for (int64_t i = 0; i < N; i += kBlasChunk) {
+    cblas_saxpby(BlasLength(N, i), alpha, X + i, 1, beta, Y + i, 1);
+  }
 }
 
 template <>
-void caffe_cpu_axpby<double>(const int N, const double alpha, const double* X,
-                             const double beta, double* Y) {
-  cblas_daxpby(N, alpha, X, 1, beta, Y, 1);
+void caffe_cpu_axpby<double>(const int64_t N, const double alpha,
+    const double* X, const double beta, double* Y) {
+  for (int64_t i = 0; i < N; i += kBlasChunk) {
+    cblas_daxpby(BlasLength(N, i), alpha, X + i, 1, beta, Y + i, 1);
+  }
 }
 
 template <>
-void caffe_add<float>(const int n, const float* a, const float* b,
+void caffe_add<float>(const int64_t n, const float* a, const float* b,
     float* y) {
-  vsAdd(n, a, b, y);
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vsAdd(BlasLength(n, i), a + i, b + i, y + i);
+  }
 }
 
 template <>
-void caffe_add<double>(const int n, const double* a, const double* b,
+void caffe_add<double>(const int64_t n, const double* a, const double* b,
     double* y) {
-  vdAdd(n, a, b, y);
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vdAdd(BlasLength(n, i), a + i, b + i, y + i);
+  }
 }
 
 template <>
-void caffe_sub<float>(const int n, const float* a, const float* b,
+void caffe_sub<float>(const int64_t n, const float* a, const float* b,
     float* y) {
-  vsSub(n, a, b, y);
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vsSub(BlasLength(n, i), a + i, b + i, y + i);
+  }
 }
 
 template <>
-void caffe_sub<double>(const int n, const double* a, const double* b,
+void caffe_sub<double>(const int64_t n, const double* a, const double* b,
     double* y) {
-  vdSub(n, a, b, y);
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vdSub(BlasLength(n, i), a + i, b + i, y + i);
+  }
 }
 
 template <>
-void caffe_mul<float>(const int n, const float* a, const float* b,
+void caffe_mul<float>(const int64_t n, const float* a, const float* b,
     float* y) {
-  vsMul(n, a, b, y);
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vsMul(BlasLength(n, i), a + i, b + i, y + i);
+  }
 }
 
 template <>
-void caffe_mul<double>(const int n, const double* a, const double* b,
+void caffe_mul<double>(const int64_t n, const double* a, const double* b,
     double* y) {
-  vdMul(n, a, b, y);
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vdMul(BlasLength(n, i), a + i, b + i, y + i);
+  }
 }
 
 template <>
-void caffe_div<float>(const int n, const float* a, const float* b,
+void caffe_div<float>(const int64_t n, const float* a, const float* b,
     float* y) {
-  vsDiv(n, a, b, y);
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vsDiv(BlasLength(n, i), a + i, b + i, y + i);
+  }
 }
 
 template <>
-void caffe_div<double>(const int n, const double* a, const double* b,
+void caffe_div<double>(const int64_t n, const double* a, const double* b,
     double* y) {
-  vdDiv(n, a, b, y);
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vdDiv(BlasLength(n, i), a + i, b + i, y + i);
+  }
 }
 
 template <>
-void caffe_powx<float>(const int n, const float* a, const float b,
+void caffe_powx<float>(const int64_t n, const float* a, const float b,
     float* y) {
-  vsPowx(n, a, b, y);
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vsPowx(BlasLength(n, i), a + i, b, y + i);
+  }
 }
 
 template <>
-void caffe_powx<double>(const int n, const double* a, const double b,
+void caffe_powx<double>(const int64_t n, const double* a, const double b,
     double* y) {
-  vdPowx(n, a, b, y);
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vdPowx(BlasLength(n, i), a + i, b, y + i);
+  }
 }
 
 template <>
-void caffe_sqr<float>(const int n, const float* a, float* y) {
-  vsSqr(n, a, y);
+void caffe_sqr<float>(const int64_t n, const float* a, float* y) {
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vsSqr(BlasLength(n, i), a + i, y + i);
+  }
 }
 
 template <>
-void caffe_sqr<double>(const int n, const double* a, double* y) {
-  vdSqr(n, a, y);
+void caffe_sqr<double>(const int64_t n, const double* a, double* y) {
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vdSqr(BlasLength(n, i), a + i, y + i);
+  }
 }
 
 template <>
-void caffe_exp<float>(const int n, const float* a, float* y) {
-  vsExp(n, a, y);
+void caffe_exp<float>(const int64_t n, const float* a, float* y) {
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vsExp(BlasLength(n, i), a + i, y + i);
+  }
 }
 
 template <>
-void caffe_exp<double>(const int n, const double* a, double* y) {
-  vdExp(n, a, y);
+void caffe_exp<double>(const int64_t n, const double* a, double* y) {
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vdExp(BlasLength(n, i), a + i, y + i);
+  }
 }
 
 template <>
-void caffe_log<float>(const int n, const float* a, float* y) {
-  vsLn(n, a, y);
+void caffe_log<float>(const int64_t n, const float* a, float* y) {
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vsLn(BlasLength(n, i), a + i, y + i);
+  }
 }
 
 template <>
-void caffe_log<double>(const int n, const double* a, double* y) {
-  vdLn(n, a, y);
+void caffe_log<double>(const int64_t n, const double* a, double* y) {
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vdLn(BlasLength(n, i), a + i, y + i);
+  }
 }
 
 template <>
-void caffe_abs<float>(const int n, const float* a, float* y) {
-    vsAbs(n, a, y);
+void caffe_abs<float>(const int64_t n, const float* a, float* y) {
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vsAbs(BlasLength(n, i), a + i, y + i);
+  }
 }
 
 template <>
-void caffe_abs<double>(const int n, const double* a, double* y) {
-    vdAbs(n, a, y);
+void caffe_abs<double>(const int64_t n, const double* a, double* y) {
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    vdAbs(BlasLength(n, i), a + i, y + i);
+  }
 }
 
 unsigned int caffe_rng_rand() {
@@ -243,28 +307,29 @@ template
 double caffe_nextafter(const double b);
 
 template <typename Dtype>
-void caffe_rng_uniform(const int n, const Dtype a, const Dtype b, Dtype* r) {
+void caffe_rng_uniform(const int64_t n, const Dtype a, const Dtype b,
+    Dtype* r) {
   CHECK_GE(n, 0);
   CHECK(r);
   CHECK_LE(a, b);
   boost::uniform_real<Dtype> random_distribution(a, caffe_nextafter<Dtype>(b));
   boost::variate_generator<caffe::rng_t*, boost::uniform_real<Dtype> >
       variate_generator(caffe_rng(), random_distribution);
-  for (int i = 0; i < n; ++i) {
+  for (int64_t i = 0; i < n; ++i) {
     r[i] = variate_generator();
   }
 }
 
 template
-void caffe_rng_uniform<float>(const int n, const float a, const float b,
+void caffe_rng_uniform<float>(const int64_t n, const float a, const float b,
                               float* r);
 
 template
-void caffe_rng_uniform<double>(const int n, const double a, const double b,
+void caffe_rng_uniform<double>(const int64_t n, const double a, const double b,
                                double* r);
 
 template <typename Dtype>
-void caffe_rng_gaussian(const int n, const Dtype a,
+void caffe_rng_gaussian(const int64_t n, const Dtype a,
                         const Dtype sigma, Dtype* r) {
   CHECK_GE(n, 0);
   CHECK(r);
@@ -272,21 +337,21 @@ void caffe_rng_gaussian(const int n, const Dtype a,
   boost::normal_distribution<Dtype> random_distribution(a, sigma);
   boost::variate_generator<caffe::rng_t*, boost::normal_distribution<Dtype> >
       variate_generator(caffe_rng(), random_distribution);
-  for (int i = 0; i < n; ++i) {
+  for (int64_t i = 0; i < n; ++i) {
     r[i] = variate_generator();
   }
 }
 
 template
-void caffe_rng_gaussian<float>(const int n, const float mu,
+void caffe_rng_gaussian<float>(const int64_t n, const float mu,
                                const float sigma, float* r);
 
 template
-void caffe_rng_gaussian<double>(const int n, const double mu,
+void caffe_rng_gaussian<double>(const int64_t n, const double mu,
                                 const double sigma, double* r);
 
 template <typename Dtype>
-void caffe_rng_bernoulli(const int n, const Dtype p, int* r) {
+void caffe_rng_bernoulli(const int64_t n, const Dtype p, int* r) {
   CHECK_GE(n, 0);
   CHECK(r);
   CHECK_GE(p, 0);
@@ -294,19 +359,19 @@ void caffe_rng_bernoulli(const int n, const Dtype p, int* r) {
   boost::bernoulli_distribution<Dtype> random_distribution(p);
   boost::variate_generator<caffe::rng_t*, boost::bernoulli_distribution<Dtype> >
       variate_generator(caffe_rng(), random_distribution);
-  for (int i = 0; i < n; ++i) {
+  for (int64_t i = 0; i < n; ++i) {
     r[i] = variate_generator();
   }
 }
 
 template
-void caffe_rng_bernoulli<double>(const int n, const double p, int* r);
+void caffe_rng_bernoulli<double>(const int64_t n, const double p, int* r);
 
 template
-void caffe_rng_bernoulli<float>(const int n, const float p, int* r);
+void caffe_rng_bernoulli<float>(const int64_t n, const float p, int* r);
 
 template <typename Dtype>
-void caffe_rng_bernoulli(const int n, const Dtype p, unsigned int* r) {
+void caffe_rng_bernoulli(const int64_t n, const Dtype p, unsigned int* r) {
   CHECK_GE(n, 0);
   CHECK(r);
   CHECK_GE(p, 0);
@@ -314,62 +379,86 @@ void caffe_rng_bernoulli(const int n, const Dtype p, unsigned int* r) {
   boost::bernoulli_distribution<Dtype> random_distribution(p);
   boost::variate_generator<caffe::rng_t*, boost::bernoulli_distribution<Dtype> >
       variate_generator(caffe_rng(), random_distribution);
-  for (int i = 0; i < n; ++i) {
+  for (int64_t i = 0; i < n; ++i) {
     r[i] = static_cast<unsigned int>(variate_generator());
   }
 }
 
 template
-void caffe_rng_bernoulli<double>(const int n, const double p, unsigned int* r);
+void caffe_rng_bernoulli<double>(const int64_t n, const double p,
+    unsigned int* r);
 
 template
-void caffe_rng_bernoulli<float>(const int n, const float p, unsigned int* r);
+void caffe_rng_bernoulli<float>(const int64_t n, const float p,
+    unsigned int* r);
 
 template <>
-float caffe_cpu_strided_dot<float>(const int n, const float* x, const int incx,
-    const float* y, const int incy) {
-  return cblas_sdot(n, x, incx, y, incy);
+float caffe_cpu_strided_dot<float>(const int64_t n, const float* x,
+    const int incx, const float* y, const int incy) {
+  float dot = 0;
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    dot += cblas_sdot(BlasLength(n, i), x + i * incx, incx, y + i * incy,
+        incy);
+  }
+  return dot;
 }
 
 template <>
-double caffe_cpu_strided_dot<double>(const int n, const double* x,
+double caffe_cpu_strided_dot<double>(const int64_t n, const double* x,
     const int incx, const double* y, const int incy) {
-  return cblas_ddot(n, x, incx, y, incy);
+  double dot = 0;
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    dot += cblas_ddot(BlasLength(n, i), x + i * incx, incx, y + i * incy,
+        incy);
+  }
+  return dot;
 }
 
 template <typename Dtype>
-Dtype caffe_cpu_dot(const int n, const Dtype* x, const Dtype* y) {
+Dtype caffe_cpu_dot(const int64_t n, const Dtype* x, const Dtype* y) {
   return caffe_cpu_strided_dot(n, x, 1, y, 1);
 }
 
 template
-float caffe_cpu_dot<float>(const int n, const float* x, const float* y);
+float caffe_cpu_dot<float>(const int64_t n, const float* x, const float* y);
 
 template
-double caffe_cpu_dot<double>(const int n, const double* x, const double* y);
+double caffe_cpu_dot<double>(const int64_t n, const double* x, const double* y);
 
 template <>
-float caffe_cpu_asum<float>(const int n, const float* x) {
-  return cblas_sasum(n, x, 1);
+float caffe_cpu_asum<float>(const int64_t n, const float* x) {
+  float asum = 0;
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    asum += cblas_sasum(BlasLength(n, i), x + i, 1);
+  }
+  return asum;
 }
 
 template <>
-double caffe_cpu_asum<double>(const int n, const double* x) {
-  return cblas_dasum(n, x, 1);
+double caffe_cpu_asum<double>(const int64_t n, const double* x) {
+  double asum = 0;
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    asum += cblas_dasum(BlasLength(n, i), x + i, 1);
+  }
+  return asum;
 }
 
 template <>
-void caffe_cpu_scale<float>(const int n, const float alpha, const float *x,
-                            float* y) {
-  cblas_scopy(n, x, 1, y, 1);
-  cblas_sscal(n, alpha, y, 1);
+void caffe_cpu_scale<float>(const int64_t n, const float alpha,
+    const float *x, float* y) {
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    cblas_scopy(BlasLength(n, i), x + i, 1, y + i, 1);
+    cblas_sscal(BlasLength(n, i), alpha, y + i, 1);
+  }
 }
 
 template <>
-void caffe_cpu_scale<double>(const int n, const double alpha, const double *x,
-                             double* y) {
-  cblas_dcopy(n, x, 1, y, 1);
-  cblas_dscal(n, alpha, y, 1);
+void caffe_cpu_scale<double>(const int64_t n, const double alpha,
+    const double *x, double* y) {
+  for (int64_t i = 0; i < n; i += kBlasChunk) {
+    cblas_dcopy(BlasLength(n, i), x + i, 1, y + i, 1);
+    cblas_dscal(BlasLength(n, i), alpha, y + i, 1);
+  }
 }
 
 }  // namespace caffe
@@ -0,0 +1,205 @@
+#ifdef __linux__
+#include <sched.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/numa.hpp"
+
+namespace caffe {
+
+#ifdef __linux__
+
+// Memory policies and flags of linux/mempolicy.h.
+static const int kMpolDefault = 0;
+static const int kMpolPreferred = 1;
+static const int kMpolFNode = 1 << 0;
+static const int kMpolFAddr = 1 << 1;
+static const int kMpolMfMove = 1 << 1;
+
+// Node masks hold up to kMaxNodes nodes.
+static const int kMaxNodes = 1024;
+typedef unsigned long NodeMaskWord;  // NOLINT(runtime/int)
+static const int kNodeMaskWordBits = 8 * sizeof(NodeMaskWord);
+// The mask sizes passed to the system calls, which read one bit less than
+// the size given.
+static const NodeMaskWord kMaxNodesArgument = kMaxNodes + 1;
+static const NodeMaskWord kNoNodes = 0;
+
+// Parses a list of numbers and ranges, such as "0-3,8-11", as sysfs writes
+// them, returning an empty list if the file cannot be read.
+static vector<int> ReadList(const string& path) {
+  vector<int> values;
+  std::ifstream file(path.c_str());
+  string list;
+  if (!(file >> list)) {
+    return values;
+  }
+  std::stringstream stream(list);
+  string range;
+  while (std::getline(stream, range, ',')) {
+    int first, last;
+    const int parsed = sscanf(range.c_str(), "%d-%d", &first, &last);
+    if (parsed < 1) {
+      continue;
+    }
+    for (int value = first; value <= (parsed == 2 ? last : first); ++value) {
+      values.push_back(value);
+    }
+  }
+  return values;
+}
+
+// Reads the CPUs of each node.
+static vector<vector<int> > ReadNodeCpus() {
+  const vector<int> nodes = ReadList("/sys/devices/system/node/online");
+  vector<vector<int> > cpus(nodes.empty() ? 1 : nodes.back() + 1);
+  for (int node = 0; node < cpus.size(); ++node) {
+    std::ostringstream path;
+    path << "/sys/devices/system/node/node" << node << "/cpulist";
+    cpus[node] = ReadList(path.str());
+  }
+  if (nodes.empty()) {
+    // No NUMA support: node 0 has every CPU.
+    for (int cpu = 0; cpu < sysconf(_SC_NPROCESSORS_CONF); ++cpu) {
+      cpus[0].push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// The CPUs of each node, read once and never destroyed, as threads may bind
+// during the destruction of static objects.
+static const vector<vector<int> >& NodeCpus() {
+  static const vector<vector<int> >* node_cpus =
+      new vector<vector<int> >(ReadNodeCpus());
+  return *node_cpus;
+}
+
+static vector<NodeMaskWord> NodeMask(int node) {
+  vector<NodeMaskWord> mask(kMaxNodes / kNodeMaskWordBits, 0);
+  mask[node / kNodeMaskWordBits] |=
+      NodeMaskWord(1) << (node % kNodeMaskWordBits);
+  return mask;
+}
+
+// The CPUs the process ran on before any thread was bound, read at the
+// first binding, and which unbinding restores.
+static cpu_set_t* ReadInitialCpus() {
+  cpu_set_t* cpus = new cpu_set_t;
+  if (sched_getaffinity(0, sizeof(*cpus), cpus) != 0) {
+    CPU_ZERO(cpus);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      CPU_SET(cpu, cpus);
+    }
+  }
+  return cpus;
+}
+
+static const cpu_set_t& InitialCpus() {
+  static const cpu_set_t* initial_cpus = ReadInitialCpus();
+  return *initial_cpus;
+}
+
+int caffe_numa_nodes() {
+  return NodeCpus().size();
+}
+
+vector<int> caffe_numa_node_cpus(int node) {
+  CHECK_GE(node, 0);
+  CHECK_LT(node, caffe_numa_nodes());
+  return NodeCpus()[node];
+}
+
+bool caffe_numa_bind_thread(int node, bool pin) {
+  CHECK_GE(node, -1);
+  CHECK_LT(node, caffe_numa_nodes());
+  cpu_set_t cpus = InitialCpus();
+  bool applied;
+  if (node < 0) {
+    applied = syscall(SYS_set_mempolicy, kMpolDefault,
+        static_cast<NodeMaskWord*>(NULL), kNoNodes) == 0;
+  } else {
+    applied = syscall(SYS_set_mempolicy, kMpolPreferred, &NodeMask(node)[0],
+        kMaxNodesArgument) == 0;
+  }
+  if (pin && node >= 0) {
+    CPU_ZERO(&cpus);
+    for (int i = 0; i < NodeCpus()[node].size(); ++i) {
+      if (NodeCpus()[node][i] < CPU_SETSIZE) {
+        CPU_SET(NodeCpus()[node][i], &cpus);
+      }
+    }
+  }
+  if (pin || node < 0) {
+    applied = sched_setaffinity(0, sizeof(cpus), &cpus) == 0 && applied;
+  }
+  return applied;
+}
+
+bool caffe_numa_bind_memory(void* ptr, size_t size, int node) {
+  CHECK_GE(node, 0);
+  CHECK_LT(node, caffe_numa_nodes());
+  const uintptr_t page = sysconf(_SC_PAGESIZE);
+  const uintptr_t begin =
+      (reinterpret_cast<uintptr_t>(ptr) + page - 1) / page * page;
+  const uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + size) / page * page;
+  if (begin >= end) {
+    return true;
+  }
+  const bool applied = syscall(SYS_mbind, begin, end - begin, kMpolPreferred,
+      &NodeMask(node)[0], kMaxNodesArgument, kMpolMfMove) == 0;
+  static bool warned = false;
+  if (!applied && !warned) {
+    LOG(WARNING) << "Binding memory to NUMA node " << node << " failed";
+    warned = true;
+  }
+  return applied;
+}
+
+int caffe_numa_memory_node(const void* ptr) {
+  int node = -1;
+  if (syscall(SYS_get_mempolicy, &node, static_cast<NodeMaskWord*>(NULL),
+      kNoNodes, ptr, kMpolFNode | kMpolFAddr) != 0) {
+    return -1;
+  }
+  return node;
+}
+
+#else  // __linux__
+
+int caffe_numa_nodes() {
+  return 1;
+}
+
+vector<int> caffe_numa_node_cpus(int node) {
+  CHECK_EQ(node, 0);
+  return vector<int>();
+}
+
+bool caffe_numa_bind_thread(int node, bool pin) {
+  CHECK_GE(node, -1);
+  CHECK_LT(node, 1);
+  return false;
+}
+
+bool caffe_numa_bind_memory(void* ptr, size_t size, int node) {
+  CHECK_EQ(node, 0);
+  return false;
+}
+
+int caffe_numa_memory_node(const void* ptr) {
+  return -1;
+}
+
+#endif  // __linux__
+
+}  // namespace caffe
@@ -0,0 +1,74 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/parallel_for.hpp"
+#include "caffe/util/rng.hpp"
+#include "caffe/util/task_scheduler.hpp"
+
+namespace caffe {
+
+// The helpers of the threads with a given NUMA node binding. One caller at a
+// time runs on them, holding mutex.
+struct ParallelForPool {
+  boost::mutex mutex;
+  shared_ptr<TaskScheduler> scheduler;
+};
+
+// The pools by NUMA node binding. Never destroyed, so that static objects can
+// use caffe_cpu_parallel_for as they are destroyed.
+static ParallelForPool* GetParallelForPool(int numa_node, bool numa_pinned) {
+  static boost::mutex* mutex = new boost::mutex();
+  static std::map<std::pair<int, bool>, ParallelForPool*>* pools =
+      new std::map<std::pair<int, bool>, ParallelForPool*>();
+  boost::mutex::scoped_lock lock(*mutex);
+  ParallelForPool*& pool = (*pools)[std::make_pair(numa_node, numa_pinned)];
+  if (!pool) {
+    pool = new ParallelForPool();
+  }
+  return pool;
+}
+
+// Calls f on the range of task i.
+static void RunRange(const boost::function<void(int, int)>& f, int n,
+    int step, int i) {
+  f(i * step, std::min(i * step + step, n));
+}
+
+void caffe_cpu_parallel_for(int n, int grain,
+    const boost::function<void(int, int)>& f) {
+  const int cores = boost::thread::hardware_concurrency();
+  const int threads = std::min<int>(cores, n / std::max(grain, 1));
+  if (threads <= 1) {
+    f(0, n);
+    return;
+  }
+  ParallelForPool* pool = GetParallelForPool(Caffe::numa_node(),
+      Caffe::numa_pinned());
+  boost::mutex::scoped_try_lock lock(pool->mutex);
+  if (!lock.owns_lock()) {
+    // Another thread, such as another solver, is using the cores already.
+    f(0, n);
+    return;
+  }
+  if (!pool->scheduler) {
+    // The helpers take the NUMA node binding of this thread. Keep its random
+    // numbers as they would be without them.
+    const rng_t rng = *caffe_rng();
+    pool->scheduler.reset(new TaskScheduler(cores));
+    *caffe_rng() = rng;
+  }
+  const int step = (n + threads - 1) / threads;
+  const int tasks = (n + step - 1) / step;
+  // The helpers use f, do not let an interruption unwind it.
+  boost::this_thread::disable_interruption no_interruption;
+  pool->scheduler->Run(vector<vector<int> >(tasks), vector<int>(tasks, 0),
+      boost::bind(&RunRange, boost::cref(f), n, step, _1));
+}
+
+}  // namespace caffe
@@ -0,0 +1,161 @@
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread.hpp>
+
+#include <fstream>  // NOLINT(readability/streams)
+#include <map>
+#include <string>
+#include <vector>
+
+#include "caffe/util/format.hpp"
+#include "caffe/util/profiler.hpp"
+
+namespace caffe {
+
+class Profiler::ThreadStats {
+ public:
+  struct Event {
+    Event(int layer, Pass pass, int64_t start, int64_t duration)
+        : layer(layer), pass(pass), start(start), duration(duration) {}
+    int layer;
+    Pass pass;
+    int64_t start;
+    int64_t duration;
+  };
+
+  ThreadStats(int num_layers, int index) : layers(num_layers), index(index) {}
+
+  // Only contended while the profiler is queried.
+  boost::mutex mutex;
+  vector<LayerStats> layers;
+  vector<Event> events;
+  // Index of the thread in the profiler, used as its trace track.
+  const int index;
+};
+
+// The stats of the calling thread for each live profiler, by profiler id.
+typedef std::map<uint64_t, boost::weak_ptr<Profiler::ThreadStats> >
+    ThreadStatsMap;
+static boost::thread_specific_ptr<ThreadStatsMap> thread_stats_map_;
+
+static boost::mutex next_id_mutex_;
+static uint64_t next_id_ = 0;
+
+static uint64_t NextId() {
+  boost::mutex::scoped_lock lock(next_id_mutex_);
+  return next_id_++;
+}
+
+static int64_t MicroSecondsSinceEpoch() {
+  static const boost::posix_time::ptime epoch(
+      boost::gregorian::date(1970, 1, 1));
+  return (boost::posix_time::microsec_clock::universal_time() - epoch)
+      .total_microseconds();
+}
+
+Profiler::Profiler(const vector<string>& layer_names)
+    : id_(NextId()), layer_names_(layer_names),
+      start_(MicroSecondsSinceEpoch()), trace_(false),
+      mutex_(new boost::mutex()) {
+}
+
+int64_t Profiler::Now() const {
+  return MicroSecondsSinceEpoch() - start_;
+}
+
+Profiler::ThreadStats* Profiler::thread_stats() {
+  ThreadStatsMap* stats_map = thread_stats_map_.get();
+  if (!stats_map) {
+    stats_map = new ThreadStatsMap();
+    thread_stats_map_.reset(stats_map);
+  }
+  ThreadStatsMap::iterator it = stats_map->find(id_);
+  if (it != stats_map->end()) {
+    // Owned by threads_, so it lives as long as this profiler.
+    return it->second.lock().get();
+  }
+  // Forget the profilers that were destroyed.
+  for (it = stats_map->begin(); it != stats_map->end(); ) {
+    if (it->second.expired()) {
+      stats_map->erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  boost::mutex::scoped_lock lock(*mutex_);
+  shared_ptr<ThreadStats> stats(
+      new ThreadStats(layer_names_.size(), threads_.size()));
+  threads_.push_back(stats);
+  (*stats_map)[id_] = stats;
+  return stats.get();
+}
+
+void Profiler::Record(int layer, Pass pass, int64_t start) {
+  const int64_t duration = Now() - start;
+  ThreadStats* stats = thread_stats();
+  boost::mutex::scoped_lock lock(stats->mutex);
+  LayerStats& layer_stats = stats->layers[layer];
+  if (pass == FORWARD) {
+    ++layer_stats.forward_calls;
+    layer_stats.forward_us += duration;
+  } else {
+    ++layer_stats.backward_calls;
+    layer_stats.backward_us += duration;
+  }
+  if (trace_ && stats->events.size() < kMaxTraceEvents) {
+    stats->events.push_back(ThreadStats::Event(layer, pass, start, duration));
+  }
+}
+
+vector<Profiler::LayerStats> Profiler::stats() const {
+  vector<LayerStats> result(layer_names_.size());
+  boost::mutex::scoped_lock lock(*mutex_);
+  for (int t = 0; t < threads_.size(); ++t) {
+    boost::mutex::scoped_lock thread_lock(threads_[t]->mutex);
+    const vector<LayerStats>& layers = threads_[t]->layers;
+    for (int i = 0; i < layers.size(); ++i) {
+      result[i].forward_calls += layers[i].forward_calls;
+      result[i].backward_calls += layers[i].backward_calls;
+      result[i].forward_us += layers[i].forward_us;
+      result[i].backward_us += layers[i].backward_us;
+    }
+  }
+  return result;
+}
+
+void Profiler::WriteTrace(std::ostream& out) const {
+  out << "{\"traceEvents\": [";
+  const char* separator = "\n";
+  boost::mutex::scoped_lock lock(*mutex_);
+  for (int t = 0; t < threads_.size(); ++t) {
+    boost::mutex::scoped_lock thread_lock(threads_[t]->mutex);
+    const vector<ThreadStats::Event>& events = threads_[t]->events;
+    for (int i = 0; i < events.size(); ++i) {
+      out << separator << "{\"name\": "
+          << format_json_string(layer_names_[events[i].layer])
+          << ", \"cat\": \""
+          << (events[i].pass == FORWARD ? "forward" : "backward")
+          << "\", \"ph\": \"X\", \"ts\": " << events[i].start
+          << ", \"dur\": " << events[i].duration
+          << ", \"pid\": 0, \"tid\": " << threads_[t]->index << "}";
+      separator = ",\n";
+    }
+  }
+  out << "\n], \"displayTimeUnit\": \"ms\"}\n";
+}
+
+void Profiler::WriteTrace(const string& filename) const {
+  std::ofstream out(filename.c_str());
+  CHECK(out) << "Cannot write " << filename;
+  WriteTrace(out);
+}
+
+void Profiler::Reset() {
+  boost::mutex::scoped_lock lock(*mutex_);
+  for (int t = 0; t < threads_.size(); ++t) {
+    boost::mutex::scoped_lock thread_lock(threads_[t]->mutex);
+    threads_[t]->layers.assign(layer_names_.size(), LayerStats());
+    threads_[t]->events.clear();
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,178 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/util/half.hpp"
+#include "caffe/util/raw_model.hpp"
+
+namespace caffe {
+
+namespace {
+
+const char kMagic[8] = {'C', 'A', 'F', 'F', 'E', 'R', 'A', 'W'};
+const uint32_t kVersion = 1;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t element_size;
+  // Size in bytes of the index, which follows the header.
+  uint64_t index_size;
+};
+
+size_t Align(size_t offset) {
+  return (offset + RawModel::kAlignment - 1) / RawModel::kAlignment *
+      RawModel::kAlignment;
+}
+
+// The number of elements of a blob of the given shape.
+size_t Count(const BlobShape& shape) {
+  size_t count = 1;
+  for (int i = 0; i < shape.dim_size(); ++i) {
+    CHECK_GE(shape.dim(i), 0);
+    count *= shape.dim(i);
+  }
+  return count;
+}
+
+}  // namespace
+
+const size_t RawModel::kAlignment;
+const size_t RawModel::kHalfSize;
+
+RawModel::RawModel(const string& filename, bool read_only)
+    : filename_(filename), data_(MAP_FAILED), size_(0), read_only_(read_only) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  CHECK_NE(fd, -1) << "File not found: " << filename;
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0) << "Cannot stat " << filename;
+  size_ = st.st_size;
+  CHECK_GE(size_, sizeof(Header)) << filename << " is not a raw model";
+  if (read_only) {
+    data_ = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+  } else {
+    data_ = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  CHECK(data_ != MAP_FAILED) << "Cannot map " << filename << ": "
+      << strerror(errno);
+
+  const Header* header = static_cast<const Header*>(data_);
+  CHECK_EQ(memcmp(header->magic, kMagic, sizeof(kMagic)), 0)
+      << filename << " is not a raw model";
+  CHECK_EQ(header->version, kVersion)
+      << "Unsupported raw model version in " << filename;
+  element_size_ = header->element_size;
+  CHECK(element_size_ == sizeof(float) || element_size_ == sizeof(double) ||
+        element_size_ == kHalfSize)
+      << "Unsupported element size " << element_size_ << " in " << filename;
+  CHECK_LE(sizeof(Header) + header->index_size, size_)
+      << filename << " is truncated";
+  const char* index_data = static_cast<const char*>(data_) + sizeof(Header);
+  CHECK(index_.ParseFromArray(index_data, header->index_size))
+      << "Cannot parse the index of " << filename;
+
+  size_t offset = Align(sizeof(Header) + header->index_size);
+  offsets_.resize(index_.layer_size());
+  for (int i = 0; i < index_.layer_size(); ++i) {
+    const LayerParameter& layer = index_.layer(i);
+    for (int j = 0; j < layer.blobs_size(); ++j) {
+      offsets_[i].push_back(offset);
+      offset += Count(layer.blobs(j).shape()) * element_size_;
+      CHECK_LE(offset, size_) << filename << " is truncated";
+      offset = Align(offset);
+    }
+  }
+}
+
+RawModel::~RawModel() {
+  if (data_ != MAP_FAILED) {
+    munmap(data_, size_);
+  }
+}
+
+bool IsRawModelFile(const string& filename) {
+  return filename.size() >= 4 &&
+      filename.compare(filename.size() - 4, 4, ".raw") == 0;
+}
+
+// Pads output with zeros up to the next aligned offset.
+static void WritePadding(std::ofstream* output) {
+  const size_t offset = static_cast<size_t>(output->tellp());
+  const string padding(Align(offset) - offset, 0);
+  output->write(padding.data(), padding.size());
+}
+
+template <typename Dtype>
+void WriteRawModel(const NetParameter& param, const string& filename,
+    bool half) {
+  // Blobs are read from param one at a time, in whichever of its formats
+  // they were saved, so that at most one is held as Dtype at once.
+  NetParameter index;
+  index.set_name(param.name());
+  for (int i = 0; i < param.layer_size(); ++i) {
+    const LayerParameter& source_layer = param.layer(i);
+    if (source_layer.blobs_size() == 0) {
+      continue;
+    }
+    LayerParameter* layer = index.add_layer();
+    layer->set_name(source_layer.name());
+    layer->set_type(source_layer.type());
+    for (int j = 0; j < source_layer.blobs_size(); ++j) {
+      Blob<Dtype> blob;
+      blob.FromProto(source_layer.blobs(j));
+      BlobShape* shape = layer->add_blobs()->mutable_shape();
+      for (int k = 0; k < blob.num_axes(); ++k) {
+        shape->add_dim(blob.shape(k));
+      }
+    }
+  }
+  string index_data;
+  CHECK(index.SerializeToString(&index_data));
+  Header header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.element_size = half ? RawModel::kHalfSize : sizeof(Dtype);
+  header.index_size = index_data.size();
+
+  std::ofstream output(filename.c_str(), std::ios::out | std::ios::trunc |
+      std::ios::binary);
+  CHECK(output) << "Cannot write " << filename;
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  output.write(index_data.data(), index_data.size());
+  WritePadding(&output);
+  for (int i = 0; i < param.layer_size(); ++i) {
+    const LayerParameter& source_layer = param.layer(i);
+    for (int j = 0; j < source_layer.blobs_size(); ++j) {
+      Blob<Dtype> blob;
+      blob.FromProto(source_layer.blobs(j));
+      if (half && blob.count() > 0) {
+        vector<uint16_t> half_data(blob.count());
+        caffe_cpu_to_half(blob.count(), blob.cpu_data(), &half_data[0]);
+        output.write(reinterpret_cast<const char*>(&half_data[0]),
+            blob.count() * sizeof(uint16_t));
+      } else if (!half) {
+        output.write(reinterpret_cast<const char*>(blob.cpu_data()),
+            blob.count() * sizeof(Dtype));
+      }
+      WritePadding(&output);
+    }
+  }
+  CHECK(output) << "Error writing " << filename;
+}
+
+template void WriteRawModel<float>(const NetParameter& param,
+    const string& filename, bool half);
+template void WriteRawModel<double>(const NetParameter& param,
+    const string& filename, bool half);
+
+}  // namespace caffe
@@ -0,0 +1,265 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/socket.hpp"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace caffe {
+
+// Pieces in which ring transfers are pipelined.
+static const size_t kRingPieceSize = 1 << 18;
+
+// Creates a socket for address, bound to it if listen is set and connected
+// to it otherwise. Returns -1 if the connection is refused.
+static int OpenSocket(const string& address, bool listen) {
+  int fd;
+  int result;
+  if (address.compare(0, 5, "unix:") == 0) {
+    const string path = address.substr(5);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    CHECK_LT(path.size(), sizeof(addr.sun_path)) << "Path too long " << path;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    CHECK_GE(fd, 0) << "socket: " << strerror(errno);
+    if (listen) {
+      unlink(path.c_str());
+      result = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    } else {
+      result = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+  } else {
+    const size_t colon = address.rfind(':');
+    CHECK_NE(colon, string::npos) << "Expected host:port or unix:path, got "
+        << address;
+    const string host = address.substr(0, colon);
+    const string port = address.substr(colon + 1);
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* info;
+    const int error = getaddrinfo(host.c_str(), port.c_str(), &hints, &info);
+    CHECK_EQ(error, 0) << "Cannot resolve " << address << ": "
+        << gai_strerror(error);
+    fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    CHECK_GE(fd, 0) << "socket: " << strerror(errno);
+    const int one = 1;
+    if (listen) {
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      result = bind(fd, info->ai_addr, info->ai_addrlen);
+    } else {
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      result = connect(fd, info->ai_addr, info->ai_addrlen);
+    }
+    freeaddrinfo(info);
+  }
+  if (listen) {
+    CHECK_EQ(result, 0) << "Cannot bind " << address << ": " << strerror(errno);
+    CHECK_EQ(::listen(fd, 16), 0) << "listen: " << strerror(errno);
+  } else if (result != 0) {
+    CHECK(errno == ECONNREFUSED || errno == ENOENT || errno == EINTR)
+        << "Cannot connect to " << address << ": " << strerror(errno);
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+Socket::~Socket() {
+  close(fd_);
+}
+
+shared_ptr<Socket> Socket::Listen(const string& address) {
+  return shared_ptr<Socket>(new Socket(OpenSocket(address, true)));
+}
+
+shared_ptr<Socket> Socket::Connect(const string& address, int timeout_ms) {
+  const int kRetryMs = 100;
+  for (int waited = 0; ; waited += kRetryMs) {
+    const int fd = OpenSocket(address, false);
+    if (fd >= 0) {
+      return shared_ptr<Socket>(new Socket(fd));
+    }
+    CHECK_LT(waited, timeout_ms) << "Timed out connecting to " << address;
+    boost::this_thread::sleep(boost::posix_time::milliseconds(kRetryMs));
+  }
+}
+
+shared_ptr<Socket> Socket::Accept() {
+  int fd;
+  do {
+    fd = accept(fd_, NULL, NULL);
+  } while (fd < 0 && errno == EINTR);
+  CHECK_GE(fd, 0) << "accept: " << strerror(errno);
+  return shared_ptr<Socket>(new Socket(fd));
+}
+
+void Socket::Send(const void* buffer, size_t size) {
+  SendRecv(this, buffer, size, NULL, NULL, 0);
+}
+
+void Socket::Recv(void* buffer, size_t size) {
+  SendRecv(NULL, NULL, 0, this, buffer, size);
+}
+
+void SendRecv(Socket* send_socket, const void* send_buffer, size_t send_size,
+    Socket* recv_socket, void* recv_buffer, size_t recv_size,
+    size_t piece_size,
+    const boost::function<void(size_t, size_t)>& on_received) {
+  if (piece_size == 0) {
+    piece_size = recv_size;
+  }
+  const char* send_ptr = static_cast<const char*>(send_buffer);
+  char* recv_ptr = static_cast<char*>(recv_buffer);
+  size_t sent = 0;
+  size_t received = 0;
+  size_t reported = 0;
+  while (sent < send_size || received < recv_size) {
+    pollfd fds[2];
+    int nfds = 0;
+    if (sent < send_size) {
+      fds[nfds].fd = send_socket->fd();
+      fds[nfds].events = POLLOUT;
+      ++nfds;
+    }
+    if (received < recv_size) {
+      fds[nfds].fd = recv_socket->fd();
+      fds[nfds].events = POLLIN;
+      ++nfds;
+    }
+    if (poll(fds, nfds, -1) < 0) {
+      CHECK_EQ(errno, EINTR) << "poll: " << strerror(errno);
+      continue;
+    }
+    for (int i = 0; i < nfds; ++i) {
+      if (!fds[i].revents) {
+        continue;
+      }
+      ssize_t n;
+      if (fds[i].events == POLLOUT) {
+        n = send(fds[i].fd, send_ptr + sent, send_size - sent,
+            MSG_DONTWAIT | MSG_NOSIGNAL);
+      } else {
+        n = recv(fds[i].fd, recv_ptr + received, recv_size - received,
+            MSG_DONTWAIT);
+        CHECK_NE(n, 0) << "Connection closed by peer";
+      }
+      if (n < 0) {
+        CHECK(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            << (fds[i].events == POLLOUT ? "send: " : "recv: ")
+            << strerror(errno);
+        continue;
+      }
+      (fds[i].events == POLLOUT ? sent : received) += n;
+    }
+    if (on_received) {
+      while (reported < received &&
+             (received - reported >= piece_size || received == recv_size)) {
+        const size_t end = std::min(reported + piece_size, received);
+        on_received(reported, end);
+        reported = end;
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+SocketRing<Dtype>::SocketRing(const vector<string>& addresses, int rank,
+    int timeout_ms)
+    : rank_(rank), size_(addresses.size()), received_(1) {
+  CHECK_GE(rank, 0);
+  CHECK_LT(rank, size_);
+  if (size_ == 1) {
+    return;
+  }
+  // Connections are queued until accepted, so every member can connect to
+  // the next one before accepting the previous one.
+  shared_ptr<Socket> listener = Socket::Listen(addresses[rank]);
+  next_ = Socket::Connect(addresses[(rank + 1) % size_], timeout_ms);
+  const int32_t self = rank;
+  next_->Send(&self, sizeof(self));
+  prev_ = listener->Accept();
+  int32_t prev;
+  prev_->Recv(&prev, sizeof(prev));
+  CHECK_EQ(prev, (rank + size_ - 1) % size_)
+      << "Unexpected ring member, check the addresses";
+}
+
+template <typename Dtype>
+void SocketRing<Dtype>::Accumulate(const Dtype* src, Dtype* dst,
+    size_t begin, size_t end) {
+  begin /= sizeof(Dtype);
+  end /= sizeof(Dtype);
+  caffe_axpy<Dtype>(end - begin, Dtype(1), src + begin, dst + begin);
+}
+
+template <typename Dtype>
+void SocketRing<Dtype>::AllReduce(Dtype* buffer, size_t count) {
+  if (size_ == 1) {
+    return;
+  }
+  received_.resize(std::max<size_t>(count / size_ + 1, received_.size()));
+  // Reduce-scatter: at step s, the segment received holds the sum over s + 2
+  // members once accumulated, so that after size_ - 1 steps this member
+  // holds the sum of segment rank_ + 1.
+  for (int s = 0; s < size_ - 1; ++s) {
+    const int send_seg = (rank_ - s + size_) % size_;
+    const int recv_seg = (rank_ - s - 1 + 2 * size_) % size_;
+    const size_t send_begin = segment(send_seg, count);
+    const size_t recv_begin = segment(recv_seg, count);
+    SendRecv(next_.get(), buffer + send_begin,
+        (segment(send_seg + 1, count) - send_begin) * sizeof(Dtype),
+        prev_.get(), &received_[0],
+        (segment(recv_seg + 1, count) - recv_begin) * sizeof(Dtype),
+        kRingPieceSize, boost::bind(&SocketRing<Dtype>::Accumulate, this,
+            &received_[0], buffer + recv_begin, _1, _2));
+  }
+  // All-gather: pass the summed segments around the ring.
+  for (int s = 0; s < size_ - 1; ++s) {
+    const int send_seg = (rank_ + 1 - s + size_) % size_;
+    const int recv_seg = (rank_ - s + size_) % size_;
+    const size_t send_begin = segment(send_seg, count);
+    const size_t recv_begin = segment(recv_seg, count);
+    SendRecv(next_.get(), buffer + send_begin,
+        (segment(send_seg + 1, count) - send_begin) * sizeof(Dtype),
+        prev_.get(), buffer + recv_begin,
+        (segment(recv_seg + 1, count) - recv_begin) * sizeof(Dtype));
+  }
+}
+
+template <typename Dtype>
+void SocketRing<Dtype>::Broadcast(Dtype* buffer, size_t count) {
+  if (size_ == 1) {
+    return;
+  }
+  if (rank_ != 0) {
+    prev_->Recv(buffer, count * sizeof(Dtype));
+  }
+  if (rank_ != size_ - 1) {
+    next_->Send(buffer, count * sizeof(Dtype));
+  }
+}
+
+INSTANTIATE_CLASS(SocketRing);
+
+}  // namespace caffe
@@ -0,0 +1,110 @@
+#include <boost/thread.hpp>
+
+#include <vector>
+
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/task_scheduler.hpp"
+
+namespace caffe {
+
+TaskScheduler::TaskScheduler(int threads)
+    : threads_(threads), mutex_(new boost::mutex()),
+      condition_(new boost::condition_variable()),
+      helpers_(new boost::thread_group()), shutdown_(false),
+      dependents_(NULL), run_(NULL), remaining_(0) {
+  CHECK_GE(threads, 1);
+  int device = 0;
+#ifndef CPU_ONLY
+  CUDA_CHECK(cudaGetDevice(&device));
+#endif
+  for (int i = 1; i < threads; ++i) {
+    helpers_->create_thread(boost::bind(&TaskScheduler::Entry, this, device,
+        Caffe::mode(), caffe_rng_rand(), Caffe::solver_count(),
+        Caffe::root_solver(), Caffe::numa_node(), Caffe::numa_pinned()));
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    boost::mutex::scoped_lock lock(*mutex_);
+    shutdown_ = true;
+  }
+  condition_->notify_all();
+  helpers_->join_all();
+}
+
+void TaskScheduler::Entry(int device, Caffe::Brew mode, int rand_seed,
+    int solver_count, bool root_solver, int numa_node, bool numa_pinned) {
+#ifndef CPU_ONLY
+  CUDA_CHECK(cudaSetDevice(device));
+#endif
+  Caffe::set_mode(mode);
+  Caffe::set_random_seed(rand_seed);
+  Caffe::set_solver_count(solver_count);
+  Caffe::set_root_solver(root_solver);
+  if (numa_node >= 0) {
+    Caffe::SetNumaNode(numa_node, numa_pinned);
+  }
+  RunTasks(true);
+}
+
+void TaskScheduler::Run(const vector<vector<int> >& dependents,
+    const vector<int>& dependencies, const boost::function<void(int)>& run) {
+  CHECK_EQ(dependents.size(), dependencies.size());
+  if (dependents.empty()) {
+    return;
+  }
+  {
+    boost::mutex::scoped_lock lock(*mutex_);
+    dependents_ = &dependents;
+    run_ = &run;
+    unmet_dependencies_ = dependencies;
+    remaining_ = dependents.size();
+    for (int i = 0; i < dependencies.size(); ++i) {
+      if (dependencies[i] == 0) {
+        ready_.push_back(i);
+      }
+    }
+    CHECK(!ready_.empty()) << "Every task has dependencies";
+  }
+  condition_->notify_all();
+  RunTasks(false);
+}
+
+void TaskScheduler::RunTasks(bool helper) {
+  boost::mutex::scoped_lock lock(*mutex_);
+  int task = -1;
+  while (true) {
+    if (task < 0) {
+      while (ready_.empty() && !(helper ? shutdown_ : remaining_ == 0)) {
+        condition_->wait(lock);
+      }
+      if (ready_.empty()) {
+        return;
+      }
+      task = ready_.front();
+      ready_.pop_front();
+    }
+    lock.unlock();
+    (*run_)(task);
+    lock.lock();
+    const vector<int>& dependents = (*dependents_)[task];
+    task = -1;
+    for (int i = 0; i < dependents.size(); ++i) {
+      if (--unmet_dependencies_[dependents[i]] > 0) {
+        continue;
+      }
+      if (task < 0) {
+        task = dependents[i];
+      } else {
+        ready_.push_back(dependents[i]);
+        condition_->notify_one();
+      }
+    }
+    if (--remaining_ == 0) {
+      condition_->notify_all();
+    }
+  }
+}
+
+}  // namespace caffe
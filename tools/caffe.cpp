@@ -6,17 +6,21 @@ namespace bp = boost::python;
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <cstring>
+#include <fstream>
 #include <map>
 #include <string>
 #include <vector>
 
 #include "boost/algorithm/string.hpp"
 #include "caffe/caffe.hpp"
+#include "caffe/util/format.hpp"
 #include "caffe/util/signal_handler.h"
 
 using caffe::Blob;
 using caffe::Caffe;
+using caffe::format_json_string;
 using caffe::Net;
 using caffe::Layer;
 using caffe::Solver;
@@ -30,6 +34,17 @@ DEFINE_string(gpu, "",
     "Optional; run in GPU mode on given device IDs separated by ','."
     "Use '-gpu all' to run on all available GPUs. The effective training "
     "batch size is multiplied by the number of devices.");
+DEFINE_int32(threads, 1,
+    "Optional; in CPU mode, train with this many solvers on as many threads, "
+    "sharing the parameters. The effective training batch size is "
+    "multiplied by the number of threads.");
+DEFINE_string(ring, "",
+    "Optional; in CPU mode, train data parallel with the processes listening "
+    "on these addresses (host:port or unix:path), separated by ','. Start "
+    "every process with the same list and its own ring_rank, and give each "
+    "its own share of the data.");
+DEFINE_int32(ring_rank, 0,
+    "Optional; the index of this process in the ring.");
 DEFINE_string(solver, "",
     "The solver definition protocol buffer text file.");
 DEFINE_string(model, "",
@@ -48,6 +63,22 @@ DEFINE_string(weights, "",
     "separated by ','. Cannot be set simultaneously with snapshot.");
 DEFINE_int32(iterations, 50,
     "The number of iterations to run.");
+DEFINE_int32(warmup, 1,
+    "Optional; the number of untimed iterations run before timing a model. "
+    "Only used for 'time'.");
+DEFINE_bool(forward_only, false,
+    "Optional; only time the forward pass. Only used for 'time'.");
+DEFINE_string(batch_sizes, "",
+    "Optional; time or size the model at each of these batch sizes, "
+    "separated by ',', instead of the one it defines. Only used for 'time' "
+    "and 'memory'.");
+DEFINE_string(output, "",
+    "Optional; write the per-layer timings, FLOP estimates and memory, or "
+    "the per-layer memory footprint, to this file, as JSON if it ends with "
+    ".json and CSV otherwise. Only used for 'time' and 'memory'.");
+DEFINE_uint64(memory_budget, 0,
+    "Optional; the bytes of memory the model may use, failing beyond them. "
+    "Only used for 'memory'.");
 DEFINE_string(sigint_effect, "stop",
              "Optional; action to take when a SIGINT signal is received: "
               "snapshot, stop or none.");
@@ -127,6 +158,22 @@ vector<string> get_stages_from_flags() {
   return stages;
 }
 
+// Parse batch sizes from flags, or 0 for the one of the model
+vector<int> get_batch_sizes_from_flags() {
+  vector<int> batch_sizes;
+  if (FLAGS_batch_sizes.size()) {
+    vector<string> strings;
+    boost::split(strings, FLAGS_batch_sizes, boost::is_any_of(","));
+    for (int i = 0; i < strings.size(); ++i) {
+      batch_sizes.push_back(boost::lexical_cast<int>(strings[i]));
+      CHECK_GT(batch_sizes.back(), 0) << "Invalid batch size " << strings[i];
+    }
+  } else {
+    batch_sizes.push_back(0);
+  }
+  return batch_sizes;
+}
+
 // caffe commands to call by
 //     caffe <command> <args>
 //
@@ -206,10 +253,13 @@ int train() {
 
   vector<int> gpus;
   get_gpus(&gpus);
+  CHECK_GE(FLAGS_threads, 1) << "threads must be positive.";
   if (gpus.size() == 0) {
     LOG(INFO) << "Use CPU.";
     Caffe::set_mode(Caffe::CPU);
+    Caffe::set_solver_count(FLAGS_threads);
   } else {
+    CHECK_EQ(FLAGS_threads, 1) << "threads is only supported in CPU mode.";
     ostringstream s;
     for (int i = 0; i < gpus.size(); ++i) {
       s << (i ? ", " : "") << gpus[i];
@@ -228,6 +278,19 @@ int train() {
     Caffe::set_solver_count(gpus.size());
   }
 
+  vector<string> ring;
+  if (FLAGS_ring.size()) {
+    CHECK_EQ(gpus.size(), 0) << "ring is only supported in CPU mode.";
+    CHECK_EQ(FLAGS_threads, 1) << "ring and threads cannot be combined.";
+    boost::split(ring, FLAGS_ring, boost::is_any_of(","));
+    if (FLAGS_ring_rank != 0) {
+      // Only the first process tests and snapshots the shared model.
+      solver_param.set_test_interval(0);
+      solver_param.set_snapshot(0);
+      solver_param.set_snapshot_after_train(false);
+    }
+  }
+
   caffe::SignalHandler signal_handler(
         GetRequestedAction(FLAGS_sigint_effect),
         GetRequestedAction(FLAGS_sighup_effect));
@@ -247,6 +310,12 @@ int train() {
   if (gpus.size() > 1) {
     caffe::P2PSync<float> sync(solver, NULL, solver->param());
     sync.Run(gpus);
+  } else if (ring.size() > 1) {
+    caffe::RingSync<float> sync(solver, ring, FLAGS_ring_rank);
+    sync.Run();
+  } else if (FLAGS_threads > 1) {
+    caffe::CPUSync<float> sync(solver, NULL, 0, solver->param());
+    sync.Run(FLAGS_threads);
   } else {
     LOG(INFO) << "Starting Optimization";
     solver->Solve();
@@ -330,42 +399,291 @@ int test() {
 RegisterBrewFunction(test);
 
 
-// Time: benchmark the execution time of a model.
-int time() {
-  CHECK_GT(FLAGS_model.size(), 0) << "Need a model definition to time.";
-  caffe::Phase phase = get_phase_from_flags(caffe::TRAIN);
-  vector<string> stages = get_stages_from_flags();
+// Sets the batch size of the inputs and data layers of param.
+static void set_batch_size(caffe::NetParameter* param, int batch_size) {
+  for (int i = 0; i < param->input_shape_size(); ++i) {
+    param->mutable_input_shape(i)->set_dim(0, batch_size);
+  }
+  if (param->input_dim_size() > 0) {
+    param->set_input_dim(0, batch_size);
+  }
+  for (int i = 0; i < param->layer_size(); ++i) {
+    caffe::LayerParameter* layer = param->mutable_layer(i);
+    if (layer->has_input_param()) {
+      for (int j = 0; j < layer->input_param().shape_size(); ++j) {
+        layer->mutable_input_param()->mutable_shape(j)->set_dim(0, batch_size);
+      }
+    }
+    if (layer->has_dummy_data_param()) {
+      caffe::DummyDataParameter* dummy = layer->mutable_dummy_data_param();
+      for (int j = 0; j < dummy->shape_size(); ++j) {
+        dummy->mutable_shape(j)->set_dim(0, batch_size);
+      }
+      for (int j = 0; j < dummy->num_size(); ++j) {
+        dummy->set_num(j, batch_size);
+      }
+    }
+    if (layer->has_data_param()) {
+      layer->mutable_data_param()->set_batch_size(batch_size);
+    }
+    if (layer->has_image_data_param()) {
+      layer->mutable_image_data_param()->set_batch_size(batch_size);
+    }
+    if (layer->has_hdf5_data_param()) {
+      layer->mutable_hdf5_data_param()->set_batch_size(batch_size);
+    }
+    if (layer->has_memory_data_param()) {
+      layer->mutable_memory_data_param()->set_batch_size(batch_size);
+    }
+    if (layer->has_window_data_param()) {
+      layer->mutable_window_data_param()->set_batch_size(batch_size);
+    }
+  }
+}
 
-  // Set device id and mode
-  vector<int> gpus;
-  get_gpus(&gpus);
-  if (gpus.size() != 0) {
-    LOG(INFO) << "Use GPU with device ID " << gpus[0];
-    Caffe::SetDevice(gpus[0]);
-    Caffe::set_mode(Caffe::GPU);
+// Estimates the floating point operations of a forward pass of a layer,
+// counting a multiply-add as two. Convolutions and inner products are
+// counted from their weights, other layers as one operation per output.
+static double forward_flops(Layer<float>* layer,
+    const vector<Blob<float>*>& bottom, const vector<Blob<float>*>& top) {
+  const string& type = layer->type();
+  const vector<shared_ptr<Blob<float> > >& blobs = layer->blobs();
+  double flops = 0;
+  if ((type == "Convolution" || type == "InnerProduct") && blobs.size()) {
+    // Each output sums over the weights of its output channel.
+    flops = 2.0 * top[0]->count() * blobs[0]->count() /
+        (type == "Convolution" ? blobs[0]->shape(0) :
+         layer->layer_param().inner_product_param().num_output());
+    if (blobs.size() > 1) {
+      flops += top[0]->count();
+    }
+  } else if (type == "Deconvolution" && blobs.size()) {
+    // Each input is spread over the weights of its input channel.
+    flops = 2.0 * bottom[0]->count() * blobs[0]->count() / blobs[0]->shape(0);
+    if (blobs.size() > 1) {
+      flops += top[0]->count();
+    }
   } else {
-    LOG(INFO) << "Use CPU.";
-    Caffe::set_mode(Caffe::CPU);
+    for (int i = 0; i < top.size(); ++i) {
+      flops += top[i]->count();
+    }
+  }
+  return flops;
+}
+
+static size_t data_bytes(const vector<Blob<float>*>& blobs) {
+  size_t bytes = 0;
+  for (int i = 0; i < blobs.size(); ++i) {
+    bytes += blobs[i]->count() * sizeof(float);
+  }
+  return bytes;
+}
+
+// Mean, median and 99th percentile of a series of times in microseconds.
+struct TimeStats {
+  double mean, p50, p99;
+
+  explicit TimeStats(vector<double> times) : mean(0), p50(0), p99(0) {
+    if (times.empty()) {
+      return;
+    }
+    std::sort(times.begin(), times.end());
+    for (int i = 0; i < times.size(); ++i) {
+      mean += times[i];
+    }
+    mean /= times.size();
+    p50 = percentile(times, 50);
+    p99 = percentile(times, 99);
+  }
+
+  // Nearest rank percentile of sorted times.
+  static double percentile(const vector<double>& times, int p) {
+    const int rank = (p * times.size() + 99) / 100;
+    return times[std::max(rank, 1) - 1];
+  }
+};
+
+// Timings of a net at one batch size, in microseconds per iteration.
+struct TimeReport {
+  int batch_size;
+  vector<string> names;
+  vector<string> types;
+  vector<double> flops;
+  vector<size_t> top_bytes;
+  vector<size_t> bottom_bytes;
+  vector<size_t> param_bytes;
+  vector<vector<double> > forward;   // [layer][iteration]
+  vector<vector<double> > backward;  // [layer][iteration]
+  vector<double> forward_total;
+  vector<double> backward_total;
+};
+
+// GFLOP/s achieved running flops operations in us microseconds. Backward
+// passes are counted as twice the forward FLOPs, for the gradients with
+// respect to both the inputs and the weights.
+static double gflops(double flops, double us) {
+  return us > 0 ? flops / us / 1000 : 0;
+}
+
+static void write_json_stats(std::ostream& out, const char* name,
+    const TimeStats& stats, double flops) {
+  out << format_json_string(name) << ": {\"mean_ms\": " << stats.mean / 1000
+      << ", \"p50_ms\": " << stats.p50 / 1000
+      << ", \"p99_ms\": " << stats.p99 / 1000
+      << ", \"gflops_per_s\": " << gflops(flops, stats.mean) << "}";
+}
+
+static void write_json(std::ostream& out, const vector<TimeReport>& reports) {
+  out << "{\n  \"model\": " << format_json_string(FLAGS_model)
+      << ",\n  \"iterations\": " << FLAGS_iterations
+      << ",\n  \"warmup\": " << FLAGS_warmup
+      << ",\n  \"forward_only\": " << (FLAGS_forward_only ? "true" : "false")
+      << ",\n  \"runs\": [";
+  for (int r = 0; r < reports.size(); ++r) {
+    const TimeReport& report = reports[r];
+    double total_flops = 0;
+    out << (r ? ",\n" : "\n") << "    {\"batch_size\": " << report.batch_size
+        << ",\n     \"layers\": [";
+    for (int i = 0; i < report.names.size(); ++i) {
+      total_flops += report.flops[i];
+      out << (i ? ",\n" : "\n") << "       {\"name\": "
+          << format_json_string(report.names[i])
+          << ", \"type\": " << format_json_string(report.types[i])
+          << ", \"flops\": " << report.flops[i]
+          << ", \"top_bytes\": " << report.top_bytes[i]
+          << ", \"bottom_bytes\": " << report.bottom_bytes[i]
+          << ", \"param_bytes\": " << report.param_bytes[i] << ", ";
+      write_json_stats(out, "forward", TimeStats(report.forward[i]),
+          report.flops[i]);
+      if (!FLAGS_forward_only) {
+        out << ", ";
+        write_json_stats(out, "backward", TimeStats(report.backward[i]),
+            2 * report.flops[i]);
+      }
+      out << "}";
+    }
+    out << "\n     ],\n     \"flops\": " << total_flops << ",\n     ";
+    write_json_stats(out, "forward", TimeStats(report.forward_total),
+        total_flops);
+    if (!FLAGS_forward_only) {
+      out << ",\n     ";
+      write_json_stats(out, "backward", TimeStats(report.backward_total),
+          2 * total_flops);
+    }
+    out << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+static void write_csv_stats(std::ostream& out, const vector<double>& times,
+    double flops) {
+  const TimeStats stats(times);
+  out << "," << stats.mean / 1000 << "," << stats.p50 / 1000 << ","
+      << stats.p99 / 1000 << "," << gflops(flops, stats.mean);
+}
+
+// Writes one row per layer and batch size, and one per batch size for the
+// whole net, named "*".
+static void write_csv(std::ostream& out, const vector<TimeReport>& reports) {
+  out << "batch_size,layer,type,flops,top_bytes,bottom_bytes,param_bytes,"
+      << "forward_mean_ms,forward_p50_ms,forward_p99_ms,forward_gflops_per_s";
+  if (!FLAGS_forward_only) {
+    out << ",backward_mean_ms,backward_p50_ms,backward_p99_ms,"
+        << "backward_gflops_per_s";
+  }
+  out << "\n";
+  for (int r = 0; r < reports.size(); ++r) {
+    const TimeReport& report = reports[r];
+    double total_flops = 0;
+    size_t total_top = 0, total_param = 0;
+    for (int i = 0; i < report.names.size(); ++i) {
+      total_flops += report.flops[i];
+      total_top += report.top_bytes[i];
+      total_param += report.param_bytes[i];
+      out << report.batch_size << "," << report.names[i] << ","
+          << report.types[i] << "," << report.flops[i] << ","
+          << report.top_bytes[i] << "," << report.bottom_bytes[i] << ","
+          << report.param_bytes[i];
+      write_csv_stats(out, report.forward[i], report.flops[i]);
+      if (!FLAGS_forward_only) {
+        write_csv_stats(out, report.backward[i], 2 * report.flops[i]);
+      }
+      out << "\n";
+    }
+    out << report.batch_size << ",*,," << total_flops << "," << total_top
+        << ",," << total_param;
+    write_csv_stats(out, report.forward_total, total_flops);
+    if (!FLAGS_forward_only) {
+      write_csv_stats(out, report.backward_total, 2 * total_flops);
+    }
+    out << "\n";
   }
+}
+
+// Reads the model at the given batch size, or at its own if 0, in the
+// phase, level and stages of the flags.
+static void read_model(int batch_size, caffe::NetParameter* param) {
+  caffe::ReadNetParamsFromTextFileOrDie(FLAGS_model, param);
+  param->mutable_state()->set_phase(get_phase_from_flags(caffe::TRAIN));
+  param->mutable_state()->set_level(FLAGS_level);
+  vector<string> stages = get_stages_from_flags();
+  for (int i = 0; i < stages.size(); ++i) {
+    param->mutable_state()->add_stage(stages[i]);
+  }
+  if (batch_size > 0) {
+    LOG(INFO) << "Batch size " << batch_size;
+    set_batch_size(param, batch_size);
+  }
+}
+
+// Times the net at the given batch size, or at the one of the model if 0.
+static void time_net(int batch_size, TimeReport* report) {
+  caffe::NetParameter param;
+  read_model(batch_size, &param);
   // Instantiate the caffe net.
-  Net<float> caffe_net(FLAGS_model, phase, FLAGS_level, &stages);
+  Net<float> caffe_net(param);
 
-  // Do a clean forward and backward pass, so that memory allocation are done
+  // Do clean forward and backward passes, so that memory allocation are done
   // and future iterations will be more stable.
-  LOG(INFO) << "Performing Forward";
   // Note that for the speed benchmark, we will assume that the network does
   // not take any input blobs.
-  float initial_loss;
-  caffe_net.Forward(&initial_loss);
-  LOG(INFO) << "Initial loss: " << initial_loss;
-  LOG(INFO) << "Performing Backward";
-  caffe_net.Backward();
+  for (int j = 0; j < FLAGS_warmup; ++j) {
+    LOG(INFO) << "Performing Forward";
+    float initial_loss;
+    caffe_net.Forward(&initial_loss);
+    LOG(INFO) << "Initial loss: " << initial_loss;
+    if (!FLAGS_forward_only) {
+      LOG(INFO) << "Performing Backward";
+      caffe_net.Backward();
+    }
+  }
 
   const vector<shared_ptr<Layer<float> > >& layers = caffe_net.layers();
   const vector<vector<Blob<float>*> >& bottom_vecs = caffe_net.bottom_vecs();
   const vector<vector<Blob<float>*> >& top_vecs = caffe_net.top_vecs();
   const vector<vector<bool> >& bottom_need_backward =
       caffe_net.bottom_need_backward();
+  report->batch_size = batch_size;
+  if (batch_size == 0 && caffe_net.blobs().size() &&
+      caffe_net.blobs()[0]->num_axes() > 0) {
+    report->batch_size = caffe_net.blobs()[0]->shape(0);
+  }
+  for (int i = 0; i < layers.size(); ++i) {
+    report->names.push_back(layers[i]->layer_param().name());
+    report->types.push_back(layers[i]->type());
+    report->flops.push_back(
+        forward_flops(layers[i].get(), bottom_vecs[i], top_vecs[i]));
+    report->top_bytes.push_back(data_bytes(top_vecs[i]));
+    report->bottom_bytes.push_back(data_bytes(bottom_vecs[i]));
+    vector<Blob<float>*> params;
+    for (int j = 0; j < layers[i]->blobs().size(); ++j) {
+      params.push_back(layers[i]->blobs()[j].get());
+    }
+    report->param_bytes.push_back(data_bytes(params));
+  }
+  report->forward.assign(layers.size(), vector<double>());
+  report->backward.assign(layers.size(), vector<double>());
+
   LOG(INFO) << "*** Benchmark begins ***";
   LOG(INFO) << "Testing for " << FLAGS_iterations << " iterations.";
   Timer total_timer;
@@ -384,18 +702,25 @@ int time() {
     for (int i = 0; i < layers.size(); ++i) {
       timer.Start();
       layers[i]->Forward(bottom_vecs[i], top_vecs[i]);
-      forward_time_per_layer[i] += timer.MicroSeconds();
+      report->forward[i].push_back(timer.MicroSeconds());
+      forward_time_per_layer[i] += report->forward[i].back();
     }
-    forward_time += forward_timer.MicroSeconds();
-    backward_timer.Start();
-    for (int i = layers.size() - 1; i >= 0; --i) {
-      timer.Start();
-      layers[i]->Backward(top_vecs[i], bottom_need_backward[i],
-                          bottom_vecs[i]);
-      backward_time_per_layer[i] += timer.MicroSeconds();
+    report->forward_total.push_back(forward_timer.MicroSeconds());
+    forward_time += report->forward_total.back();
+    if (!FLAGS_forward_only) {
+      backward_timer.Start();
+      for (int i = layers.size() - 1; i >= 0; --i) {
+        timer.Start();
+        layers[i]->Backward(top_vecs[i], bottom_need_backward[i],
+                            bottom_vecs[i]);
+        report->backward[i].push_back(timer.MicroSeconds());
+        backward_time_per_layer[i] += report->backward[i].back();
+      }
+      report->backward_total.push_back(backward_timer.MicroSeconds());
+      backward_time += report->backward_total.back();
     }
-    backward_time += backward_timer.MicroSeconds();
-    LOG(INFO) << "Iteration: " << j + 1 << " forward-backward time: "
+    LOG(INFO) << "Iteration: " << j + 1 << (FLAGS_forward_only ?
+        " forward time: " : " forward-backward time: ")
       << iter_timer.MilliSeconds() << " ms.";
   }
   LOG(INFO) << "Average time per layer: ";
@@ -404,23 +729,193 @@ int time() {
     LOG(INFO) << std::setfill(' ') << std::setw(10) << layername <<
       "\tforward: " << forward_time_per_layer[i] / 1000 /
       FLAGS_iterations << " ms.";
-    LOG(INFO) << std::setfill(' ') << std::setw(10) << layername  <<
-      "\tbackward: " << backward_time_per_layer[i] / 1000 /
-      FLAGS_iterations << " ms.";
+    if (!FLAGS_forward_only) {
+      LOG(INFO) << std::setfill(' ') << std::setw(10) << layername  <<
+        "\tbackward: " << backward_time_per_layer[i] / 1000 /
+        FLAGS_iterations << " ms.";
+    }
   }
   total_timer.Stop();
   LOG(INFO) << "Average Forward pass: " << forward_time / 1000 /
     FLAGS_iterations << " ms.";
-  LOG(INFO) << "Average Backward pass: " << backward_time / 1000 /
-    FLAGS_iterations << " ms.";
-  LOG(INFO) << "Average Forward-Backward: " << total_timer.MilliSeconds() /
-    FLAGS_iterations << " ms.";
+  if (!FLAGS_forward_only) {
+    LOG(INFO) << "Average Backward pass: " << backward_time / 1000 /
+      FLAGS_iterations << " ms.";
+    LOG(INFO) << "Average Forward-Backward: " << total_timer.MilliSeconds() /
+      FLAGS_iterations << " ms.";
+  }
   LOG(INFO) << "Total Time: " << total_timer.MilliSeconds() << " ms.";
   LOG(INFO) << "*** Benchmark ends ***";
+}
+
+// Time: benchmark the execution time of a model.
+int time() {
+  CHECK_GT(FLAGS_model.size(), 0) << "Need a model definition to time.";
+  CHECK_GT(FLAGS_iterations, 0);
+  CHECK_GE(FLAGS_warmup, 0);
+
+  // Set device id and mode
+  vector<int> gpus;
+  get_gpus(&gpus);
+  if (gpus.size() != 0) {
+    LOG(INFO) << "Use GPU with device ID " << gpus[0];
+    Caffe::SetDevice(gpus[0]);
+    Caffe::set_mode(Caffe::GPU);
+  } else {
+    LOG(INFO) << "Use CPU.";
+    Caffe::set_mode(Caffe::CPU);
+  }
+
+  const vector<int> batch_sizes = get_batch_sizes_from_flags();
+  vector<TimeReport> reports(batch_sizes.size());
+  for (int i = 0; i < batch_sizes.size(); ++i) {
+    time_net(batch_sizes[i], &reports[i]);
+  }
+
+  if (FLAGS_output.size()) {
+    std::ofstream out(FLAGS_output.c_str());
+    CHECK(out) << "Cannot write " << FLAGS_output;
+    if (boost::algorithm::ends_with(FLAGS_output, ".json")) {
+      write_json(out, reports);
+    } else {
+      write_csv(out, reports);
+    }
+    LOG(INFO) << "Wrote timings to " << FLAGS_output;
+  }
   return 0;
 }
 RegisterBrewFunction(time);
 
+// The memory footprint of a net at one batch size.
+struct MemoryReport {
+  int batch_size;
+  vector<string> names;
+  vector<string> types;
+  vector<Net<float>::LayerMemory> layers;
+};
+
+static size_t total_bytes(const Net<float>::LayerMemory& memory) {
+  return memory.activation_bytes + memory.param_bytes + memory.diff_bytes +
+      memory.workspace_bytes;
+}
+
+static void write_json_memory(std::ostream& out,
+    const Net<float>::LayerMemory& memory) {
+  out << "\"activation_bytes\": " << memory.activation_bytes
+      << ", \"param_bytes\": " << memory.param_bytes
+      << ", \"diff_bytes\": " << memory.diff_bytes
+      << ", \"workspace_bytes\": " << memory.workspace_bytes
+      << ", \"total_bytes\": " << total_bytes(memory);
+}
+
+static void write_json(std::ostream& out,
+    const vector<MemoryReport>& reports) {
+  out << "{\n  \"model\": " << format_json_string(FLAGS_model)
+      << ",\n  \"runs\": [";
+  for (int r = 0; r < reports.size(); ++r) {
+    const MemoryReport& report = reports[r];
+    Net<float>::LayerMemory total = {0, 0, 0, 0};
+    out << (r ? ",\n" : "\n") << "    {\"batch_size\": " << report.batch_size
+        << ",\n     \"layers\": [";
+    for (int i = 0; i < report.names.size(); ++i) {
+      const Net<float>::LayerMemory& memory = report.layers[i];
+      total.activation_bytes += memory.activation_bytes;
+      total.param_bytes += memory.param_bytes;
+      total.diff_bytes += memory.diff_bytes;
+      total.workspace_bytes += memory.workspace_bytes;
+      out << (i ? ",\n" : "\n") << "       {\"name\": "
+          << format_json_string(report.names[i])
+          << ", \"type\": " << format_json_string(report.types[i]) << ", ";
+      write_json_memory(out, memory);
+      out << "}";
+    }
+    out << "\n     ],\n     ";
+    write_json_memory(out, total);
+    out << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+static void write_csv_memory(std::ostream& out,
+    const Net<float>::LayerMemory& memory) {
+  out << "," << memory.activation_bytes << "," << memory.param_bytes << ","
+      << memory.diff_bytes << "," << memory.workspace_bytes << ","
+      << total_bytes(memory) << "\n";
+}
+
+// Writes one row per layer and batch size, and one per batch size for the
+// whole net, named "*".
+static void write_csv(std::ostream& out,
+    const vector<MemoryReport>& reports) {
+  out << "batch_size,layer,type,activation_bytes,param_bytes,diff_bytes,"
+      << "workspace_bytes,total_bytes\n";
+  for (int r = 0; r < reports.size(); ++r) {
+    const MemoryReport& report = reports[r];
+    Net<float>::LayerMemory total = {0, 0, 0, 0};
+    for (int i = 0; i < report.names.size(); ++i) {
+      const Net<float>::LayerMemory& memory = report.layers[i];
+      total.activation_bytes += memory.activation_bytes;
+      total.param_bytes += memory.param_bytes;
+      total.diff_bytes += memory.diff_bytes;
+      total.workspace_bytes += memory.workspace_bytes;
+      out << report.batch_size << "," << report.names[i] << ","
+          << report.types[i];
+      write_csv_memory(out, memory);
+    }
+    out << report.batch_size << ",*,";
+    write_csv_memory(out, total);
+  }
+}
+
+// Memory: report the memory footprint of a model, layer by layer, without
+// running it.
+int memory() {
+  CHECK_GT(FLAGS_model.size(), 0) << "Need a model definition to size.";
+  Caffe::set_mode(Caffe::CPU);
+  const vector<int> batch_sizes = get_batch_sizes_from_flags();
+  vector<MemoryReport> reports(batch_sizes.size());
+  for (int r = 0; r < batch_sizes.size(); ++r) {
+    caffe::NetParameter param;
+    read_model(batch_sizes[r], &param);
+    param.set_memory_budget(FLAGS_memory_budget);
+    Net<float> caffe_net(param);
+    MemoryReport& report = reports[r];
+    report.batch_size = batch_sizes[r];
+    if (report.batch_size == 0 && caffe_net.blobs().size() &&
+        caffe_net.blobs()[0]->num_axes() > 0) {
+      report.batch_size = caffe_net.blobs()[0]->shape(0);
+    }
+    report.layers = caffe_net.MemoryFootprint();
+    size_t total = 0;
+    for (int i = 0; i < caffe_net.layers().size(); ++i) {
+      const Net<float>::LayerMemory& memory = report.layers[i];
+      report.names.push_back(caffe_net.layer_names()[i]);
+      report.types.push_back(caffe_net.layers()[i]->type());
+      total += total_bytes(memory);
+      LOG(INFO) << std::setfill(' ') << std::setw(10) << report.names[i]
+          << "\tactivations: " << memory.activation_bytes
+          << "\tparams: " << memory.param_bytes
+          << "\tdiffs: " << memory.diff_bytes
+          << "\tworkspace: " << memory.workspace_bytes << " bytes.";
+    }
+    LOG(INFO) << "Total at batch size " << report.batch_size << ": " << total
+        << " bytes.";
+  }
+
+  if (FLAGS_output.size()) {
+    std::ofstream out(FLAGS_output.c_str());
+    CHECK(out) << "Cannot write " << FLAGS_output;
+    if (boost::algorithm::ends_with(FLAGS_output, ".json")) {
+      write_json(out, reports);
+    } else {
+      write_csv(out, reports);
+    }
+    LOG(INFO) << "Wrote the memory footprint to " << FLAGS_output;
+  }
+  return 0;
+}
+RegisterBrewFunction(memory);
+
 int main(int argc, char** argv) {
   // Print output to stderr (while still logging).
   FLAGS_alsologtostderr = 1;
@@ -433,7 +928,8 @@ int main(int argc, char** argv) {
       "  train           train or finetune a model\n"
       "  test            score a model\n"
       "  device_query    show GPU diagnostic information\n"
-      "  time            benchmark model execution time");
+      "  time            benchmark model execution time\n"
+      "  memory          report the memory footprint of a model");
   // Run tool or show usage.
   caffe::GlobalInit(&argc, &argv);
   if (argc == 2) {
@@ -7,6 +7,10 @@
 // should be a list of files as well as their labels, in the format as
 //   subfolder1/file1.JPEG 7
 //   ....
+//
+// Images are read, resized and encoded by a pool of --threads workers, while
+// the main thread writes the results to the db in list order. The db is
+// therefore identical to the one produced by a single thread.
 
 #include <algorithm>
 #include <fstream>  // NOLINT(readability/streams)
@@ -15,10 +19,12 @@
 #include <vector>
 
 #include "boost/scoped_ptr.hpp"
+#include "boost/thread.hpp"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
 
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
 #include "caffe/util/db.hpp"
 #include "caffe/util/format.hpp"
 #include "caffe/util/io.hpp"
@@ -42,6 +48,121 @@ DEFINE_bool(encoded, false,
     "When this option is on, the encoded image will be save in datum");
 DEFINE_string(encode_type, "",
     "Optional: What type should we encode the image as ('png','jpg',...).");
+DEFINE_int32(threads, 0,
+    "Optional: number of threads reading and encoding images; "
+    "0 uses one per core.");
+DEFINE_int32(commit_interval, 1000,
+    "Number of images written to the db per transaction");
+
+#ifdef USE_OPENCV
+// Converts the images of a list to serialized Datums on a pool of threads.
+// Workers claim list entries in increasing order and run at most a fixed
+// window ahead of the consumer, which receives the results in list order.
+class ParallelImageReader {
+ public:
+  struct Item {
+    bool status;
+    int data_size;
+    int dims_size;
+    string value;
+  };
+
+  ParallelImageReader(const vector<pair<string, int> >& lines,
+      const string& root_folder, int resize_height, int resize_width,
+      bool is_color, bool encoded, const string& encode_type, int threads)
+      : lines_(lines), root_folder_(root_folder),
+        resize_height_(resize_height), resize_width_(resize_width),
+        is_color_(is_color), encoded_(encoded), encode_type_(encode_type),
+        window_(threads * 16), items_(window_), ready_(window_, false),
+        next_id_(0), popped_id_(0) {
+    for (int i = 0; i < threads; ++i) {
+      threads_.create_thread(
+          boost::bind(&ParallelImageReader::WorkerEntry, this));
+    }
+  }
+  ~ParallelImageReader() {
+    threads_.join_all();
+  }
+
+  // Blocks until the next entry of the list has been converted.
+  void Pop(Item* item) {
+    boost::mutex::scoped_lock lock(mutex_);
+    const size_t slot = popped_id_ % window_;
+    while (!ready_[slot]) {
+      item_ready_.wait(lock);
+    }
+    std::swap(*item, items_[slot]);
+    ready_[slot] = false;
+    ++popped_id_;
+    slot_free_.notify_all();
+  }
+
+ private:
+  void WorkerEntry() {
+    Datum datum;
+    Item item;
+    while (true) {
+      size_t line_id;
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        while (next_id_ < lines_.size() && next_id_ - popped_id_ >= window_) {
+          slot_free_.wait(lock);
+        }
+        if (next_id_ >= lines_.size()) {
+          return;
+        }
+        line_id = next_id_++;
+      }
+      Convert(line_id, &datum, &item);
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        const size_t slot = line_id % window_;
+        std::swap(items_[slot], item);
+        ready_[slot] = true;
+      }
+      item_ready_.notify_all();
+    }
+  }
+
+  void Convert(size_t line_id, Datum* datum, Item* item) const {
+    std::string enc = encode_type_;
+    if (encoded_ && !enc.size()) {
+      // Guess the encoding type from the file name
+      string fn = lines_[line_id].first;
+      size_t p = fn.rfind('.');
+      if ( p == fn.npos )
+        LOG(WARNING) << "Failed to guess the encoding of '" << fn << "'";
+      enc = fn.substr(p);
+      std::transform(enc.begin(), enc.end(), enc.begin(), ::tolower);
+    }
+    item->status = ReadImageToDatum(root_folder_ + lines_[line_id].first,
+        lines_[line_id].second, resize_height_, resize_width_, is_color_,
+        enc, datum);
+    if (item->status == false) return;
+    item->data_size = datum->data().size();
+    item->dims_size = datum->channels() * datum->height() * datum->width();
+    CHECK(datum->SerializeToString(&item->value));
+  }
+
+  const vector<pair<string, int> >& lines_;
+  const string root_folder_;
+  const int resize_height_;
+  const int resize_width_;
+  const bool is_color_;
+  const bool encoded_;
+  const string encode_type_;
+  const size_t window_;
+
+  boost::thread_group threads_;
+  boost::mutex mutex_;
+  boost::condition_variable item_ready_;
+  boost::condition_variable slot_free_;
+  vector<Item> items_;
+  vector<bool> ready_;
+  size_t next_id_;
+  size_t popped_id_;
+};
+#endif  // USE_OPENCV
 
 int main(int argc, char** argv) {
 #ifdef USE_OPENCV
@@ -70,6 +191,7 @@ int main(int argc, char** argv) {
   const bool check_size = FLAGS_check_size;
   const bool encoded = FLAGS_encoded;
   const string encode_type = FLAGS_encode_type;
+  CHECK_GT(FLAGS_commit_interval, 0) << "commit_interval must be positive";
 
   std::ifstream infile(argv[2]);
   std::vector<std::pair<std::string, int> > lines;
@@ -94,6 +216,12 @@ int main(int argc, char** argv) {
   int resize_height = std::max<int>(0, FLAGS_resize_height);
   int resize_width = std::max<int>(0, FLAGS_resize_width);
 
+  int threads = FLAGS_threads;
+  if (threads <= 0) {
+    threads = std::max<int>(1, boost::thread::hardware_concurrency());
+  }
+  LOG(INFO) << "Converting images with " << threads << " threads.";
+
   // Create new DB
   scoped_ptr<db::DB> db(db::GetDB(FLAGS_backend));
   db->Open(argv[3], db::NEW);
@@ -101,56 +229,47 @@ int main(int argc, char** argv) {
 
   // Storing to db
   std::string root_folder(argv[1]);
-  Datum datum;
+  ParallelImageReader reader(lines, root_folder, resize_height, resize_width,
+      is_color, encoded, encode_type, threads);
+  ParallelImageReader::Item item;
   int count = 0;
   int data_size = 0;
   bool data_size_initialized = false;
+  CPUTimer timer;
+  timer.Start();
 
   for (int line_id = 0; line_id < lines.size(); ++line_id) {
-    bool status;
-    std::string enc = encode_type;
-    if (encoded && !enc.size()) {
-      // Guess the encoding type from the file name
-      string fn = lines[line_id].first;
-      size_t p = fn.rfind('.');
-      if ( p == fn.npos )
-        LOG(WARNING) << "Failed to guess the encoding of '" << fn << "'";
-      enc = fn.substr(p);
-      std::transform(enc.begin(), enc.end(), enc.begin(), ::tolower);
-    }
-    status = ReadImageToDatum(root_folder + lines[line_id].first,
-        lines[line_id].second, resize_height, resize_width, is_color,
-        enc, &datum);
-    if (status == false) continue;
+    reader.Pop(&item);
+    if (item.status == false) continue;
     if (check_size) {
       if (!data_size_initialized) {
-        data_size = datum.channels() * datum.height() * datum.width();
+        data_size = item.dims_size;
         data_size_initialized = true;
       } else {
-        const std::string& data = datum.data();
-        CHECK_EQ(data.size(), data_size) << "Incorrect data field size "
-            << data.size();
+        CHECK_EQ(item.data_size, data_size) << "Incorrect data field size "
+            << item.data_size;
       }
     }
     // sequential
     string key_str = caffe::format_int(line_id, 8) + "_" + lines[line_id].first;
 
     // Put in db
-    string out;
-    CHECK(datum.SerializeToString(&out));
-    txn->Put(key_str, out);
+    txn->Put(key_str, item.value);
 
-    if (++count % 1000 == 0) {
+    if (++count % FLAGS_commit_interval == 0) {
       // Commit db
       txn->Commit();
       txn.reset(db->NewTransaction());
-      LOG(INFO) << "Processed " << count << " files.";
+      LOG(INFO) << "Processed " << count << " files ("
+          << FLAGS_commit_interval / timer.Seconds() << " files/s).";
+      timer.Start();
     }
   }
   // write the last batch
-  if (count % 1000 != 0) {
+  if (count % FLAGS_commit_interval != 0) {
     txn->Commit();
-    LOG(INFO) << "Processed " << count << " files.";
+    LOG(INFO) << "Processed " << count << " files ("
+        << count % FLAGS_commit_interval / timer.Seconds() << " files/s).";
   }
 #else
   LOG(FATAL) << "This tool requires OpenCV; compile with USE_OPENCV.";
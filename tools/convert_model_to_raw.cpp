@@ -0,0 +1,53 @@
+// This program converts a trained caffemodel to a raw model, which nets map
+// rather than parse when loading it.
+// Usage:
+//    convert_model_to_raw [--double|--half] model_in model_out.raw
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <string>
+
+#include "caffe/caffe.hpp"
+#include "caffe/util/io.hpp"
+#include "caffe/util/raw_model.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+DEFINE_bool(double, false,
+    "Optional; store the weights as double rather than float, for nets of "
+    "type double to map them.");
+DEFINE_bool(half, false,
+    "Optional; store the weights in half precision, which nets convert when "
+    "loading them, for half the size.");
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = 1;  // Print output to stderr (while still logging)
+  gflags::SetUsageMessage("Convert a caffemodel to a raw model\n"
+      "Usage:\n"
+      "    convert_model_to_raw [--double|--half] model_in model_out.raw\n");
+  caffe::GlobalInit(&argc, &argv);
+  if (argc != 3) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/convert_model_to_raw");
+    return 1;
+  }
+  const string input_filename(argv[1]);
+  const string output_filename(argv[2]);
+  LOG_IF(WARNING, !IsRawModelFile(output_filename)) << output_filename
+      << " lacks the .raw extension by which nets recognize raw models";
+
+  NetParameter net_param;
+  ReadNetParamsFromBinaryFileOrDie(input_filename, &net_param);
+  CHECK(!FLAGS_double || !FLAGS_half) << "--double and --half are exclusive";
+  if (FLAGS_half) {
+    const bool kHalf = true;
+    WriteRawModel<float>(net_param, output_filename, kHalf);
+  } else if (FLAGS_double) {
+    WriteRawModel<double>(net_param, output_filename);
+  } else {
+    WriteRawModel<float>(net_param, output_filename);
+  }
+  LOG(INFO) << "Wrote raw model to " << output_filename;
+  return 0;
+}